@@ -0,0 +1,201 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSharedMemory>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <cstdio>
+#include <cstring>
+
+#include "pipelinemetrics.h"
+
+// ȡڴͳƣıJSON
+// ÷MetricsReader [--json] [--interval ms]
+// interval>0 ʱһʱΣÿʣʡ֡ʡ֡ʣ
+
+struct MetricsField
+{
+    const char* name;
+    std::atomic<quint64> StreamMetrics::* member;
+    bool counter;   // ֶβż
+};
+
+static const MetricsField s_fields[] = {
+    { "packetsIn", &StreamMetrics::packetsIn, true },
+    { "bytesIn", &StreamMetrics::bytesIn, true },
+    { "keyframesIn", &StreamMetrics::keyframesIn, true },
+    { "streamOpens", &StreamMetrics::streamOpens, true },
+    { "streamFailures", &StreamMetrics::streamFailures, true },
+    { "decodeQueueDepth", &StreamMetrics::decodeQueueDepth, false },
+    { "recordQueueDepth", &StreamMetrics::recordQueueDepth, false },
+    { "framesDecoded", &StreamMetrics::framesDecoded, true },
+    { "framesDropped", &StreamMetrics::framesDropped, true },
+    { "decodeTimeUs", &StreamMetrics::decodeTimeUs, true },
+    { "showQueueDepth", &StreamMetrics::showQueueDepth, false },
+    { "packetsWritten", &StreamMetrics::packetsWritten, true },
+    { "bytesWritten", &StreamMetrics::bytesWritten, true },
+    { "filesClosed", &StreamMetrics::filesClosed, true },
+    { "recording", &StreamMetrics::recording, false },
+    { "framesPresented", &StreamMetrics::framesPresented, true },
+    { "renderQueueDepth", &StreamMetrics::renderQueueDepth, false },
+};
+static const int s_fieldCount = sizeof(s_fields) / sizeof(s_fields[0]);
+
+struct StreamSample
+{
+    int slot = -1;
+    quint64 pid = 0;
+    quint64 heartbeatMs = 0;
+    QString name;
+    quint64 values[s_fieldCount];
+};
+
+static QVector<StreamSample> takeSample(const MetricsSegment* seg)
+{
+    QVector<StreamSample> samples;
+    for (int i = 0; i < METRICS_MAX_STREAMS; ++i) {
+        const StreamMetrics& stream = seg->streams[i];
+        StreamSample sample;
+        sample.pid = stream.ownerPid.load(std::memory_order_acquire);
+        if (sample.pid == 0) {
+            continue;
+        }
+        sample.slot = i;
+        sample.heartbeatMs = stream.heartbeatMs.load(std::memory_order_relaxed);
+        char name[METRICS_NAME_SIZE];
+        memcpy(name, stream.name, sizeof(name));
+        name[METRICS_NAME_SIZE - 1] = 0;
+        sample.name = QString::fromUtf8(name);
+        for (int f = 0; f < s_fieldCount; ++f) {
+            sample.values[f] = (stream.*(s_fields[f].member)).load(std::memory_order_relaxed);
+        }
+        samples.append(sample);
+    }
+    return samples;
+}
+
+static const StreamSample* findPrevious(const QVector<StreamSample>& previous, const StreamSample& sample)
+{
+    for (const StreamSample& p : previous) {
+        if (p.slot == sample.slot && p.pid == sample.pid) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+static double rateOf(const StreamSample& sample, const StreamSample* previous, int field, double seconds)
+{
+    if (!previous || seconds <= 0.0 || sample.values[field] < previous->values[field]) {
+        return 0.0;
+    }
+    return (sample.values[field] - previous->values[field]) / seconds;
+}
+
+static int fieldIndex(const char* name)
+{
+    for (int f = 0; f < s_fieldCount; ++f) {
+        if (strcmp(s_fields[f].name, name) == 0) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    bool json = false;
+    int intervalMs = 1000;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--json") {
+            json = true;
+        }
+        else if (args[i] == "--interval" && i + 1 < args.size()) {
+            intervalMs = args[++i].toInt();
+        }
+        else {
+            fprintf(stderr, "usage: MetricsReader [--json] [--interval ms]\n");
+            return 2;
+        }
+    }
+
+    QSharedMemory shm(METRICS_SHM_KEY);
+    if (!shm.attach(QSharedMemory::ReadOnly)) {
+        fprintf(stderr, "no player is publishing metrics (%s)\n", shm.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+    const MetricsSegment* seg = static_cast<const MetricsSegment*>(shm.constData());
+    if (shm.size() < (int)sizeof(MetricsSegment) || seg->header.magic != METRICS_MAGIC
+        || seg->header.version != METRICS_VERSION) {
+        fprintf(stderr, "metrics layout version mismatch\n");
+        return 1;
+    }
+
+    QVector<StreamSample> previous;
+    double seconds = 0.0;
+    if (intervalMs > 0) {
+        previous = takeSample(seg);
+        QThread::msleep(intervalMs);
+        seconds = intervalMs / 1000.0;
+    }
+    QVector<StreamSample> current = takeSample(seg);
+    const quint64 now = (quint64)QDateTime::currentMSecsSinceEpoch();
+
+    const int bytesIn = fieldIndex("bytesIn");
+    const int packetsIn = fieldIndex("packetsIn");
+    const int framesDecoded = fieldIndex("framesDecoded");
+    const int framesDropped = fieldIndex("framesDropped");
+    const int framesPresented = fieldIndex("framesPresented");
+    const int bytesWritten = fieldIndex("bytesWritten");
+
+    if (json) {
+        QJsonArray streams;
+        for (const StreamSample& sample : current) {
+            const StreamSample* prev = findPrevious(previous, sample);
+            QJsonObject obj;
+            obj["slot"] = sample.slot;
+            obj["pid"] = (qint64)sample.pid;
+            obj["name"] = sample.name;
+            obj["ageMs"] = (qint64)(now - sample.heartbeatMs);
+            for (int f = 0; f < s_fieldCount; ++f) {
+                obj[s_fields[f].name] = (qint64)sample.values[f];
+                if (s_fields[f].counter && prev) {
+                    obj[QString(s_fields[f].name) + "PerSec"] = rateOf(sample, prev, f, seconds);
+                }
+            }
+            streams.append(obj);
+        }
+        QJsonObject root;
+        root["timestampMs"] = (qint64)now;
+        root["intervalMs"] = intervalMs;
+        root["streams"] = streams;
+        printf("%s\n", QJsonDocument(root).toJson(QJsonDocument::Indented).constData());
+        return 0;
+    }
+
+    printf("%d stream(s)\n", current.size());
+    for (const StreamSample& sample : current) {
+        const StreamSample* prev = findPrevious(previous, sample);
+        printf("[%d] pid %llu  %s  (updated %llu ms ago)\n", sample.slot, (unsigned long long)sample.pid,
+            sample.name.toLocal8Bit().constData(), (unsigned long long)(now - sample.heartbeatMs));
+        if (prev) {
+            printf("    in %.2f Mbps %.1f pkt/s | decode %.1f fps drop %.1f/s | render %.1f fps | rec %.2f Mbps\n",
+                rateOf(sample, prev, bytesIn, seconds) * 8.0 / 1e6,
+                rateOf(sample, prev, packetsIn, seconds),
+                rateOf(sample, prev, framesDecoded, seconds),
+                rateOf(sample, prev, framesDropped, seconds),
+                rateOf(sample, prev, framesPresented, seconds),
+                rateOf(sample, prev, bytesWritten, seconds) * 8.0 / 1e6);
+        }
+        for (int f = 0; f < s_fieldCount; ++f) {
+            printf("    %-18s %llu\n", s_fields[f].name, (unsigned long long)sample.values[f]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "nvrconfig.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+/*
+ļʾ
+{
+    "statsIntervalSec": 10,
+    "coreBudget": 8,
+    "proxyWorkers": 2,
+    "logFile": "nvr.log",
+    "threads": {
+        "demux": { "cpus": "0-1", "exclusive": true, "nice": -5 },
+        "decode": { "cpus": "2-7", "nice": 5 },
+        "record": { "nice": -2 }
+    },
+    "streams": [
+        { "name": "door", "url": "rtsp://192.168.1.10/main", "recordDir": "D:/nvr/door",
+          "segmentMinutes": 10, "snapshotIntervalSec": 60,
+          "proxy": { "maxWidth": 640, "maxHeight": 360, "fps": 10, "bitrateKbps": 400 } },
+        { "name": "yard", "url": "rtsp://192.168.1.11/main", "recordDir": "D:/nvr/yard",
+          "record": false, "motion": true, "motionHoldSec": 15, "motionArea": 0.01,
+          "publishKey": "nvr.yard.frames",
+          "alerts": { "maxJitterMs": 80, "minBitrateKbps": 500, "maxInterArrivalMs": 1000,
+                      "maxGopFrames": 250, "discontinuity": true }, "capture": true,
+          "restream": { "dir": "D:/www/yard", "segmentSeconds": 2, "partSeconds": 0.333, "playlistSegments": 6 } },
+        { "name": "lab", "replay": "D:/nvr/yard/yard_20250101_200000.rcap", "replayRealtime": false,
+          "recordDir": "D:/nvr/lab" }
+    ]
+}
+*/
+bool NvrConfig::load(const QString& filePath, QString* error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(filePath);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull() || !doc.isObject()) {
+        if (error) *error = QString("%1: %2").arg(filePath).arg(parseError.errorString());
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    statsIntervalSec = root.value("statsIntervalSec").toInt(statsIntervalSec);
+    coreBudget = root.value("coreBudget").toInt(coreBudget);
+    proxyWorkers = root.value("proxyWorkers").toInt(proxyWorkers);
+    logFile = root.value("logFile").toString();
+    if (!logFile.isEmpty() && QFileInfo(logFile).isRelative()) {
+        logFile = QFileInfo(filePath).absolutePath() + "/" + logFile;
+    }
+
+    const QJsonObject threads = root.value("threads").toObject();
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+        PipelineStage stage;
+        if (!ThreadPolicy::stageFromName(it.key(), &stage)) {
+            if (error) *error = QString("threads: unknown stage %1").arg(it.key());
+            return false;
+        }
+        const QJsonObject obj = it.value().toObject();
+        StagePolicy& policy = threadPolicies[stage];
+        if (obj.value("cpus").isArray()) {
+            const QJsonArray cpus = obj.value("cpus").toArray();
+            for (const QJsonValue& cpu : cpus) {
+                policy.cpus.append(cpu.toInt());
+            }
+        }
+        else {
+            policy.cpus = ThreadPolicy::parseCpuList(obj.value("cpus").toString());
+        }
+        policy.exclusive = obj.value("exclusive").toBool(policy.exclusive);
+        policy.nice = obj.value("nice").toInt(policy.nice);
+        policy.realtimePriority = obj.value("realtime").toInt(policy.realtimePriority);
+    }
+
+    streams.clear();
+    QJsonArray array = root.value("streams").toArray();
+    for (int i = 0; i < array.size(); ++i) {
+        QJsonObject obj = array.at(i).toObject();
+        NvrStreamConfig stream;
+        stream.name = obj.value("name").toString(QString("stream%1").arg(i));
+        stream.url = obj.value("url").toString();
+        stream.recordDir = obj.value("recordDir").toString();
+        stream.record = obj.value("record").toBool(stream.record);
+        stream.segmentMinutes = obj.value("segmentMinutes").toInt(stream.segmentMinutes);
+        stream.timelapse = obj.value("timelapse").toBool(stream.timelapse);
+        stream.timelapseIntervalSec = obj.value("timelapseIntervalSec").toDouble(stream.timelapseIntervalSec);
+        stream.timelapseSpeed = obj.value("timelapseSpeed").toDouble(stream.timelapseSpeed);
+        stream.snapshotIntervalSec = obj.value("snapshotIntervalSec").toInt(stream.snapshotIntervalSec);
+        stream.motion = obj.value("motion").toBool(stream.motion);
+        stream.motionOptions.enabled = stream.motion;
+        stream.motionOptions.holdSeconds = obj.value("motionHoldSec").toDouble(stream.motionOptions.holdSeconds);
+        stream.motionOptions.areaThreshold = obj.value("motionArea").toDouble(stream.motionOptions.areaThreshold);
+        stream.motionOptions.pixelThreshold = obj.value("motionPixel").toInt(stream.motionOptions.pixelThreshold);
+        stream.preRollSeconds = obj.value("preRollSec").toDouble(stream.preRollSeconds);
+        stream.publishKey = obj.value("publishKey").toString();
+        QJsonObject alerts = obj.value("alerts").toObject();
+        stream.alerts.maxJitterMs = alerts.value("maxJitterMs").toDouble(stream.alerts.maxJitterMs);
+        stream.alerts.minBitrateKbps = alerts.value("minBitrateKbps").toDouble(stream.alerts.minBitrateKbps);
+        stream.alerts.maxInterArrivalMs = alerts.value("maxInterArrivalMs").toDouble(stream.alerts.maxInterArrivalMs);
+        stream.alerts.maxGopFrames = alerts.value("maxGopFrames").toInt(stream.alerts.maxGopFrames);
+        stream.alerts.discontinuity = alerts.value("discontinuity").toBool(stream.alerts.discontinuity);
+        stream.alerts.windowSec = alerts.value("windowSec").toDouble(stream.alerts.windowSec);
+        stream.capture = obj.value("capture").toBool(stream.capture);
+        stream.replayFile = obj.value("replay").toString();
+        stream.replayRealtime = obj.value("replayRealtime").toBool(stream.replayRealtime);
+        stream.replayLoop = obj.value("replayLoop").toBool(stream.replayLoop);
+        QJsonObject restream = obj.value("restream").toObject();
+        stream.restreamDir = restream.value("dir").toString();
+        stream.restream.segmentSeconds = restream.value("segmentSeconds").toDouble(stream.restream.segmentSeconds);
+        stream.restream.partSeconds = restream.value("partSeconds").toDouble(stream.restream.partSeconds);
+        stream.restream.playlistSegments = restream.value("playlistSegments").toInt(stream.restream.playlistSegments);
+        stream.restream.lowLatency = restream.value("lowLatency").toBool(stream.restream.lowLatency);
+        stream.proxy = obj.value("proxy").isObject();
+        QJsonObject proxy = obj.value("proxy").toObject();
+        stream.proxyOptions.maxWidth = proxy.value("maxWidth").toInt(stream.proxyOptions.maxWidth);
+        stream.proxyOptions.maxHeight = proxy.value("maxHeight").toInt(stream.proxyOptions.maxHeight);
+        stream.proxyOptions.fps = proxy.value("fps").toDouble(stream.proxyOptions.fps);
+        stream.proxyOptions.bitrateKbps = proxy.value("bitrateKbps").toInt(stream.proxyOptions.bitrateKbps);
+        stream.proxyOptions.encoder = proxy.value("encoder").toString(stream.proxyOptions.encoder);
+
+        if ((stream.url.isEmpty() && stream.replayFile.isEmpty()) || stream.recordDir.isEmpty()) {
+            if (error) *error = QString("stream %1: url (or replay) and recordDir are required").arg(stream.name);
+            return false;
+        }
+        streams.append(stream);
+    }
+
+    if (streams.isEmpty()) {
+        if (error) *error = QString("%1: no streams configured").arg(filePath);
+        return false;
+    }
+    return true;
+}
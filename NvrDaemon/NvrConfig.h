@@ -0,0 +1,53 @@
+#ifndef NVRCONFIG_H
+#define NVRCONFIG_H
+
+#include <QString>
+#include <QVector>
+
+#include "motiondetector.h"
+#include "streamanalyzer.h"
+#include "threadpolicy.h"
+#include "restreamthread.h"
+#include "proxyrecordthread.h"
+
+// ·¼
+struct NvrStreamConfig
+{
+    QString name;                   // ƣļ־
+    QString url;
+    QString recordDir;
+    bool record = true;             // ¼
+    int segmentMinutes = 10;        // ʱֶΣ<=0 ʾֶ
+    bool timelapse = false;         // ¼Ϊʱ¼
+    double timelapseIntervalSec = 0.0;
+    double timelapseSpeed = 60.0;
+    int snapshotIntervalSec = 0;    // ʱͼ<=0 ر
+    bool motion = false;            // ƶ¼¼ѡһ
+    MotionOptions motionOptions;
+    double preRollSeconds = 5.0;
+    QString publishKey;             // ǿʱѽ֡ùڴ滷̶ȡ
+    StreamThresholds alerts;        // 澯ֵȫΪ 0 ʱ澯
+    bool capture = false;           // ÿӶԭʼƵץ recordDir µ .rcap ļڸֳ
+    QString replayFile;             // ǿʱ urlΪطץļѹ⣩
+    bool replayRealtime = true;     // ԭʼʱطţfalse Ϊܿ
+    bool replayLoop = true;
+    QString restreamDir;            // ǿʱƵת룩г LL-HLS ֶдĿ¼ۿ
+    RestreamOptions restream;
+    bool proxy = false;             // ¼ʱͬʱ¼һݵͷֱʴļҪ룩
+    ProxyOptions proxyOptions;
+};
+
+struct NvrConfig
+{
+    int statsIntervalSec = 10;      // ͳƵ
+    int coreBudget = 0;             // õCPU0 ΪԶ
+    int proxyWorkers = 0;           // ͬʱ¼·ޣÿ·һˣ0 ΪԶ
+    QString logFile;
+    StagePolicy threadPolicies[StageCount];   // ׶̵߳CPU󶨺ȼ
+    QVector<NvrStreamConfig> streams;
+
+    // ȡ JSON ļʧʱ error иԭ
+    bool load(const QString& filePath, QString* error);
+};
+
+#endif // NVRCONFIG_H
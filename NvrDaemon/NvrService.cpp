@@ -0,0 +1,279 @@
+#include "nvrservice.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+
+#include "rtspplayer.h"
+#include "decodertuner.h"
+
+#define RECONNECT_DELAY_MS 5000
+
+NvrService::NvrService(const NvrConfig& config, QObject* parent)
+    : QObject(parent), m_config(config)
+{
+    connect(&m_tickTimer, &QTimer::timeout, this, &NvrService::onTick);
+    connect(&m_statsTimer, &QTimer::timeout, this, &NvrService::onReportStats);
+}
+
+NvrService::~NvrService()
+{
+    for (Channel* channel : m_channels) {
+        delete channel->player;
+        delete channel;
+    }
+    m_channels.clear();
+}
+
+void NvrService::start()
+{
+    if (m_config.coreBudget > 0) {
+        DecoderTuner::setProcessCoreBudget(m_config.coreBudget);
+    }
+    ProxyWorkerPool::setLimit(m_config.proxyWorkers);
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const StagePolicy& policy = m_config.threadPolicies[stage];
+        ThreadPolicy::setPolicy(PipelineStage(stage), policy);
+        if (!policy.cpus.isEmpty() || policy.nice != 0 || policy.realtimePriority > 0) {
+            qInfo() << "Thread policy" << ThreadPolicy::stageName(PipelineStage(stage))
+                << "cpus" << ThreadPolicy::formatCpuList(policy.cpus) << (policy.exclusive ? "(exclusive)" : "")
+                << "nice" << policy.nice << "realtime" << policy.realtimePriority;
+        }
+    }
+
+    m_clock.start();
+    for (const NvrStreamConfig& streamConfig : m_config.streams) {
+        QDir().mkpath(streamConfig.recordDir);
+
+        Channel* channel = new Channel;
+        channel->config = streamConfig;
+        channel->player = new RTSPPlayer();
+        channel->player->setRecordOnly(true);
+        if (!streamConfig.publishKey.isEmpty()) {
+            channel->player->setFramePublishing(true, streamConfig.publishKey);
+        }
+        channel->player->setStreamThresholds(streamConfig.alerts);
+        if (!streamConfig.restreamDir.isEmpty()) {
+            channel->player->setRestream(true, streamConfig.restreamDir, streamConfig.restream);
+        }
+        if (streamConfig.proxy) {
+            channel->player->setProxyRecording(true, streamConfig.proxyOptions);
+        }
+        if (streamConfig.motion) {
+            channel->player->setMotionRecording(true, streamConfig.recordDir,
+                streamConfig.motionOptions, streamConfig.preRollSeconds);
+        }
+
+        connect(channel->player, &RTSPPlayer::sigStreamOpened, this, [this, channel]() {
+            startRecording(channel);
+        });
+        connect(channel->player, &RTSPPlayer::sigStreamFailed, this, [this, channel](QString error) {
+            if (m_shuttingDown) {
+                return;
+            }
+            qWarning() << "[" << channel->config.name << "] stream failed:" << error
+                << ", reconnect in" << RECONNECT_DELAY_MS / 1000 << "s";
+            channel->retryAtMs = m_clock.elapsed() + RECONNECT_DELAY_MS;
+        });
+        connect(channel->player, &RTSPPlayer::sigRecordFinished, this, [channel](QString filePath) {
+            qInfo() << "[" << channel->config.name << "] segment saved:" << filePath;
+        });
+        connect(channel->player, &RTSPPlayer::sigProxyFinished, this, [channel](QString filePath) {
+            qInfo() << "[" << channel->config.name << "] proxy saved:" << filePath;
+        });
+        connect(channel->player, &RTSPPlayer::sigReplayFinished, this, [channel]() {
+            qInfo() << "[" << channel->config.name << "] replay finished";
+        });
+        connect(channel->player, &RTSPPlayer::sigRestreamFailed, this, [channel](QString error) {
+            qWarning() << "[" << channel->config.name << "] restream failed:" << error;
+        });
+        connect(channel->player, &RTSPPlayer::sigStreamAlert, this, [channel](int alert, bool active, double value) {
+            const char* name = StreamAnalyzer::alertName(StreamAlert(alert));
+            if (active) {
+                qWarning() << "[" << channel->config.name << "]" << name << "alert, value" << value;
+            }
+            else {
+                qInfo() << "[" << channel->config.name << "]" << name << "back to normal, value" << value;
+            }
+        });
+
+        m_channels.append(channel);
+        startChannel(channel);
+    }
+
+    m_tickTimer.start(1000);
+    m_statsClock.start();
+    if (m_config.statsIntervalSec > 0) {
+        m_statsTimer.start(m_config.statsIntervalSec * 1000);
+    }
+    qInfo() << "NVR started with" << m_channels.size() << "streams";
+}
+
+void NvrService::startChannel(Channel* channel)
+{
+    const NvrStreamConfig& config = channel->config;
+    channel->retryAtMs = -1;
+    channel->snapshotClock.start();
+    if (!config.replayFile.isEmpty()) {
+        channel->player->openCapture(config.replayFile, config.replayRealtime, config.replayLoop);
+        qInfo() << "[" << config.name << "] replaying" << config.replayFile
+            << (config.replayRealtime ? "in real time" : "as fast as possible");
+        return;
+    }
+
+    channel->player->startPlay(config.url);
+    if (config.capture) {
+        const QString capturePath = config.recordDir + "/" + config.name + "_"
+            + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".rcap";
+        channel->player->startCapture(capturePath);
+        qInfo() << "[" << config.name << "] capturing packets to" << capturePath;
+    }
+    qInfo() << "[" << config.name << "] connecting" << config.url;
+}
+
+void NvrService::startRecording(Channel* channel)
+{
+    const NvrStreamConfig& config = channel->config;
+    if (!config.record || channel->player->isRecording()) {
+        return;
+    }
+
+    QString filePath = recordFilePath(channel);
+    if (config.timelapse) {
+        channel->player->startTimelapseRecord(filePath, config.timelapseIntervalSec, config.timelapseSpeed);
+    }
+    else {
+        channel->player->startRecord(filePath);
+    }
+    channel->segmentClock.start();
+    qInfo() << "[" << config.name << "] recording to" << filePath;
+}
+
+QString NvrService::recordFilePath(const Channel* channel) const
+{
+    return channel->config.recordDir + "/" + channel->config.name + "_"
+        + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".mp4";
+}
+
+void NvrService::onTick()
+{
+    if (m_shuttingDown) {
+        return;
+    }
+
+    const qint64 now = m_clock.elapsed();
+    for (Channel* channel : m_channels) {
+        const NvrStreamConfig& config = channel->config;
+
+        if (channel->retryAtMs >= 0) {
+            if (now >= channel->retryAtMs) {
+                channel->reconnects++;
+                startChannel(channel);
+            }
+            continue;
+        }
+
+        // ֶΣ¼߳һؼ֡лļ
+        if (config.record && config.segmentMinutes > 0 && channel->player->isRecording()
+            && channel->segmentClock.isValid()
+            && channel->segmentClock.hasExpired((qint64)config.segmentMinutes * 60 * 1000)) {
+            channel->player->splitRecord(recordFilePath(channel));
+            channel->segmentClock.restart();
+        }
+
+        if (config.snapshotIntervalSec > 0
+            && channel->snapshotClock.hasExpired((qint64)config.snapshotIntervalSec * 1000)) {
+            QString filePath = config.recordDir + "/" + config.name + "_"
+                + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".jpg";
+            channel->player->screenshot(filePath);
+            channel->snapshotClock.restart();
+        }
+    }
+}
+
+void NvrService::onReportStats()
+{
+    const double seconds = m_statsClock.restart() / 1000.0;
+    if (seconds <= 0.0) {
+        return;
+    }
+
+    for (Channel* channel : m_channels) {
+        const quint64 bytes = channel->player->bytesReceived();
+        const quint64 packets = channel->player->packetsReceived();
+        const quint64 recorded = channel->player->bytesRecorded();
+
+        //  0 ʼ
+        const quint64 deltaBytes = bytes >= channel->lastBytes ? bytes - channel->lastBytes : bytes;
+        const quint64 deltaPackets = packets >= channel->lastPackets ? packets - channel->lastPackets : packets;
+        const quint64 deltaRecorded = recorded >= channel->lastRecorded ? recorded - channel->lastRecorded : recorded;
+        channel->lastBytes = bytes;
+        channel->lastPackets = packets;
+        channel->lastRecorded = recorded;
+
+        const StreamAnalysis analysis = channel->player->streamAnalysis(seconds);
+        qInfo().noquote() << QString("[%1] in %2 Mbps, %3 pkt/s, rec %4 Mbps, %5, reconnects %6")
+            .arg(channel->config.name)
+            .arg(deltaBytes * 8.0 / seconds / 1e6, 0, 'f', 2)
+            .arg(deltaPackets / seconds, 0, 'f', 1)
+            .arg(deltaRecorded * 8.0 / seconds / 1e6, 0, 'f', 2)
+            .arg(channel->retryAtMs >= 0 ? "offline" : (channel->player->isRecording() ? "recording" : "idle"))
+            .arg(channel->reconnects);
+        qInfo().noquote() << QString("[%1] jitter %2 ms, max gap %3 ms, gop %4 frames / %5 s, key %6 KB, discontinuities %7")
+            .arg(channel->config.name)
+            .arg(analysis.jitterMs, 0, 'f', 1)
+            .arg(analysis.maxInterArrivalMs, 0, 'f', 0)
+            .arg(analysis.gopFrames, 0, 'f', 0)
+            .arg(analysis.gopSeconds, 0, 'f', 2)
+            .arg(analysis.keyframeBytes / 1024.0, 0, 'f', 0)
+            .arg(analysis.discontinuities);
+        if (channel->player->isRestreaming()) {
+            const RestreamStats restream = channel->player->restreamStats();
+            qInfo().noquote() << QString("[%1] restream %2 segments, %3 parts, part latency %4 / avg %5 / max %6 ms, age %7 ms, dropped %8")
+                .arg(channel->config.name)
+                .arg(restream.segments)
+                .arg(restream.parts)
+                .arg(restream.lastPartMs, 0, 'f', 1)
+                .arg(restream.avgPartMs, 0, 'f', 1)
+                .arg(restream.maxPartMs, 0, 'f', 1)
+                .arg(restream.lastAgeMs, 0, 'f', 0)
+                .arg(restream.droppedPackets);
+        }
+        if (channel->config.proxy) {
+            const ProxyStats proxy = channel->player->proxyStats();
+            qInfo().noquote() << QString("[%1] proxy %2 frames, %3 skipped, %4 dropped, encode %5 ms/frame, %6 MB")
+                .arg(channel->config.name)
+                .arg(proxy.framesEncoded)
+                .arg(proxy.framesSkipped)
+                .arg(proxy.framesDropped)
+                .arg(proxy.avgEncodeMs, 0, 'f', 2)
+                .arg(proxy.bytesWritten / 1048576.0, 0, 'f', 1);
+        }
+    }
+
+    for (const QString& line : ThreadPolicy::report()) {
+        qInfo().noquote() << "threads" << line;
+    }
+}
+
+void NvrService::shutdown()
+{
+    if (m_shuttingDown) {
+        return;
+    }
+    m_shuttingDown = true;
+    qInfo() << "NVR shutting down...";
+
+    m_tickTimer.stop();
+    m_statsTimer.stop();
+
+    for (Channel* channel : m_channels) {
+        channel->player->requestStop();
+    }
+    for (Channel* channel : m_channels) {
+        channel->player->stopPlay();
+    }
+
+    qInfo() << "NVR stopped";
+    QCoreApplication::quit();
+}
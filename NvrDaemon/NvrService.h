@@ -0,0 +1,59 @@
+#ifndef NVRSERVICE_H
+#define NVRSERVICE_H
+
+#include <QObject>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "nvrconfig.h"
+
+class RTSPPlayer;
+
+// ޽¼ÿ·һֻ¼ģʽ RTSPPlayer÷ֶ¼񡢶ʱͼ
+// ÿ·ͳ
+class NvrService : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NvrService(const NvrConfig& config, QObject* parent = nullptr);
+    ~NvrService();
+
+    void start();
+
+public slots:
+    // ֪ͨͬʱֹͣȴ߳˳дļβ˳¼ѭ
+    void shutdown();
+
+private slots:
+    void onTick();
+    void onReportStats();
+
+private:
+    struct Channel
+    {
+        NvrStreamConfig config;
+        RTSPPlayer* player = nullptr;
+        QElapsedTimer segmentClock;
+        QElapsedTimer snapshotClock;
+        qint64 retryAtMs = -1;       // ʱ㣬-1 ʾ
+        quint64 lastBytes = 0;
+        quint64 lastPackets = 0;
+        quint64 lastRecorded = 0;
+        int reconnects = 0;
+    };
+
+    void startChannel(Channel* channel);
+    void startRecording(Channel* channel);
+    QString recordFilePath(const Channel* channel) const;
+
+    NvrConfig m_config;
+    QVector<Channel*> m_channels;
+    QTimer m_tickTimer;
+    QTimer m_statsTimer;
+    QElapsedTimer m_clock;
+    QElapsedTimer m_statsClock;
+    bool m_shuttingDown = false;
+};
+
+#endif // NVRSERVICE_H
@@ -0,0 +1,127 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <cstdio>
+
+#include "asynclogger.h"
+#include "nvrconfig.h"
+#include "nvrservice.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static NvrService* g_service = nullptr;
+
+void outputMessage(QtMsgType type, const QMessageLogContext& context, const QString& msg)
+{
+    AsyncLogger::instance()->log(type, context.category, msg);
+    if (type == QtFatalMsg) {
+        AsyncLogger::instance()->flush();
+    }
+}
+
+#ifdef Q_OS_WIN
+// ̨ر/Ctrl+C/ֹͣصϵͳ̣߳תִ߳йر
+static BOOL WINAPI consoleCtrlHandler(DWORD ctrlType)
+{
+    Q_UNUSED(ctrlType);
+    if (g_service) {
+        QMetaObject::invokeMethod(g_service, "shutdown", Qt::QueuedConnection);
+        // غϵͳֱӽ̣¼ļдβʱ
+        Sleep(10000);
+    }
+    return TRUE;
+}
+
+static void installShutdownHandler()
+{
+    SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+}
+#else
+// źŴֻ첽źŰȫĲдһֽڵ socketpair¼ѭ
+static int g_signalFd[2] = { -1, -1 };
+
+static void signalHandler(int)
+{
+    char c = 1;
+    ssize_t ret = ::write(g_signalFd[0], &c, sizeof(c));
+    Q_UNUSED(ret);
+}
+
+static void installShutdownHandler()
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, g_signalFd) != 0) {
+        qCritical() << "socketpair failed, SIGTERM will not stop recording cleanly";
+        return;
+    }
+
+    QSocketNotifier* notifier = new QSocketNotifier(g_signalFd[1], QSocketNotifier::Read, qApp);
+    QObject::connect(notifier, &QSocketNotifier::activated, [notifier]() {
+        notifier->setEnabled(false);
+        char c;
+        ssize_t ret = ::read(g_signalFd[1], &c, sizeof(c));
+        Q_UNUSED(ret);
+        if (g_service) {
+            g_service->shutdown();
+        }
+    });
+
+    struct sigaction action;
+    action.sa_handler = signalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // д߳ǰ־ڶáȷ־ļ
+    AsyncLogger* logger = AsyncLogger::instance();
+    logger->setEchoToStderr(true);
+    qInstallMessageHandler(outputMessage);
+
+    QString configPath = argc > 1 ? QString::fromLocal8Bit(argv[1])
+        : QCoreApplication::applicationDirPath() + "/nvr.json";
+
+    NvrConfig config;
+    QString error;
+    if (!config.load(configPath, &error)) {
+        qCritical() << "Failed to load config:" << error;
+        qInstallMessageHandler(nullptr);
+        logger->start();
+        logger->stop();
+        fprintf(stderr, "usage: NvrDaemon [config.json]\n");
+        return 1;
+    }
+    if (!config.logFile.isEmpty()) {
+        // nvr.log -> nvr2024-01-01.logڻļ
+        QFileInfo info(config.logFile);
+        logger->setFilePattern(config.logFile.contains("%1") ? config.logFile
+            : info.absolutePath() + "/" + info.completeBaseName() + "%1." + info.suffix());
+        logger->setRotation(50 * 1024 * 1024, 10);
+    }
+    logger->start(QThread::LowPriority);
+
+    NvrService service(config);
+    g_service = &service;
+    installShutdownHandler();
+    service.start();
+
+    int ret = app.exec();
+    g_service = nullptr;
+
+    qInstallMessageHandler(nullptr);
+    logger->stop();
+    return ret;
+}
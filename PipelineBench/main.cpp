@@ -0,0 +1,394 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QSysInfo>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libswscale/swscale.h"
+}
+
+// ˮȵ΢׼нӡ/֡¡NV12תRGBͼ룬ֱ 1080p  4K ²
+// ÷PipelineBench [--json] [--filter Ƭ] [--min-ms ÿʱ] [--sizes 1080p,4k]
+// ڸĶ֮ǰȽϲͬʵ֣--json ֱӴ浵Ա
+
+struct BenchSize
+{
+    const char* name;
+    int width;
+    int height;
+    int keyframeBytes;  // ͵Ĺؼ֡С¡
+};
+
+static const BenchSize s_sizes[] = {
+    { "1080p", 1920, 1080, 300 * 1024 },
+    { "4k", 3840, 2160, 1000 * 1024 },
+};
+
+struct BenchResult
+{
+    QString name;
+    QString size;
+    int samples = 0;
+    qint64 operations = 0;
+    double meanNs = 0.0;
+    double p50Ns = 0.0;
+    double p95Ns = 0.0;
+    double minNs = 0.0;
+    double bytesPerOp = 0.0;    // ʱ£MB/s
+};
+
+struct BenchOptions
+{
+    QString filter;
+    qint64 minMs = 1000;
+    QStringList sizes;
+};
+
+// Qt 5.9 û QThread::create
+class FunctionThread : public QThread
+{
+public:
+    explicit FunctionThread(const std::function<void()>& fn) : m_fn(fn) {}
+protected:
+    void run() override { m_fn(); }
+private:
+    std::function<void()> m_fn;
+};
+
+static BenchOptions s_options;
+static QVector<BenchResult> s_results;
+
+static bool selected(const QString& name, const char* size)
+{
+    return (s_options.filter.isEmpty() || name.contains(s_options.filter))
+        && (!size || s_options.sizes.contains(size));
+}
+
+static double percentile(QVector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    const int i = qBound(0, int(p * (values.size() - 1) + 0.5), values.size() - 1);
+    return values[i];
+}
+
+// ÿִ batch  op 5 ʱ䲻 minMsһԤ
+static void runBench(const QString& name, const char* size, int batch, double bytesPerOp,
+    const std::function<void()>& op)
+{
+    if (!selected(name, size)) {
+        return;
+    }
+
+    for (int i = 0; i < batch; ++i) {
+        op();
+    }
+
+    QVector<double> perOp;
+    QElapsedTimer total;
+    total.start();
+    while (perOp.size() < 5 || total.elapsed() < s_options.minMs) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < batch; ++i) {
+            op();
+        }
+        perOp.append(double(timer.nsecsElapsed()) / batch);
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.size = size ? size : "-";
+    result.samples = perOp.size();
+    result.operations = qint64(perOp.size()) * batch;
+    double sum = 0.0;
+    for (double v : perOp) {
+        sum += v;
+    }
+    result.meanNs = sum / perOp.size();
+    result.p50Ns = percentile(perOp, 0.50);
+    result.p95Ns = percentile(perOp, 0.95);
+    result.minNs = percentile(perOp, 0.0);
+    result.bytesPerOp = bytesPerOp;
+    s_results.append(result);
+    fprintf(stderr, "  %-28s %-6s %12.0f ns/op\n", name.toLocal8Bit().constData(), result.size.toLocal8Bit().constData(),
+        result.p50Ns);
+}
+
+//  NV12 ֡ɫͼʱòʵ
+static AVFrame* makeNv12Frame(int width, int height)
+{
+    AVFrame* frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_NV12;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    quint32 seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            row[x] = uint8_t((x + y) / 16 + (seed >> 28));
+        }
+    }
+    for (int y = 0; y < height / 2; ++y) {
+        uint8_t* row = frame->data[1] + y * frame->linesize[1];
+        for (int x = 0; x < width; ++x) {
+            row[x] = uint8_t(128 + ((x / 64 + y / 32) & 1 ? 20 : -20));
+        }
+    }
+    return frame;
+}
+
+// RTSPPlayer  QQueue+QMutex ӣproducers ߳ӣconsumers ̳߳
+// Ѷ˶пʱóCPU msleep(10)⵽˯ʱǶб
+static void benchQueue(int producers, int consumers)
+{
+    const QString name = QString("queue_handoff_%1p%2c").arg(producers).arg(consumers);
+    if (!selected(name, nullptr)) {
+        return;
+    }
+
+    const int itemsPerProducer = 200000;
+    const qint64 totalItems = qint64(itemsPerProducer) * producers;
+    QVector<double> perItem;
+    QElapsedTimer total;
+    total.start();
+    while (perItem.size() < 5 || total.elapsed() < s_options.minMs) {
+        QQueue<AVPacket*> queue;
+        QMutex mutex;
+        std::atomic<qint64> consumed{ 0 };
+        QVector<QThread*> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.append(new FunctionThread([&queue, &mutex, itemsPerProducer]() {
+                AVPacket* dummy = reinterpret_cast<AVPacket*>(quintptr(1));
+                for (int i = 0; i < itemsPerProducer; ++i) {
+                    mutex.lock();
+                    queue.enqueue(dummy);
+                    mutex.unlock();
+                }
+            }));
+        }
+        for (int c = 0; c < consumers; ++c) {
+            threads.append(new FunctionThread([&queue, &mutex, &consumed, totalItems]() {
+                while (consumed.load(std::memory_order_relaxed) < totalItems) {
+                    mutex.lock();
+                    if (queue.isEmpty()) {
+                        mutex.unlock();
+                        QThread::yieldCurrentThread();
+                        continue;
+                    }
+                    queue.dequeue();
+                    mutex.unlock();
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        for (QThread* thread : threads) {
+            thread->start();
+        }
+        for (QThread* thread : threads) {
+            thread->wait();
+            delete thread;
+        }
+        perItem.append(double(timer.nsecsElapsed()) / totalItems);
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.size = "-";
+    result.samples = perItem.size();
+    result.operations = totalItems * perItem.size();
+    double sum = 0.0;
+    for (double v : perItem) {
+        sum += v;
+    }
+    result.meanNs = sum / perItem.size();
+    result.p50Ns = percentile(perItem, 0.50);
+    result.p95Ns = percentile(perItem, 0.95);
+    result.minNs = percentile(perItem, 0.0);
+    s_results.append(result);
+    fprintf(stderr, "  %-28s %-6s %12.0f ns/op\n", name.toLocal8Bit().constData(), "-", result.p50Ns);
+}
+
+static void benchSize(const BenchSize& size)
+{
+    // DemuxThread ÿ¡ݣ롢¼ƣԴͷ
+    AVPacket* packet = av_packet_alloc();
+    av_new_packet(packet, size.keyframeBytes);
+    memset(packet->data, 0x5a, size.keyframeBytes);
+    runBench("packet_clone_fanout2", size.name, 1000, 0.0, [packet]() {
+        AVPacket* decodeCopy = av_packet_clone(packet);
+        AVPacket* recordCopy = av_packet_clone(packet);
+        av_packet_free(&decodeCopy);
+        av_packet_free(&recordCopy);
+    });
+    // գü
+    runBench("packet_deep_copy", size.name, 100, size.keyframeBytes, [packet, &size]() {
+        AVPacket* copy = av_packet_alloc();
+        av_new_packet(copy, size.keyframeBytes);
+        memcpy(copy->data, packet->data, size.keyframeBytes);
+        av_packet_free(&copy);
+    });
+    av_packet_free(&packet);
+
+    AVFrame* frame = makeNv12Frame(size.width, size.height);
+    if (!frame) {
+        fprintf(stderr, "cannot allocate %s frame\n", size.name);
+        return;
+    }
+    const int nv12Bytes = av_image_get_buffer_size(AV_PIX_FMT_NV12, size.width, size.height, 1);
+    const int rgbBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, size.width, size.height, 1);
+
+    // DecodeThread ֡ʾеķʽ
+    runBench("frame_clone_handoff", size.name, 1000, 0.0, [frame]() {
+        AVFrame* copy = av_frame_clone(frame);
+        av_frame_free(&copy);
+    });
+    // գһ֡Ӳ֡ʱҪ
+    runBench("frame_deep_copy", size.name, 10, nv12Bytes, [frame]() {
+        AVFrame* copy = av_frame_alloc();
+        copy->format = frame->format;
+        copy->width = frame->width;
+        copy->height = frame->height;
+        av_frame_get_buffer(copy, 0);
+        av_frame_copy(copy, frame);
+        av_frame_free(&copy);
+    });
+
+    //  ScreenshotThread::run ͬתÿ½ģSWS_BILINEAR ת RGB24
+    uint8_t* rgbBuffer = (uint8_t*)av_malloc(rgbBytes);
+    uint8_t* rgbData[4];
+    int rgbLinesize[4];
+    av_image_fill_arrays(rgbData, rgbLinesize, rgbBuffer, AV_PIX_FMT_RGB24, size.width, size.height, 1);
+    runBench("nv12_to_rgb_screenshot", size.name, 1, nv12Bytes, [&]() {
+        SwsContext* ctx = sws_getContext(size.width, size.height, AV_PIX_FMT_NV12,
+            size.width, size.height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        sws_scale(ctx, (const uint8_t* const*)frame->data, frame->linesize, 0, size.height, rgbData, rgbLinesize);
+        sws_freeContext(ctx);
+    });
+    // գĸ
+    SwsContext* cached = sws_getContext(size.width, size.height, AV_PIX_FMT_NV12,
+        size.width, size.height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    runBench("nv12_to_rgb_cached_ctx", size.name, 1, nv12Bytes, [&]() {
+        sws_scale(cached, (const uint8_t* const*)frame->data, frame->linesize, 0, size.height, rgbData, rgbLinesize);
+    });
+    sws_freeContext(cached);
+
+    // ͼ룺QImage::save ͬ·дڴ⵽
+    QImage image(rgbBuffer, size.width, size.height, rgbLinesize[0], QImage::Format_RGB888);
+    runBench("png_encode", size.name, 1, rgbBytes, [&image]() {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+    });
+    runBench("jpeg_encode_q90", size.name, 1, rgbBytes, [&image]() {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "JPG", 90);
+    });
+
+    av_freep(&rgbBuffer);
+    av_frame_free(&frame);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    bool json = false;
+    s_options.sizes << "1080p" << "4k";
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--json") {
+            json = true;
+        }
+        else if (args[i] == "--filter" && i + 1 < args.size()) {
+            s_options.filter = args[++i];
+        }
+        else if (args[i] == "--min-ms" && i + 1 < args.size()) {
+            s_options.minMs = qMax(1, args[++i].toInt());
+        }
+        else if (args[i] == "--sizes" && i + 1 < args.size()) {
+            s_options.sizes = args[++i].toLower().split(',', QString::SkipEmptyParts);
+        }
+        else {
+            fprintf(stderr, "usage: PipelineBench [--json] [--filter name] [--min-ms ms] [--sizes 1080p,4k]\n");
+            return 2;
+        }
+    }
+
+    // д stderrstdout ֻнض浵
+    const int cores = QThread::idealThreadCount();
+    benchQueue(1, 1);
+    benchQueue(qMax(2, cores / 2), 1);
+    benchQueue(qMax(2, cores / 2), qMax(2, cores / 2));
+    for (const BenchSize& size : s_sizes) {
+        benchSize(size);
+    }
+
+    if (json) {
+        QJsonArray results;
+        for (const BenchResult& r : s_results) {
+            QJsonObject obj;
+            obj["name"] = r.name;
+            obj["size"] = r.size;
+            obj["samples"] = r.samples;
+            obj["operations"] = r.operations;
+            obj["meanNs"] = r.meanNs;
+            obj["p50Ns"] = r.p50Ns;
+            obj["p95Ns"] = r.p95Ns;
+            obj["minNs"] = r.minNs;
+            obj["opsPerSec"] = r.p50Ns > 0.0 ? 1e9 / r.p50Ns : 0.0;
+            if (r.bytesPerOp > 0.0) {
+                obj["mbPerSec"] = r.p50Ns > 0.0 ? r.bytesPerOp / r.p50Ns * 1e9 / (1024.0 * 1024.0) : 0.0;
+            }
+            results.append(obj);
+        }
+        QJsonObject machine;
+        machine["cpu"] = QSysInfo::currentCpuArchitecture();
+        machine["cores"] = cores;
+        machine["os"] = QSysInfo::prettyProductName();
+        machine["qt"] = qVersion();
+        machine["ffmpeg"] = av_version_info();
+        QJsonObject root;
+        root["machine"] = machine;
+        root["minMs"] = s_options.minMs;
+        root["results"] = results;
+        printf("%s\n", QJsonDocument(root).toJson(QJsonDocument::Indented).constData());
+        return 0;
+    }
+
+    printf("%-28s %-6s %12s %12s %12s %10s\n", "benchmark", "size", "p50 ns", "p95 ns", "ops/s", "MB/s");
+    for (const BenchResult& r : s_results) {
+        const double ops = r.p50Ns > 0.0 ? 1e9 / r.p50Ns : 0.0;
+        const double mbps = r.bytesPerOp > 0.0 ? r.bytesPerOp * ops / (1024.0 * 1024.0) : 0.0;
+        printf("%-28s %-6s %12.0f %12.0f %12.1f %10.1f\n", r.name.toLocal8Bit().constData(),
+            r.size.toLocal8Bit().constData(), r.p50Ns, r.p95Ns, ops, mbps);
+    }
+    return 0;
+}
@@ -0,0 +1,291 @@
+#include "asynclogger.h"
+#include <QDate>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+AsyncLogger* AsyncLogger::instance()
+{
+    static AsyncLogger logger;
+    return &logger;
+}
+
+AsyncLogger::AsyncLogger()
+{
+    m_slots = new Slot[LOG_QUEUE_CAPACITY];
+    for (size_t i = 0; i < LOG_QUEUE_CAPACITY; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        m_slots[i].length = 0;
+    }
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop();
+    delete[] m_slots;
+}
+
+void AsyncLogger::setFilePattern(const QString& filePattern)
+{
+    m_filePattern = filePattern;
+}
+
+void AsyncLogger::setRotation(qint64 maxBytes, int maxBackups)
+{
+    m_maxBytes = maxBytes;
+    m_maxBackups = maxBackups;
+}
+
+void AsyncLogger::setRateLimit(int maxPerSecond)
+{
+    m_maxPerSecond = maxPerSecond;
+}
+
+void AsyncLogger::setEchoToStderr(bool enabled)
+{
+    m_echoToStderr = enabled;
+}
+
+void AsyncLogger::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    m_stopped = true;
+    wait();
+}
+
+// н MPSC ζУVyukovÿ۵ sequence ڵڼ֣
+//  CAS ռдλãֻд߳һ
+bool AsyncLogger::enqueue(const QByteArray& line)
+{
+    Slot* slot = nullptr;
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &m_slots[pos & (LOG_QUEUE_CAPACITY - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false; // 
+        }
+        else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    int length = qMin(line.size(), LOG_SLOT_SIZE);
+    memcpy(slot->data, line.constData(), length);
+    if (line.size() > LOG_SLOT_SIZE) {
+        memcpy(slot->data + LOG_SLOT_SIZE - 5, "...\r\n", 5);
+    }
+    slot->length = length;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::dequeue(QByteArray* out)
+{
+    Slot* slot = &m_slots[m_dequeuePos & (LOG_QUEUE_CAPACITY - 1)];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    if (seq != m_dequeuePos + 1) {
+        return false;
+    }
+    out->append(slot->data, slot->length);
+    slot->sequence.store(m_dequeuePos + LOG_QUEUE_CAPACITY, std::memory_order_release);
+    ++m_dequeuePos;
+    return true;
+}
+
+bool AsyncLogger::allowByRate(quint64 key, int* suppressed)
+{
+    *suppressed = 0;
+    const int maxPerSecond = m_maxPerSecond;
+    if (maxPerSecond <= 0) {
+        return true;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    RateBucket& bucket = m_buckets[key % LOG_RATE_BUCKETS];
+
+    // ͰռãϣͻʱֱӽӹܣֻżŹ
+    if (bucket.key.load(std::memory_order_relaxed) != key) {
+        bucket.key.store(key, std::memory_order_relaxed);
+        bucket.windowStart.store(now, std::memory_order_relaxed);
+        bucket.count.store(0, std::memory_order_relaxed);
+        bucket.suppressed.store(0, std::memory_order_relaxed);
+    }
+
+    qint64 windowStart = bucket.windowStart.load(std::memory_order_relaxed);
+    if (now - windowStart >= 1000
+        && bucket.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+        bucket.count.store(0, std::memory_order_relaxed);
+        *suppressed = bucket.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (bucket.count.fetch_add(1, std::memory_order_relaxed) >= maxPerSecond) {
+        bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+        m_suppressedTotal.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AsyncLogger::log(QtMsgType type, const char* category, const QString& msg)
+{
+    // Ĭµ־ qDebug()Ϣ֣ "Drop one frame" ˢ
+    quint64 key = qHash(QByteArray(category ? category : "default"));
+    if (!category || strcmp(category, "default") == 0) {
+        key = key * 31 + qHash(msg);
+    }
+    key |= 1; // 0 ʾͰ
+
+    int suppressed = 0;
+    if (type != QtFatalMsg && type != QtCriticalMsg && !allowByRate(key, &suppressed)) {
+        return;
+    }
+
+    const char* text = "Debug:";
+    switch (type)
+    {
+    case QtDebugMsg:
+        text = "Debug:";
+        break;
+    case QtWarningMsg:
+        text = "Warning:";
+        break;
+    case QtCriticalMsg:
+        text = "Critical:";
+        break;
+    case QtFatalMsg:
+        text = "Fatal:";
+        break;
+    case QtInfoMsg:
+        text = "Info:";
+        break;
+    }
+
+    QString current_date_time = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss,zzz");
+    QString message = QString("%1 %2 - %3").arg(current_date_time).arg(text).arg(msg);
+    if (suppressed > 0) {
+        message += QString(" (%1 similar messages suppressed)").arg(suppressed);
+    }
+
+    if (!enqueue(message.toUtf8() + "\r\n")) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogger::flush(int timeoutMs)
+{
+    if (!isRunning() || QThread::currentThread() == this) {
+        return;
+    }
+    const size_t target = m_enqueuePos.load(std::memory_order_acquire);
+    QElapsedTimer timer;
+    timer.start();
+    while (m_writtenPos.load(std::memory_order_acquire) < target && !timer.hasExpired(timeoutMs)) {
+        QThread::msleep(1);
+    }
+}
+
+void AsyncLogger::openFile()
+{
+    m_currentDate = QDate::currentDate().toString("yyyy-MM-dd");
+    m_file.setFileName(m_filePattern.arg(m_currentDate));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        fprintf(stderr, "AsyncLogger: cannot open %s\n", m_file.fileName().toLocal8Bit().constData());
+    }
+}
+
+void AsyncLogger::rotateIfNeeded()
+{
+    if (m_filePattern.isEmpty()) {
+        return;
+    }
+
+    if (!m_file.isOpen() || QDate::currentDate().toString("yyyy-MM-dd") != m_currentDate) {
+        m_file.close();
+        openFile();
+        return;
+    }
+
+    if (m_maxBytes <= 0 || m_file.size() < m_maxBytes) {
+        return;
+    }
+
+    // Test2024-01-01.log -> Test2024-01-01.1.log -> ... -> Test2024-01-01.N.log
+    m_file.close();
+    QFileInfo info(m_file.fileName());
+    auto backupName = [&info](int index) {
+        return info.absolutePath() + "/" + info.completeBaseName() + QString(".%1.").arg(index) + info.suffix();
+    };
+    QFile::remove(backupName(m_maxBackups));
+    for (int i = m_maxBackups - 1; i >= 1; --i) {
+        QFile::rename(backupName(i), backupName(i + 1));
+    }
+    if (m_maxBackups > 0) {
+        QFile::rename(info.absoluteFilePath(), backupName(1));
+    }
+    else {
+        QFile::remove(info.absoluteFilePath());
+    }
+    openFile();
+}
+
+void AsyncLogger::run()
+{
+    QByteArray batch;
+    batch.reserve(64 * 1024);
+    quint64 reportedDropped = 0;
+
+    while (true) {
+        const bool stopping = m_stopped;
+
+        // һȡ 256 ϲһд
+        int count = 0;
+        while (count < 256 && dequeue(&batch)) {
+            ++count;
+        }
+
+        quint64 dropped = m_dropped;
+        if (dropped != reportedDropped) {
+            batch.append(QString("%1 Warning: - log queue full, %2 messages dropped\r\n")
+                .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss,zzz"))
+                .arg(dropped - reportedDropped).toUtf8());
+            reportedDropped = dropped;
+        }
+
+        if (!batch.isEmpty()) {
+            rotateIfNeeded();
+            if (m_file.isOpen()) {
+                m_file.write(batch);
+                m_file.flush();
+            }
+            if (m_echoToStderr) {
+                fwrite(batch.constData(), 1, batch.size(), stderr);
+                fflush(stderr);
+            }
+            batch.clear();
+        }
+        m_writtenPos.store(m_dequeuePos, std::memory_order_release);
+
+        if (count == 256) {
+            continue; // лѹ
+        }
+        if (stopping) {
+            break;
+        }
+        msleep(20);
+    }
+
+    m_file.close();
+}
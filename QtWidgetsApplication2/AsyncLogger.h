@@ -0,0 +1,89 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QThread>
+#include <QString>
+#include <QFile>
+#include <atomic>
+
+// 첽־־ֻ߳ѸʽõһпζУɺ̨߳дļ
+// ʱֱӶڴռù̶Ϊ LOG_QUEUE_CAPACITY * LOG_SLOT_SIZE
+#define LOG_QUEUE_CAPACITY 4096     // 2
+#define LOG_SLOT_SIZE 512           // ־ֽض
+#define LOG_RATE_BUCKETS 64
+
+class AsyncLogger : public QThread
+{
+    Q_OBJECT
+public:
+    static AsyncLogger* instance();
+
+    // filePattern е %1 滻Ϊڣ ".../Test%1.log"
+    void setFilePattern(const QString& filePattern);
+    // ļ maxBytes Ϊ .1.log ... .N.logڱ仯ʱļ
+    void setRotation(qint64 maxBytes, int maxBackups);
+    // ͬһ־ÿд maxPerSecond ֻһ벹һ
+    void setRateLimit(int maxPerSecond);
+    // ͬʱ stderr̨ʹã
+    void setEchoToStderr(bool enabled);
+
+    // ̰߳ȫcategory ΪʱϢ
+    void log(QtMsgType type, const char* category, const QString& msg);
+    // ȴдգ˳ǰãȴ timeoutMs
+    void flush(int timeoutMs = 1000);
+    void stop();
+
+    quint64 droppedCount() const { return m_dropped; }
+    quint64 suppressedCount() const { return m_suppressedTotal; }
+
+protected:
+    void run() override;
+
+private:
+    AsyncLogger();
+    ~AsyncLogger();
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        int length;
+        char data[LOG_SLOT_SIZE];
+    };
+
+    // ÿͰ 1 봰ڼֶζԭ߳ͬʱ־ʱ
+    struct RateBucket
+    {
+        std::atomic<quint64> key{ 0 };
+        std::atomic<qint64> windowStart{ 0 };
+        std::atomic<int> count{ 0 };
+        std::atomic<int> suppressed{ 0 };
+    };
+
+    bool enqueue(const QByteArray& line);
+    bool dequeue(QByteArray* out);
+    //  false ʾsuppressed Ϊһڱ̵
+    bool allowByRate(quint64 key, int* suppressed);
+    void openFile();
+    void rotateIfNeeded();
+
+    Slot* m_slots = nullptr;
+    std::atomic<size_t> m_enqueuePos{ 0 };
+    size_t m_dequeuePos = 0;          // ֻд̷߳
+    std::atomic<size_t> m_writtenPos{ 0 };
+
+    RateBucket m_buckets[LOG_RATE_BUCKETS];
+    std::atomic<int> m_maxPerSecond{ 20 };
+    std::atomic<quint64> m_dropped{ 0 };
+    std::atomic<quint64> m_suppressedTotal{ 0 };
+    std::atomic<bool> m_echoToStderr{ false };
+    std::atomic<bool> m_stopped{ false };
+
+    // ֻд߳ʹãǰã
+    QString m_filePattern;
+    QString m_currentDate;
+    QFile m_file;
+    qint64 m_maxBytes = 10 * 1024 * 1024;
+    int m_maxBackups = 5;
+};
+
+#endif // ASYNCLOGGER_H
@@ -1,9 +1,9 @@
 #include "decodethread.h"
+#include "threadpolicy.h"
 #include <QDebug>
 #include <QElapsedTimer>
 #include "demuxthread.h"
-#include "rtspplayer.h"
-#include "screenshotthread.h"
+#include "videoformat.h"
 
 // ӲѡظʽĹؼص
 enum AVPixelFormat get_hw_format(AVCodecContext* ctx, const enum AVPixelFormat* pix_fmts)
@@ -19,8 +19,9 @@ enum AVPixelFormat get_hw_format(AVCodecContext* ctx, const enum AVPixelFormat*
 }
 
 DecodeThread::DecodeThread(QQueue<AVPacket*>* packetQueue, QMutex* queueMutex, QQueue<AVFrame*>* packetQueue2, QMutex* queueMutex2, QObject* parent)
-    : QThread(parent), m_packetQueue(packetQueue), m_queueMutex(queueMutex), m_showPackerQueue(packetQueue2),m_showMutex(queueMutex2)
+    : QThread(parent), m_packetQueue(packetQueue), m_queueMutex(queueMutex)
 {
+    m_showEdge.bind(packetQueue2, queueMutex2);
 }
 
 DecodeThread::~DecodeThread()
@@ -34,6 +35,91 @@ void DecodeThread::stop()
     m_stopped = true;
 }
 
+void DecodeThread::setDownscaleEnabled(bool enabled)
+{
+    m_downscaleEnabled = enabled;
+}
+
+void DecodeThread::setDisplaySize(int width, int height)
+{
+    m_displayW = width;
+    m_displayH = height;
+}
+
+void DecodeThread::setFramePublishing(const QString& key, int slotCount)
+{
+    QMutexLocker locker(&m_publishMutex);
+    m_pendingPublishKey = key;
+    m_pendingPublishSlots = slotCount;
+    m_publishDirty = true;
+}
+
+void DecodeThread::applyFramePublishing()
+{
+    QMutexLocker locker(&m_publishMutex);
+    if (m_publishDirty) {
+        m_publishDirty = false;
+        //  key رʱͷžɵĹڴΣһ֡´
+        m_publisher.close();
+        m_publisher.setKey(m_pendingPublishKey, m_pendingPublishSlots);
+    }
+}
+
+void DecodeThread::setThreadAutoTune(bool enabled)
+{
+    m_autoTune = enabled;
+}
+
+DecoderStats DecodeThread::decoderStats() const
+{
+    DecoderStats stats = m_tuner.stats();
+    stats.hardware = m_isHardware;
+    stats.autoTune = m_autoTune && !m_isHardware;
+    stats.threadCount = m_threadCount;
+    stats.threadType = m_threadType;
+    return stats;
+}
+
+void DecodeThread::setMotionOptions(const MotionOptions& options)
+{
+    QMutexLocker locker(&m_motionMutex);
+    m_pendingMotion = options;
+    m_motionDirty = true;
+}
+
+void DecodeThread::setShowEnabled(bool enabled)
+{
+    m_showEnabled = enabled;
+}
+
+void DecodeThread::applyMotionOptions()
+{
+    QMutexLocker locker(&m_motionMutex);
+    if (m_motionDirty) {
+        m_motionDirty = false;
+        m_motion.setOptions(m_pendingMotion);
+    }
+}
+
+void DecodeThread::detectMotion(const AVFrame* frame, bool sample)
+{
+    // ֡ڳСYƽ֡4KĿԺ
+    // Ƿ֮ǰ;ã֡Ϊƶ
+    if (!sample) {
+        return;
+    }
+    double level = m_motion.process(frame);
+    if (level < 0.0) {
+        return;
+    }
+    bool changed = false;
+    m_motion.updateState(level, &changed);
+    if (changed) {
+        qDebug() << "Motion" << (m_motion.isActive() ? "started" : "stopped") << "level" << level;
+        emit sigMotionChanged(m_motion.isActive(), level);
+    }
+}
+
 bool DecodeThread::initHardwareDecoder(AVCodecParameters* params)
 {
     // 1. ҽ
@@ -73,10 +159,52 @@ bool DecodeThread::initHardwareDecoder(AVCodecParameters* params)
         return false;
     }
 
+    m_threadCount = m_codecCtx->thread_count;
+    m_threadType = m_codecCtx->active_thread_type;
     qDebug() << "Hardware decoder initialized successfully (D3D11VA).";
     return true;
 }
 
+bool DecodeThread::initSoftwareDecoder(AVCodecParameters* params)
+{
+    const AVCodec* codec = avcodec_find_decoder(params->codec_id);
+    if (!codec) {
+        qCritical() << "Failed to find decoder for codec" << params->codec_id;
+        return false;
+    }
+
+    m_codecCtx = avcodec_alloc_context3(codec);
+    if (!m_codecCtx) {
+        qCritical() << "Failed to alloc codec context.";
+        return false;
+    }
+
+    if (avcodec_parameters_to_context(m_codecCtx, params) < 0) {
+        qCritical() << "Failed to copy codec parameters to decoder context.";
+        return false;
+    }
+
+    // ߳ñ avcodec_open2 ֮ǰ
+    if (m_autoTune) {
+        m_tuner.apply(m_codecCtx);
+    }
+    else {
+        m_codecCtx->thread_count = 0; // FFmpegCPU
+        m_codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+
+    if (avcodec_open2(m_codecCtx, codec, nullptr) < 0) {
+        qCritical() << "Failed to open codec.";
+        return false;
+    }
+
+    m_threadCount = m_codecCtx->thread_count;
+    m_threadType = m_codecCtx->active_thread_type;
+    qDebug() << "Software decoder initialized, threads:" << m_codecCtx->thread_count
+             << "type:" << m_codecCtx->active_thread_type;
+    return true;
+}
+
 void DecodeThread::cleanup()
 {
     if (m_codecCtx) {
@@ -87,14 +215,136 @@ void DecodeThread::cleanup()
         av_buffer_unref(&m_hwDeviceCtx);
         m_hwDeviceCtx = nullptr;
     }
+    m_tuner.release();
 }
-void DecodeThread::run()
+
+// ȡѾõ֡ȥʾ֡ƶ֡ȡ֡ʱۼӵ *decodeNs
+int DecodeThread::receiveFrames(AVFrame* hw_frame, AVFrame* sw_frame, AVRational timeBase, qint64* decodeNs)
 {
     const int MAX_FRAME_QUEUE_SIZE = 15;
+    QElapsedTimer decodeTimer;
+    int decodedFrames = 0;
+    int ret = 0;
+    while (ret >= 0) {
+        decodeTimer.start();
+        ret = avcodec_receive_frame(m_codecCtx, hw_frame);
+        *decodeNs += decodeTimer.nsecsElapsed();
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        }
+        else if (ret < 0) {
+            break;
+        }
+        decodedFrames++;
+
+        // תĿ֮ǰֻ֡οҲʾ
+        if (m_skipUntilPts != AV_NOPTS_VALUE) {
+            if (hw_frame->best_effort_timestamp != AV_NOPTS_VALUE && hw_frame->best_effort_timestamp < m_skipUntilPts) {
+                av_frame_unref(hw_frame);
+                continue;
+            }
+            m_skipUntilPts = AV_NOPTS_VALUE;
+        }
+
+        // û˿桢֡ûߡһ֡ƶҲҪ֡ʱʡGPU->CPUĿ
+        const bool motionSample = m_motion.options().enabled && m_motion.shouldSample();
+        if (!m_showEnabled && !m_frameOutput.isConnected() && !motionSample && !m_publisher.isEnabled()) {
+            av_frame_unref(hw_frame);
+            continue;
+        }
+
+        // ֡ûбִкİ
+        int transfer_ret = 0;
+        if (hw_frame->hw_frames_ctx) {
+            transfer_ret = av_hwframe_transfer_data(sw_frame, hw_frame, 0);
+            av_frame_unref(hw_frame); // Ӳ֡ͷ
+        }
+        else {
+            av_frame_move_ref(sw_frame, hw_frame); // ֡ڴ
+        }
+
+        if (transfer_ret < 0) {
+            qWarning() << "Error transferring frame data from GPU to CPU.";
+            continue;
+        }
+
+        if (!sw_frame->data[0] || !sw_frame->data[1]) {
+            qWarning() << "Transferred frame data pointers are NULL!";
+            continue;
+        }
+
+        detectMotion(sw_frame, motionSample);
+        m_publisher.publish(sw_frame, timeBase);
+
+        // ֡ϵߣͼȣһ
+        if (m_frameOutput.isConnected()) {
+            AVFrame* outputFrame = av_frame_clone(sw_frame);
+            if (outputFrame) {
+                outputFrame->time_base = timeBase;  // ֶΣ߰ʱ
+                m_frameOutput.push(outputFrame);
+            }
+        }
+
+        if (!m_showEnabled) {
+            av_frame_unref(sw_frame);
+            continue;
+        }
+
+        if (m_displayOwner) {
+            if (m_claimDisplay.exchange(false)) {
+                m_displayOwner->store(m_displayId);
+                emit sigDisplayClaimed(m_displayId);
+            }
+            else if (m_displayOwner->load() != m_displayId) {
+                av_frame_unref(sw_frame);
+                continue;
+            }
+        }
+
+        if (m_showEdge.size() > MAX_FRAME_QUEUE_SIZE)
+        {
+            av_frame_unref(sw_frame);
+            metricsAdd(m_metrics, &StreamMetrics::framesDropped);
+            qDebug() << "Drop one frame";
+            continue;
+        }
+
+        // ʾڱƵСʱСÿ֡ϴ4K
+        // ȾֱʾĸʽԭֻټĸʽתNV12
+        AVFrame* frame_to_emit = nullptr;
+        int dstW = sw_frame->width, dstH = sw_frame->height;
+        bool needScale = m_downscaleEnabled
+            && FrameScaler::fitSize(sw_frame->width, sw_frame->height, m_displayW, m_displayH, &dstW, &dstH);
+        bool renderable = isRenderableFormat((AVPixelFormat)sw_frame->format);
+        if (needScale || !renderable)
+        {
+            frame_to_emit = m_scaler.scale(sw_frame, dstW, dstH, renderable ? AV_PIX_FMT_NONE : AV_PIX_FMT_NV12);
+        }
+        if (!frame_to_emit)
+        {
+            // ʹ av_frame_clone תȨȷ̰߳ȫ
+            frame_to_emit = av_frame_clone(sw_frame);
+        }
+        av_frame_unref(sw_frame);
+
+        if (frame_to_emit) {
+            metricsSet(m_metrics, &StreamMetrics::showQueueDepth, m_showEdge.enqueue(frame_to_emit));
+            if (!m_firstFrameShown) {
+                m_firstFrameShown = true;
+                emit sigFirstFrameShown();
+            }
+        }
+    }
+    return decodedFrames;
+}
+
+void DecodeThread::run()
+{
+    ThreadPolicyScope policyScope(StageDecode);
     // ȴ DemuxThread ʼ
     DemuxThread* demux = nullptr;
     while (!m_stopped) {
-        demux = parent()->findChild<DemuxThread*>();
+        demux = m_source ? m_source : parent()->findChild<DemuxThread*>();
         if (demux && demux->videoStream()) {
             break;
         }
@@ -102,10 +352,22 @@ void DecodeThread::run()
     }
     if (m_stopped || !demux) return;
 
-    if (!initHardwareDecoder(demux->videoStream()->codecpar)) {
+    m_scaler.setThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+
+    AVCodecParameters* codecpar = demux->videoStream()->codecpar;
+    const AVRational frameRate = demux->videoStream()->avg_frame_rate;
+    m_tuner.begin(frameRate.num > 0 && frameRate.den > 0 ? av_q2d(frameRate) : 0.0);
+
+    m_isHardware = initHardwareDecoder(codecpar);
+    if (!m_isHardware) {
         cleanup();
-        return;
+        qWarning() << "Hardware decoder unavailable, falling back to software decoding.";
+        if (!initSoftwareDecoder(codecpar)) {
+            cleanup();
+            return;
+        }
     }
+    m_tuner.setTuningEnabled(m_autoTune && !m_isHardware);
 
     AVFrame* hw_frame = av_frame_alloc();     // Ӳ֡ (GPU)
     AVFrame* sw_frame = av_frame_alloc();     // GPUصCPU֡ (NV12ʽ)
@@ -136,104 +398,80 @@ void DecodeThread::run()
             }
         }
 
-        int ret = avcodec_send_packet(m_codecCtx, packet);
-        av_packet_free(&packet);
-
-        if (ret < 0) {
-            continue;
+        if (m_flushRequested.exchange(false)) {
+            avcodec_flush_buffers(m_codecCtx);
+            m_waitKeyAfterFlush = true;
+            m_skipUntilPts = m_flushSkipPts;
+        }
+        if (m_waitKeyAfterFlush) {
+            if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                av_packet_free(&packet);
+                continue;
+            }
+            m_waitKeyAfterFlush = false;
         }
 
-        while (ret >= 0) {
-            ret = avcodec_receive_frame(m_codecCtx, hw_frame);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                break;
+        // ߳Ҫ´򿪽ڹؼ֡л⻨
+        if (m_hasPendingConfig && (packet->flags & AV_PKT_FLAG_KEY)) {
+            m_hasPendingConfig = false;
+            // Ϳհѽﻺ̡֡֡߳B֡ţȫȡÿε֡
+            qint64 drainNs = 0;
+            if (avcodec_send_packet(m_codecCtx, nullptr) >= 0) {
+                receiveFrames(hw_frame, sw_frame, timeBase, &drainNs);
             }
-            else if (ret < 0) {
+            m_tuner.acceptConfig(m_pendingConfig);
+            avcodec_free_context(&m_codecCtx);
+            if (!initSoftwareDecoder(codecpar)) {
+                av_packet_free(&packet);
                 break;
             }
+        }
 
-            // ֡ûбִкİ
-            int transfer_ret = av_hwframe_transfer_data(sw_frame, hw_frame, 0);
-            av_frame_unref(hw_frame); // Ӳ֡ͷ
+        applyMotionOptions();
+        applyFramePublishing();
 
-            if (transfer_ret < 0) {
-                qWarning() << "Error transferring frame data from GPU to CPU.";
+        // ʡģʽ֡ˡƶ⡢֡Ҫÿһ֡ʱճ
+        const bool idleKeyOnly = m_idle && !m_frameOutput.isConnected() && !m_motion.options().enabled && !m_publisher.isEnabled();
+        const AVDiscard skipFrame = (m_keyframeOnly || idleKeyOnly) ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+        if (m_codecCtx->skip_frame != skipFrame) {
+            // ֻؼ֡ڼ֡Ǻ֡ĲοָȫҪȵһؼ֡
+            if (skipFrame == AVDISCARD_DEFAULT && !(packet->flags & AV_PKT_FLAG_KEY)) {
+                av_packet_free(&packet);
                 continue;
             }
+            m_codecCtx->skip_frame = skipFrame;
+        }
 
-            if (!sw_frame->data[0] || !sw_frame->data[1]) {
-                qWarning() << "Transferred frame data pointers are NULL!";
-                continue;
-            }
+        QElapsedTimer decodeTimer;
+        decodeTimer.start();
+        int ret = avcodec_send_packet(m_codecCtx, packet);
+        qint64 decodeNs = decodeTimer.nsecsElapsed();
+        av_packet_free(&packet);
 
-            /// <ͼ>
-            if (m_screenshotFlag.load())
-            {
-                // ʹ compare_exchange ȷֻһһͼ
-                bool expected = true;
-                if (m_screenshotFlag.compare_exchange_strong(expected, false)) {
-
-                    // Ϊ¡һ֡Ϊsw_frameѭлᱻ
-                    AVFrame* frame_for_screenshot = av_frame_clone(sw_frame);
-
-                    if (frame_for_screenshot) {
-                        QString path;
-                        {
-                            QMutexLocker locker(&m_screenshotMutex);
-                            path = m_screenshotPath;
-                        }
-
-                        // ýͼ߳
-                        ScreenshotThread* workerThread = new ScreenshotThread(frame_for_screenshot, path);
-
-                        // ؼ1߳̽Զɾ󣬷ֹڴй©
-                        connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
-
-                        // ؼ2ͼźӵRTSPPlayer
-                        RTSPPlayer* player = qobject_cast<RTSPPlayer*>(parent());
-                        if (player) {
-                            connect(workerThread, &ScreenshotThread::screenshotSaved, player, &RTSPPlayer::onScreenshotFinished, Qt::QueuedConnection);
-                        }
-
-                        // ߳
-                        workerThread->start();
-                    }
-                }
-            }
-            /// </summary>
+        if (ret < 0) {
+            continue;
+        }
 
-            m_showMutex->lock();
-            if(m_showPackerQueue->size() > MAX_FRAME_QUEUE_SIZE)
-            {
-                av_frame_unref(sw_frame);
-                m_showMutex->unlock();
-                qDebug() << "Drop one frame";
-                continue;
-            }else
-            {
+        const int decodedFrames = receiveFrames(hw_frame, sw_frame, timeBase, &decodeNs);
 
-                // ʹ av_frame_clone תȨȷ̰߳ȫ
-                AVFrame* frame_to_emit = av_frame_clone(sw_frame);
-                if (frame_to_emit) {
-                    m_showPackerQueue->enqueue(frame_to_emit);
-                }
-                m_showMutex->unlock();
-                av_frame_unref(sw_frame);
+        metricsAdd(m_metrics, &StreamMetrics::decodeTimeUs, decodeNs / 1000);
+        if (decodedFrames > 0) {
+            metricsAdd(m_metrics, &StreamMetrics::framesDecoded, decodedFrames);
+        }
+        // ֻؼ֡ʱ֡ʱƫߣΪ߳
+        if (decodedFrames > 0 && skipFrame == AVDISCARD_DEFAULT) {
+            DecoderThreadConfig next;
+            if (m_tuner.addSample(decodeNs / 1000 / decodedFrames, &next)) {
+                m_pendingConfig = next;
+                m_hasPendingConfig = true;
             }
         }
     }
 
     av_frame_free(&hw_frame);
     av_frame_free(&sw_frame);
+    m_publisher.close();
     cleanup();
     qDebug() << "Decode thread finished.";
 }
 
-
-void DecodeThread::onScreenshotRequested(const QString& filePath)
-{
-    QMutexLocker locker(&m_screenshotMutex);
-    m_screenshotPath = filePath;
-    m_screenshotFlag = true; // ԭӵñ־֪ͨrun()ѭ
-    qDebug() << "DecodeThread: Screenshot request received for" << filePath;
-}
\ No newline at end of file
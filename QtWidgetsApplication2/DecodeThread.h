@@ -4,6 +4,14 @@
 #include <QThread>
 #include <QQueue>
 #include <QMutex>
+#include <atomic>
+
+#include "framescaler.h"
+#include "decodertuner.h"
+#include "motiondetector.h"
+#include "pipelinemetrics.h"
+#include "framepublisher.h"
+#include "stagegraph.h"
 
 extern "C" {
 #include "libavcodec/avcodec.h"
@@ -11,6 +19,8 @@ extern "C" {
 #include "libavutil/pixdesc.h"
 }
 
+class DemuxThread;
+
 class DecodeThread : public QThread
 {
     Q_OBJECT
@@ -20,31 +30,120 @@ public:
 
     void stop();
 
-public slots:
-    void onScreenshotRequested(const QString& filePath);
+    // Դ start() ǰãʱʹøµ DemuxThread
+    void setSource(DemuxThread* demux) { m_source = demux; }
+
+    // ţʾߴ֡0x0 ʾʹԭʼֱ
+    void setDownscaleEnabled(bool enabled);
+    void setDisplaySize(int width, int height);
+
+    // ʱݽʱԶѡ߳߳ģʽ start() ǰ
+    void setThreadAutoTune(bool enabled);
+    DecoderStats decoderStats() const;
+
+    // رպ֡صCPUʾУͼƶ⣩
+    void setShowEnabled(bool enabled);
+
+    // ƶ޸
+    void setMotionOptions(const MotionOptions& options);
+
+    // ڴͳƣ start() ǰ
+    void setMetrics(StreamMetrics* metrics) { m_metrics = metrics; }
+
+    // ѽ֡NV12ڴ滷̶ȡkey Ϊձʾرգ޸ģһ֡Ч
+    void setFramePublishing(const QString& key, int slotCount);
+    FramePublishStats framePublishStats() const { return m_publisher.stats(); }
+
+    // 䣨ʱת/صֱ/¼طתʱսڲ֮֡ӹؼ֡ʼ
+    // skipUntilPts ЧʱPTS ֻ֡벻תؼ֮֡λã
+    void requestFlush(int64_t skipUntilPts = AV_NOPTS_VALUE)
+    {
+        m_flushSkipPts = skipUntilPts;
+        m_flushRequested = true;
+    }
+
+    // ̹߳һʾʱ/лֻ *owner == id ߳֡
+    // claimDisplay ֮ĵһ֡ʾȨе̲߳ sigDisplayClaimedл߽֡ϲ
+    void setDisplayOwner(std::atomic<int>* owner, int id) { m_displayOwner = owner; m_displayId = id; }
+    void claimDisplay() { m_claimDisplay = true; }
+
+    // /ʱֻؼ֡skip_frame = AVDISCARD_NONKEYл
+    void setKeyframeOnly(bool enabled) { m_keyframeOnly = enabled; }
+
+    // 治ɼС/ؼأʱʡģʽûҪÿһ֡ʱֻؼ֡
+    // ʾ setShowEnabled صָһؼ֡ʼȫ
+    void setIdle(bool idle) { m_idle = idle; }
+
+    // ֱʵĽ֡صڴ棩ͼ߰Լı߽
+    // ûбʱΪ֡ÿһֻһ֡ã֡ time_base Ϊʱ
+    FramePort* frameOutput() { return &m_frameOutput; }
 
 protected:
     void run() override;
 signals:
     void sigGetFirstFrame();
+    // ƶ״̬仯active Ϊ true ʾʼƶlevel Ϊ仯ռ
+    void sigMotionChanged(bool active, double level);
+    void sigDisplayClaimed(int id);
+    // һ֡ʾУͳлʱ
+    void sigFirstFrameShown();
 private:
     bool initHardwareDecoder(AVCodecParameters* params);
+    bool initSoftwareDecoder(AVCodecParameters* params);
+    void applyMotionOptions();
+    void applyFramePublishing();
+    void detectMotion(const AVFrame* frame, bool sample);
+    int receiveFrames(AVFrame* hw_frame, AVFrame* sw_frame, AVRational timeBase, qint64* decodeNs);
     void cleanup();
 
     QQueue<AVPacket*>* m_packetQueue;
     QMutex* m_queueMutex;
-    QQueue<AVFrame*>* m_showPackerQueue;
-    QMutex* m_showMutex;
+    FrameEdge m_showEdge;   // ʾϣǷĶ֡߼
+    FramePort m_frameOutput;
 
     volatile bool m_stopped = false;
 
     AVCodecContext* m_codecCtx = nullptr;
     AVBufferRef* m_hwDeviceCtx = nullptr;
 
-    std::atomic<bool> m_screenshotFlag;
-    QString m_screenshotPath;
-    QMutex m_screenshotMutex;
+    std::atomic<bool> m_isHardware{ false };
+    std::atomic<bool> m_autoTune{ false };
+    std::atomic<int> m_threadCount{ 0 };
+    std::atomic<int> m_threadType{ 0 };
+    DecoderTuner m_tuner;
+    DecoderThreadConfig m_pendingConfig;
+    bool m_hasPendingConfig = false;
+
+    StreamMetrics* m_metrics = nullptr;
+    FramePublisher m_publisher;
+    QString m_pendingPublishKey;
+    int m_pendingPublishSlots = 4;
+    bool m_publishDirty = false;
+    QMutex m_publishMutex;
+    std::atomic<bool> m_flushRequested{ false };
+    std::atomic<int64_t> m_flushSkipPts{ AV_NOPTS_VALUE };
+    bool m_waitKeyAfterFlush = false;
+    std::atomic<bool> m_keyframeOnly{ false };
+    std::atomic<bool> m_idle{ false };
+    DemuxThread* m_source = nullptr;
+    std::atomic<int>* m_displayOwner = nullptr;
+    int m_displayId = 0;
+    std::atomic<bool> m_claimDisplay{ false };
+    int64_t m_skipUntilPts = AV_NOPTS_VALUE;
+
+    MotionDetector m_motion;
+    MotionOptions m_pendingMotion;
+    bool m_motionDirty = false;
+    QMutex m_motionMutex;
+
+    std::atomic<bool> m_showEnabled{ true };
+    std::atomic<bool> m_downscaleEnabled{ false };
+    std::atomic<int> m_displayW{ 0 };
+    std::atomic<int> m_displayH{ 0 };
+    FrameScaler m_scaler;
+
     bool m_bSendSig = true;//ǷҪźŸUIһ֡Ѿ
+    bool m_firstFrameShown = false;
 
 };
 
@@ -0,0 +1,184 @@
+#include "decodertuner.h"
+#include <QDebug>
+#include <QThread>
+#include <algorithm>
+
+static const int SAMPLE_WINDOW = 120;   // ͳƴڴС
+static const int EVALUATE_EVERY = 60;   // ÿ֡һ
+static const int MAX_RETUNES = 6;       // 
+static const int STABLE_WINDOWS = 3;    // ٸҪֹͣ
+
+std::atomic<int> DecoderTuner::s_coreBudget(0);
+std::atomic<int> DecoderTuner::s_coresInUse(0);
+
+DecoderTuner::DecoderTuner()
+{
+    m_samples.resize(SAMPLE_WINDOW);
+}
+
+DecoderTuner::~DecoderTuner()
+{
+    release();
+}
+
+void DecoderTuner::setProcessCoreBudget(int cores)
+{
+    s_coreBudget = cores;
+}
+
+int DecoderTuner::processCoreBudget()
+{
+    int budget = s_coreBudget.load();
+    return budget > 0 ? budget : QThread::idealThreadCount();
+}
+
+int DecoderTuner::acquireCores(int wanted)
+{
+    // ٸһ̣߳Ԥھ
+    int budget = processCoreBudget();
+    int inUse = s_coresInUse.load();
+    int granted;
+    do {
+        granted = qBound(1, qMin(wanted, budget - inUse), wanted);
+    } while (!s_coresInUse.compare_exchange_weak(inUse, inUse + granted));
+    return granted;
+}
+
+void DecoderTuner::release()
+{
+    if (m_coresHeld > 0) {
+        s_coresInUse -= m_coresHeld;
+        m_coresHeld = 0;
+    }
+}
+
+void DecoderTuner::begin(double frameRate)
+{
+    m_frameRate = frameRate > 1.0 ? frameRate : 25.0;
+    m_sampleIndex = 0;
+    m_sampleCount = 0;
+    m_sinceEvaluate = 0;
+    m_stableWindows = 0;
+    m_retunes = 0;
+
+    m_config.threadType = FF_THREAD_SLICE;
+    m_config.threadCount = qMin(4, processCoreBudget());
+    m_p50Ms = m_p95Ms = m_p99Ms = 0.0;
+    publishStats();
+}
+
+void DecoderTuner::apply(AVCodecContext* ctx)
+{
+    release();
+    m_coresHeld = acquireCores(m_config.threadCount);
+    m_config.threadCount = m_coresHeld;
+
+    ctx->thread_count = m_config.threadCount;
+    ctx->thread_type = m_config.threadType;
+    qDebug() << "DecoderTuner: threads" << ctx->thread_count
+             << (m_config.threadType == FF_THREAD_FRAME ? "frame" : "slice")
+             << "budget" << processCoreBudget() << "in use" << s_coresInUse.load();
+    publishStats();
+}
+
+void DecoderTuner::acceptConfig(const DecoderThreadConfig& config)
+{
+    m_config = config;
+    m_sampleIndex = 0;
+    m_sampleCount = 0;
+    m_sinceEvaluate = 0;
+    m_retunes++;
+    publishStats();
+}
+
+void DecoderTuner::updatePercentiles()
+{
+    QVector<qint64> sorted = m_samples.mid(0, m_sampleCount);
+    std::sort(sorted.begin(), sorted.end());
+
+    auto at = [&](double p) {
+        int idx = qBound(0, (int)(p * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+        return sorted[idx] / 1000.0;
+    };
+
+    m_p50Ms = at(0.50);
+    m_p95Ms = at(0.95);
+    m_p99Ms = at(0.99);
+    publishStats();
+}
+
+void DecoderTuner::publishStats()
+{
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.autoTune = true;
+    m_stats.threadCount = m_config.threadCount;
+    m_stats.threadType = m_config.threadType;
+    m_stats.frameRate = m_frameRate;
+    m_stats.p50Ms = m_p50Ms;
+    m_stats.p95Ms = m_p95Ms;
+    m_stats.p99Ms = m_p99Ms;
+    m_stats.samples = m_sampleCount;
+    m_stats.retunes = m_retunes;
+}
+
+bool DecoderTuner::addSample(qint64 decodeUs, DecoderThreadConfig* next)
+{
+    m_samples[m_sampleIndex] = decodeUs;
+    m_sampleIndex = (m_sampleIndex + 1) % SAMPLE_WINDOW;
+    if (m_sampleCount < SAMPLE_WINDOW) {
+        m_sampleCount++;
+    }
+
+    if (++m_sinceEvaluate < EVALUATE_EVERY) {
+        return false;
+    }
+    m_sinceEvaluate = 0;
+    updatePercentiles();
+
+    if (!m_tuningEnabled || m_retunes >= MAX_RETUNES || m_stableWindows >= STABLE_WINDOWS) {
+        return false;
+    }
+
+    const double budgetMs = 1000.0 / m_frameRate;
+    const double p95 = m_p95Ms;
+
+    const int maxThreads = processCoreBudget();
+    DecoderThreadConfig wanted = m_config;
+
+    if (p95 > budgetMs * 0.8) {
+        // ֡ʣȼƬ̣߳Ƭ߳ѵ޻Чʱ֡߳
+        if (m_config.threadType == FF_THREAD_SLICE && m_config.threadCount < maxThreads && m_retunes < 2) {
+            wanted.threadCount = qMin(maxThreads, m_config.threadCount * 2);
+        }
+        else if (m_config.threadType == FF_THREAD_SLICE) {
+            wanted.threadType = FF_THREAD_FRAME;
+            wanted.threadCount = qMin(maxThreads, qMax(2, m_config.threadCount));
+        }
+        else if (m_config.threadCount < maxThreads) {
+            wanted.threadCount = qMin(maxThreads, m_config.threadCount + 2);
+        }
+    }
+    else if (p95 < budgetMs * 0.35 && m_config.threadCount > 1) {
+        // ܴ󣺹黹ĸ
+        wanted.threadCount = qMax(1, m_config.threadCount / 2);
+        if (wanted.threadType == FF_THREAD_FRAME && wanted.threadCount <= 2) {
+            wanted.threadType = FF_THREAD_SLICE; // ߳ʱֻ֡߳ӳ
+        }
+    }
+
+    if (wanted.threadCount == m_config.threadCount && wanted.threadType == m_config.threadType) {
+        m_stableWindows++;
+        return false;
+    }
+
+    m_stableWindows = 0;
+    qDebug() << "DecoderTuner: p95" << p95 << "ms, frame budget" << budgetMs << "ms -> retune";
+    *next = wanted;
+    return true;
+}
+
+DecoderStats DecoderTuner::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
@@ -0,0 +1,90 @@
+#ifndef DECODERTUNER_H
+#define DECODERTUNER_H
+
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+// ߳
+struct DecoderThreadConfig
+{
+    int threadCount = 1;
+    int threadType = FF_THREAD_SLICE; // FF_THREAD_SLICE ӳٵͣFF_THREAD_FRAME ¸ߵÿ̶߳һ֡ӳ
+};
+
+// Ⱪ¶Ľͳ
+struct DecoderStats
+{
+    bool hardware = false;
+    bool autoTune = false;
+    int threadCount = 0;
+    int threadType = 0;
+    double frameRate = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    int samples = 0;
+    int retunes = 0;
+};
+
+// ÿ֡ʱ֡Զѡ߳߳ģʽ
+// ʵһ̼CPUԤ
+class DecoderTuner
+{
+public:
+    DecoderTuner();
+    ~DecoderTuner();
+
+    static void setProcessCoreBudget(int cores);
+    static int processCoreBudget();
+
+    // ʼʱãʼãӳٵƬ̣߳
+    void begin(double frameRate);
+    // رʱֻͳƺʱλ飨ӲδԶţ
+    void setTuningEnabled(bool enabled) { m_tuningEnabled = enabled; }
+    // ѵǰдģ avcodec_open2 ֮ǰ
+    void apply(AVCodecContext* ctx);
+    // رʱ黹ռõĺ
+    void release();
+
+    // ¼һνʱ΢룩 true ʾл next 
+    bool addSample(qint64 decodeUs, DecoderThreadConfig* next);
+    void acceptConfig(const DecoderThreadConfig& config);
+
+    DecoderThreadConfig config() const { return m_config; }
+    DecoderStats stats() const;
+
+private:
+    void updatePercentiles();
+    void publishStats();
+    int acquireCores(int wanted);
+
+    static std::atomic<int> s_coreBudget;
+    static std::atomic<int> s_coresInUse;
+
+    DecoderThreadConfig m_config;
+    bool m_tuningEnabled = true;
+    int m_coresHeld = 0;
+    double m_frameRate = 25.0;
+
+    QVector<qint64> m_samples;   // Ľʱλ
+    int m_sampleIndex = 0;
+    int m_sampleCount = 0;
+    int m_sinceEvaluate = 0;
+    int m_stableWindows = 0;
+    int m_retunes = 0;
+
+    double m_p50Ms = 0.0;
+    double m_p95Ms = 0.0;
+    double m_p99Ms = 0.0;
+
+    // ߳д̶߳ͳƿ
+    mutable QMutex m_statsMutex;
+    DecoderStats m_stats;
+};
+
+#endif // DECODERTUNER_H
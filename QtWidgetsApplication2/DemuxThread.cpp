@@ -1,12 +1,21 @@
 #include "demuxthread.h"
+#include "threadpolicy.h"
 #include <QDebug>
+#include "timeshiftbuffer.h"
+
+#define MAX_GOP_CACHE_PACKETS 600   // Ԥӻޣʱһؼ֡¿ʼ
+#define MAX_DECODE_EDGE_PACKETS 1000    // ʱĻѹޣղһؼ֡ʼ
 
 DemuxThread::DemuxThread(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
     QQueue<AVPacket*>* recordQueue, QMutex* recordMutex,
     QObject* parent)
-    : QThread(parent), m_decodeQueue(decodeQueue), m_decodeMutex(decodeMutex),
-    m_recordQueue(recordQueue), m_recordMutex(recordMutex)
+    : QThread(parent), m_decodeEdge(MAX_DECODE_EDGE_PACKETS, EdgeResync)
 {
+    // ¼Ʋܶ¼Ʊ߲
+    m_decodeEdge.bind(decodeQueue, decodeMutex);
+    m_recordEdge.bind(recordQueue, recordMutex);
+    m_output.connect(&m_decodeEdge);
+    m_output.connect(&m_recordEdge);
 }
 
 DemuxThread::~DemuxThread()
@@ -19,16 +28,182 @@ void DemuxThread::start(const QString& url)
 {
     m_url = url;
     m_stopped = false;
+    m_interruptCallbackData.abort = false;
+    m_interruptCallbackData.onWait = nullptr;
     QThread::start();
 }
 
 void DemuxThread::stop()
 {
     m_stopped = true;
+    m_interruptCallbackData.abort = true;
+}
+
+void DemuxThread::setDecodeEnabled(bool enabled)
+{
+    m_decodeEdge.setEnabled(enabled);  // ´ʱӹؼ֡ʼŲỨ
+}
+
+void DemuxThread::waitDecodeKeyframe()
+{
+    m_decodeEdge.setWaitKeyframe(true);
+}
+
+void DemuxThread::setTimeshiftBuffer(TimeshiftBuffer* buffer)
+{
+    QMutexLocker locker(&m_outputMutex);
+    m_timeshift = buffer;
+}
+
+void DemuxThread::detachOutputs()
+{
+    QMutexLocker locker(&m_outputMutex);
+    m_decodeEdge.bind(nullptr, nullptr);
+    m_recordEdge.bind(nullptr, nullptr);
+    m_timeshift = nullptr;
+    m_metrics = nullptr;
+    m_decodeEdge.setEnabled(true);
+    m_decodeEdge.setWaitKeyframe(false);
+    m_gopCaching = true;
+}
+
+int64_t DemuxThread::attachOutputs(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+    QQueue<AVPacket*>* recordQueue, QMutex* recordMutex)
+{
+    QMutexLocker locker(&m_outputMutex);
+    m_decodeEdge.bind(decodeQueue, decodeMutex);
+    m_recordEdge.bind(recordQueue, recordMutex);
+    m_gopCaching = false;
+
+    // ӹؼ֡ʼֱӽŽ⣬õһؼ֡
+    int64_t lastPts = AV_NOPTS_VALUE;
+    if (!m_gopCache.isEmpty()) {
+        // B֡ʱ˳İһʾ˳ģȡPTS
+        for (const AVPacket* cached : m_gopCache) {
+            if (cached->pts != AV_NOPTS_VALUE && (lastPts == AV_NOPTS_VALUE || cached->pts > lastPts)) {
+                lastPts = cached->pts;
+            }
+        }
+        m_decodeEdge.setWaitKeyframe(false);
+        while (!m_gopCache.isEmpty()) {
+            m_decodeEdge.enqueue(m_gopCache.dequeue());
+        }
+    }
+    else {
+        m_decodeEdge.setWaitKeyframe(true);
+    }
+    return lastPts;
+}
+
+bool DemuxThread::startCapture(const QString& filePath)
+{
+    QMutexLocker locker(&m_outputMutex);
+    m_capturePath = filePath;
+    if (m_videoStream) {
+        return m_capture.open(filePath, m_videoStream);
+    }
+    return true;    // 򿪺ʼ
+}
+
+void DemuxThread::stopCapture()
+{
+    QMutexLocker locker(&m_outputMutex);
+    m_capturePath.clear();
+    m_capture.close();
+}
+
+bool DemuxThread::isCapturing() const
+{
+    QMutexLocker locker(&m_outputMutex);
+    return !m_capturePath.isEmpty();
+}
+
+int DemuxThread::cachedGopPackets() const
+{
+    QMutexLocker locker(&m_outputMutex);
+    return m_gopCache.size();
+}
+
+void DemuxThread::clearGopCache()
+{
+    while (!m_gopCache.isEmpty()) {
+        AVPacket* temp = m_gopCache.dequeue();
+        av_packet_free(&temp);
+    }
+}
+
+void DemuxThread::checkAlerts()
+{
+    StreamAnalysis analysis;
+    const quint32 changedAlerts = m_analyzer.checkThresholds(&analysis);
+    if (!changedAlerts) {
+        return;
+    }
+    const quint32 active = m_analyzer.activeAlerts();
+    for (quint32 bit = StreamAlertJitter; bit <= StreamAlertDiscontinuity; bit <<= 1) {
+        if (changedAlerts & bit) {
+            const double value = StreamAnalyzer::alertValue(analysis, StreamAlert(bit));
+            qWarning() << "Stream alert" << StreamAnalyzer::alertName(StreamAlert(bit))
+                << ((active & bit) ? "raised" : "cleared") << "value" << value;
+            emit sigStreamAlert(int(bit), (active & bit) != 0, value);
+        }
+    }
+}
+
+void DemuxThread::checkAlertsCallback(void* owner)
+{
+    static_cast<DemuxThread*>(owner)->checkAlerts();
+}
+
+void DemuxThread::distributePacket(AVPacket* packet)
+{
+    m_bytesRead.fetch_add(packet->size, std::memory_order_relaxed);
+    m_packetsRead.fetch_add(1, std::memory_order_relaxed);
+    metricsAdd(m_metrics, &StreamMetrics::packetsIn);
+    metricsAdd(m_metrics, &StreamMetrics::bytesIn, packet->size);
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        metricsAdd(m_metrics, &StreamMetrics::keyframesIn);
+    }
+
+    m_analyzer.addPacket(packet);
+    checkAlerts();
+
+    QMutexLocker outputLocker(&m_outputMutex);
+    if (m_timeshift) {
+        m_timeshift->append(packet);
+    }
+    if (m_capture.isOpen()) {
+        m_capture.write(packet);
+    }
+    if (m_gopCaching) {
+        // Ԥӣÿؼ֡¿ʼ棬ֻһGOP
+        if (packet->flags & AV_PKT_FLAG_KEY) {
+            clearGopCache();
+        }
+        if (!m_gopCache.isEmpty() || (packet->flags & AV_PKT_FLAG_KEY)) {
+            m_gopCache.enqueue(av_packet_clone(packet));
+        }
+        if (m_gopCache.size() > MAX_GOP_CACHE_PACKETS) {
+            clearGopCache();
+        }
+    }
+
+    // Ƹˣ¼Ʊ߸һãֻ¼ģʽʱƻطʱ߹رգû¼ƶУ
+    AVPacket* output = av_packet_alloc();
+    if (!output) {
+        return;
+    }
+    av_packet_move_ref(output, packet);
+    m_output.push(output);
+    if (m_metrics) {
+        metricsSet(m_metrics, &StreamMetrics::decodeQueueDepth, m_decodeEdge.size());
+        metricsSet(m_metrics, &StreamMetrics::recordQueueDepth, m_recordEdge.size());
+    }
 }
 
 void DemuxThread::run()
 {
+    ThreadPolicyScope policyScope(StageDemux);
     m_formatCtx = avformat_alloc_context();
     if (!m_formatCtx) 
     {
@@ -66,6 +241,7 @@ void DemuxThread::run()
         //  Լ߼߷һʧź 
         avformat_close_input(&m_formatCtx); // ȷ
         m_formatCtx = nullptr;
+        metricsAdd(m_metrics, &StreamMetrics::streamFailures);
         emit sigStreamFailed(u8"ʧܣȷǷַǷȷ");
         return;
     }
@@ -73,6 +249,7 @@ void DemuxThread::run()
     if (avformat_find_stream_info(m_formatCtx, nullptr) < 0) 
     {
         qCritical() << "Could not find stream information";
+        metricsAdd(m_metrics, &StreamMetrics::streamFailures);
         emit sigStreamFailed(u8"ȡϢʧ");
         return;
     }
@@ -84,6 +261,18 @@ void DemuxThread::run()
         return;
     }
     m_videoStream = m_formatCtx->streams[m_videoStreamIndex];
+    m_analyzer.reset(m_videoStream->time_base);
+    // ͳ¿ʼ֮ڵȴȡʱ澯ٳٲʱǰĶʱҲܴ澯
+    m_interruptCallbackData.owner = this;
+    m_interruptCallbackData.onWait = &DemuxThread::checkAlertsCallback;
+    {
+        QMutexLocker locker(&m_outputMutex);
+        if (!m_capturePath.isEmpty()) {
+            m_capture.open(m_capturePath, m_videoStream);
+        }
+    }
+    metricsAdd(m_metrics, &StreamMetrics::streamOpens);
+    emit sigStreamOpened();
 
     while (!m_stopped) 
     {
@@ -100,6 +289,7 @@ void DemuxThread::run()
             {
                 //Էֹͣ˷
                 qDebug() << "End of file reached.";
+                metricsAdd(m_metrics, &StreamMetrics::streamFailures);
                 emit sigStreamFailed(u8"ļ");
                 break;
             }
@@ -107,6 +297,7 @@ void DemuxThread::run()
             {
                 //ǶԷͻȻȻʱ
                 qCritical() << "av_read_frame timed out by interrupt callback. Stream seems to be dead.";
+                metricsAdd(m_metrics, &StreamMetrics::streamFailures);
                 emit sigStreamFailed(u8"ӳʱֹ");
                 break; // ˳ѭ
             }
@@ -116,6 +307,7 @@ void DemuxThread::run()
                 char errbuf[1024] = { 0 };
                 av_strerror(ret, errbuf, sizeof(errbuf));
                 qWarning() << "av_read_frame error:" << errbuf;
+                metricsAdd(m_metrics, &StreamMetrics::streamFailures);
                 emit sigStreamFailed(u8"ӣ߶Ͽáֹ");
                 break; 
             }
@@ -123,23 +315,18 @@ void DemuxThread::run()
 
         if (packet->stream_index == m_videoStreamIndex) 
         {
-            // Ϊп¡һ
-            AVPacket* decodePacket = av_packet_clone(packet);
-            m_decodeMutex->lock();
-            m_decodeQueue->enqueue(decodePacket);
-            m_decodeMutex->unlock();
-
-            // Ϊ¼ƶп¡һ
-            AVPacket* recordPacket = av_packet_clone(packet);
-            m_recordMutex->lock();
-            m_recordQueue->enqueue(recordPacket);
-            m_recordMutex->unlock();
+            distributePacket(packet);
         }
 
         av_packet_unref(packet);
         av_packet_free(&packet);
     }
 
+    {
+        QMutexLocker locker(&m_outputMutex);
+        clearGopCache();
+        m_capture.close();
+    }
     if (m_formatCtx) 
     {
         avformat_close_input(&m_formatCtx);
@@ -7,6 +7,14 @@
 #include <QQueue>
 #include <QMutex>
 #include <QDebug>
+#include <atomic>
+
+#include "pipelinemetrics.h"
+#include "streamanalyzer.h"
+#include "packetcapture.h"
+#include "stagegraph.h"
+
+class TimeshiftBuffer;
 
 extern "C" {
 #include "libavformat/avformat.h"
@@ -17,6 +25,10 @@ extern "C" {
 struct InterruptCallbackData {
     QElapsedTimer timer;
     long timeout_ms = -1; // ʱʱ䣬λ
+    std::atomic<bool> abort{ false }; // ̱߳Ҫֹͣʱжȡ
+    // ȡڼ FFmpeg ᷴûص澯ʱҲûа飩
+    void (*onWait)(void* owner) = nullptr;
+    void* owner = nullptr;
 };
 
 // 2. 徲̬Ļص
@@ -29,6 +41,14 @@ static int interrupt_callback(void* ctx)
         return 0; // ûṩݣж
     }
 
+    if (data->abort) {
+        return 1;
+    }
+
+    if (data->onWait) {
+        data->onWait(data->owner);
+    }
+
     if (data->timer.hasExpired(data->timeout_ms)) {
         qDebug() << "Interrupt callback: Timeout detected!";
         return 1; // 1ʾж
@@ -48,23 +68,85 @@ public:
     void start(const QString& url);
     void stop();
     AVStream* videoStream() const { return m_videoStream; }
+
+    // رպͰֻ¼ģʽ´ʱһؼ֡ʼ
+    void setDecodeEnabled(bool enabled);
+    // һؼ֮֡ǰİӹؼ֡ʼ⣨½ĽѾܵʱ
+    void waitDecodeKeyframe();
+
+    // Ƶˣ¼һֱ棬ߣתơٽԼı
+    // ÿһֻһΰã
+    PacketPort* packetOutput() { return &m_output; }
+    // ߻ѹ౻ͬʱİ
+    quint64 decodePacketsDropped() const { return m_decodeEdge.dropped(); }
+
+    // ͳƣ̶߳ȡ
+    quint64 bytesRead() const { return m_bytesRead; }
+    quint64 packetsRead() const { return m_packetsRead; }
+
+    // ڴͳƣлԤӵӹʱ
+    void setMetrics(StreamMetrics* metrics) { m_metrics = metrics; }
+
+    // ԤӣStandbyPoolκζͰֻؼ֡ʼһGOP
+    void detachOutputs();
+    // ӹܣϽ/¼ƶУGOPŽУ֮İַ
+    // ػPTSһ֡ûлʱΪ AV_NOPTS_VALUE֮ǰֻ֡ʾ»
+    int64_t attachOutputs(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+        QQueue<AVPacket*>* recordQueue, QMutex* recordMutex);
+    bool isOpened() const { return m_videoStream != nullptr && isRunning(); }
+    int cachedGopPackets() const;
+
+    // ʱƻ壺ÿƵͬʱ׷ӵУ
+    // غ⸴̲߳ٷʾɵĻ壬߿ͷ
+    void setTimeshiftBuffer(TimeshiftBuffer* buffer);
+
+    // ͳƣﶶʡGOPȡؼ֡Сʱ̶߳ȡ
+    StreamAnalysis streamAnalysis(double windowSec = 5.0) const { return m_analyzer.analysis(windowSec); }
+    void setStreamThresholds(const StreamThresholds& thresholds) { m_analyzer.setThresholds(thresholds); }
+
+    // ץһؼ֡ʼƵͬʱд filePathûʱȴ򿪺ʼ
+    bool startCapture(const QString& filePath);
+    void stopCapture();
+    bool isCapturing() const;
 signals:
     void sigStreamFailed(QString error);
+    void sigStreamOpened();  // ҵƵ֮ videoStream() Ч
+    // ֵactive Ϊ trueָʱalert Ϊ StreamAlertvalue ΪӦͳֵ
+    void sigStreamAlert(int alert, bool active, double value);
 protected:
     void run() override;
+    void clearGopCache();
+    // ַһƵͳơץʱơԤӻ棬󽻸ˣReplayThread Ҳ
+    // ñߣֻ֮ͷſհ
+    void distributePacket(AVPacket* packet);
+    // ֵͳƣ״̬仯ʱ sigStreamAlerṭ߳ÿһΣ
+    void checkAlerts();
+    static void checkAlertsCallback(void* owner);
 
-private:
+    // ³Ա PlaybackThread Ҳõ
     QString m_url;
     volatile bool m_stopped = false;
 
-    QQueue<AVPacket*>* m_decodeQueue;
-    QMutex* m_decodeMutex;
-    QQueue<AVPacket*>* m_recordQueue;
-    QMutex* m_recordMutex;
+    // ߽ڲĽ/¼ƶϣûжʱ߲
+    PacketPort m_output;
+    PacketEdge m_decodeEdge;
+    PacketEdge m_recordEdge;
 
     AVFormatContext* m_formatCtx = nullptr;
     AVStream* m_videoStream = nullptr;
     int m_videoStreamIndex = -1;
+    std::atomic<quint64> m_bytesRead{ 0 };
+    std::atomic<quint64> m_packetsRead{ 0 };
+    std::atomic<StreamMetrics*> m_metrics{ nullptr };
+
+    // ԤӺͲ֮лrun зַÿʱ
+    mutable QMutex m_outputMutex;
+    TimeshiftBuffer* m_timeshift = nullptr;
+    bool m_gopCaching = false;
+    QQueue<AVPacket*> m_gopCache;
+    QString m_capturePath;
+    PacketCaptureWriter m_capture;
+    StreamAnalyzer m_analyzer;
     InterruptCallbackData m_interruptCallbackData;
 };
 
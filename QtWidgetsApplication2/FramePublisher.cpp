@@ -0,0 +1,195 @@
+#include "framepublisher.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <cstring>
+
+extern "C" {
+#include "libavutil/imgutils.h"
+}
+
+FramePublisher::FramePublisher()
+{
+}
+
+FramePublisher::~FramePublisher()
+{
+    close();
+}
+
+void FramePublisher::setKey(const QString& key, int slotCount)
+{
+    m_key = key;
+    m_slotCount = qBound(2, slotCount, FRAME_RING_MAX_SLOTS);
+    m_failed = false;
+}
+
+bool FramePublisher::create(int width, int height, AVRational timeBase)
+{
+    const int linesize = FFALIGN(width, 64);
+    const quint64 frameBytes = (quint64)linesize * height + (quint64)linesize * ((height + 1) / 2);
+    const quint64 slotBytes = (frameBytes + 4095) & ~(quint64)4095;
+    const quint64 totalBytes = FRAME_RING_HEADER_SIZE + slotBytes * m_slotCount;
+
+    m_data.setKey(m_key);
+    m_control.setKey(m_key + ".ctl");
+    // ϴ쳣˳ͬΣUnixȽͷ
+    if (m_data.attach()) {
+        m_data.detach();
+    }
+    if (m_control.attach()) {
+        m_control.detach();
+    }
+    if (!m_data.create((int)totalBytes) || !m_control.create(sizeof(FrameRingControl))) {
+        qWarning() << "Frame ring" << m_key << "create failed:" << m_data.errorString() << m_control.errorString();
+        close();
+        return false;
+    }
+
+    m_header = static_cast<FrameRingHeader*>(m_data.data());
+    memset(m_header, 0, FRAME_RING_HEADER_SIZE);
+    m_header->version = FRAME_RING_VERSION;
+    m_header->slotCount = m_slotCount;
+    m_header->width = width;
+    m_header->height = height;
+    m_header->linesize = linesize;
+    m_header->timeBaseNum = timeBase.num;
+    m_header->timeBaseDen = timeBase.den;
+    m_header->slotBytes = slotBytes;
+    m_header->dataOffset = FRAME_RING_HEADER_SIZE;
+    m_header->writerPid.store((quint64)QCoreApplication::applicationPid(), std::memory_order_relaxed);
+
+    m_controlBlock = static_cast<FrameRingControl*>(m_control.data());
+    memset(m_controlBlock, 0, sizeof(FrameRingControl));
+    m_controlBlock->version = FRAME_RING_VERSION;
+
+    // magic д߿ magic ʱֶζѾ
+    std::atomic_thread_fence(std::memory_order_release);
+    m_controlBlock->magic = FRAME_RING_MAGIC;
+    m_header->magic = FRAME_RING_MAGIC;
+
+    m_seq = 0;
+    m_reportTimer.start();
+    {
+        QMutexLocker locker(&m_statsMutex);
+        m_stats = FramePublishStats();
+        m_stats.active = true;
+    }
+    qDebug() << "Frame ring" << m_key << "created:" << width << "x" << height << "NV12," << m_slotCount
+        << "slots," << totalBytes / (1024 * 1024) << "MB";
+    return true;
+}
+
+void FramePublisher::close()
+{
+    if (m_header) {
+        m_header->writerPid.store(0, std::memory_order_release);
+    }
+    m_header = nullptr;
+    m_controlBlock = nullptr;
+    if (m_data.isAttached()) {
+        m_data.detach();
+    }
+    if (m_control.isAttached()) {
+        m_control.detach();
+    }
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.active = false;
+}
+
+void FramePublisher::updateConsumers(quint64 seq)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    FramePublishStats stats;
+    stats.active = true;
+    stats.published = seq + 1;
+
+    for (int i = 0; i < FRAME_RING_MAX_CONSUMERS; ++i) {
+        FrameRingConsumer& consumer = m_controlBlock->consumers[i];
+        if (consumer.pid.load(std::memory_order_acquire) == 0
+            || now - (qint64)consumer.heartbeatMs.load(std::memory_order_relaxed) > FRAME_RING_CONSUMER_TIMEOUT_MS) {
+            continue;
+        }
+
+        // д븲ǵ seq - slotCount һ֡߻ûһθ
+        const quint64 next = consumer.nextSeq.load(std::memory_order_relaxed);
+        if (seq >= (quint64)m_slotCount && next <= seq - m_slotCount) {
+            consumer.overwrites.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        stats.consumers++;
+        stats.maxLag = qMax(stats.maxLag, seq + 1 > next ? seq + 1 - next : 0);
+        stats.overwrites += consumer.overwrites.load(std::memory_order_relaxed);
+        stats.torn += consumer.torn.load(std::memory_order_relaxed);
+    }
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats = stats;
+}
+
+bool FramePublisher::publish(const AVFrame* frame, AVRational timeBase)
+{
+    if (m_key.isEmpty() || m_failed || !frame || frame->width <= 0 || frame->height <= 0) {
+        return false;
+    }
+    if (!m_header && !create(frame->width & ~1, frame->height & ~1, timeBase)) {
+        m_failed = true; // ʧܲÿ֡
+        return false;
+    }
+
+    // ͳһɶεĳߴ NV12£Ӳ NV12Ҫת
+    const AVFrame* src = frame;
+    AVFrame* converted = nullptr;
+    if (frame->format != AV_PIX_FMT_NV12 || frame->width != m_header->width || frame->height != m_header->height) {
+        converted = m_scaler.scale(frame, m_header->width, m_header->height, AV_PIX_FMT_NV12);
+        if (!converted) {
+            return false;
+        }
+        src = converted;
+    }
+
+    const quint64 seq = m_seq++;
+    updateConsumers(seq);
+
+    const int slotIndex = (int)(seq % m_slotCount);
+    FrameRingSlot& slot = m_header->slots[slotIndex];
+    uchar* base = static_cast<uchar*>(m_data.data()) + m_header->dataOffset + m_header->slotBytes * slotIndex;
+    const int linesize = m_header->linesize;
+    const int height = m_header->height;
+
+    // Ϊдټӵż
+    const quint64 version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    av_image_copy_plane(base, linesize, src->data[0], src->linesize[0], m_header->width, height);
+    av_image_copy_plane(base + (qint64)linesize * height, linesize, src->data[1], src->linesize[1],
+        m_header->width, (height + 1) / 2);
+    slot.frameSeq.store(seq, std::memory_order_relaxed);
+    slot.pts.store(frame->pts != AV_NOPTS_VALUE ? frame->pts : frame->best_effort_timestamp, std::memory_order_relaxed);
+    slot.publishMs.store((quint64)QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+
+    slot.version.store(version + 2, std::memory_order_release);
+    m_header->writeSeq.store(seq + 1, std::memory_order_release);
+    m_header->heartbeatMs.store((quint64)QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+
+    if (converted) {
+        av_frame_free(&converted);
+    }
+
+    if (m_reportTimer.hasExpired(10000)) {
+        m_reportTimer.restart();
+        FramePublishStats s = stats();
+        if (s.consumers > 0) {
+            qDebug() << "Frame ring" << m_key << ": consumers" << s.consumers << "max lag" << s.maxLag
+                << "frames, overwrites" << s.overwrites << ", torn" << s.torn;
+        }
+    }
+    return true;
+}
+
+FramePublishStats FramePublisher::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
@@ -0,0 +1,65 @@
+#ifndef FRAMEPUBLISHER_H
+#define FRAMEPUBLISHER_H
+
+#include <QMutex>
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+
+#include "framering.h"
+#include "framescaler.h"
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libavutil/rational.h"
+}
+
+struct FramePublishStats
+{
+    bool active = false;
+    quint64 published = 0;      // д֡
+    int consumers = 0;          // ߵ
+    quint64 maxLag = 0;         // ֡
+    quint64 overwrites = 0;     // δͱǵ֮֡
+    quint64 torn = 0;           // ߶һ뱻ǵ֮֡
+};
+
+// дˣ DecodeThread ڽ߳ publishӲȴ
+// ڴڵһ֡ʱ֡ߴ紴ֱ֮ʱ仯֡ŵͬһߴ
+class FramePublisher
+{
+public:
+    FramePublisher();
+    ~FramePublisher();
+
+    // ڽ߳еãkey Ϊձʾرգ key ǰ close()
+    void setKey(const QString& key, int slotCount = 4);
+    bool isEnabled() const { return !m_key.isEmpty(); }
+
+    bool publish(const AVFrame* frame, AVRational timeBase);
+    void close();
+
+    FramePublishStats stats() const;
+
+private:
+    bool create(int width, int height, AVRational timeBase);
+    void updateConsumers(quint64 seq);
+
+    QString m_key;
+    int m_slotCount = 4;
+
+    QSharedMemory m_data;
+    QSharedMemory m_control;
+    FrameRingHeader* m_header = nullptr;
+    FrameRingControl* m_controlBlock = nullptr;
+    quint64 m_seq = 0;
+    bool m_failed = false;
+
+    FrameScaler m_scaler;
+    QElapsedTimer m_reportTimer;
+
+    mutable QMutex m_statsMutex;
+    FramePublishStats m_stats;
+};
+
+#endif // FRAMEPUBLISHER_H
@@ -0,0 +1,167 @@
+#include "framering.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+
+FrameRingReader::FrameRingReader()
+{
+}
+
+FrameRingReader::~FrameRingReader()
+{
+    close();
+}
+
+bool FrameRingReader::open(const QString& key)
+{
+    close();
+
+    m_data.setKey(key);
+    m_control.setKey(key + ".ctl");
+    // ֻ֡ӳ䣬߲д
+    if (!m_data.attach(QSharedMemory::ReadOnly)) {
+        qWarning() << "FrameRingReader: cannot attach" << key << m_data.errorString();
+        return false;
+    }
+    if (!m_control.attach(QSharedMemory::ReadWrite)) {
+        qWarning() << "FrameRingReader: cannot attach" << key + ".ctl" << m_control.errorString();
+        m_data.detach();
+        return false;
+    }
+
+    const FrameRingHeader* header = static_cast<const FrameRingHeader*>(m_data.constData());
+    FrameRingControl* control = static_cast<FrameRingControl*>(m_control.data());
+    if (m_data.size() < FRAME_RING_HEADER_SIZE || header->magic != FRAME_RING_MAGIC
+        || header->version != FRAME_RING_VERSION || control->magic != FRAME_RING_MAGIC) {
+        qWarning() << "FrameRingReader: incompatible ring layout" << key;
+        m_data.detach();
+        m_control.detach();
+        return false;
+    }
+
+    // Ǽһ߲ۣʱĲۿԽӹ
+    const quint64 pid = (quint64)QCoreApplication::applicationPid();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < FRAME_RING_MAX_CONSUMERS; ++i) {
+        FrameRingConsumer* consumer = &control->consumers[i];
+        quint64 owner = consumer->pid.load(std::memory_order_acquire);
+        bool stale = owner != 0
+            && now - (qint64)consumer->heartbeatMs.load(std::memory_order_relaxed) > FRAME_RING_CONSUMER_TIMEOUT_MS;
+        if ((owner == 0 || stale) && consumer->pid.compare_exchange_strong(owner, pid)) {
+            consumer->nextSeq.store(header->writeSeq.load(std::memory_order_acquire), std::memory_order_relaxed);
+            consumer->overwrites.store(0, std::memory_order_relaxed);
+            consumer->torn.store(0, std::memory_order_relaxed);
+            consumer->reads.store(0, std::memory_order_relaxed);
+            consumer->heartbeatMs.store((quint64)now, std::memory_order_release);
+            m_consumer = consumer;
+            break;
+        }
+    }
+    if (!m_consumer) {
+        qWarning() << "FrameRingReader: too many consumers on" << key;
+        m_data.detach();
+        m_control.detach();
+        return false;
+    }
+
+    m_header = header;
+    return true;
+}
+
+void FrameRingReader::close()
+{
+    if (m_consumer) {
+        m_consumer->pid.store(0, std::memory_order_release);
+        m_consumer = nullptr;
+    }
+    m_header = nullptr;
+    if (m_data.isAttached()) {
+        m_data.detach();
+    }
+    if (m_control.isAttached()) {
+        m_control.detach();
+    }
+}
+
+double FrameRingReader::timeBase() const
+{
+    if (!m_header || m_header->timeBaseDen == 0) {
+        return 0.0;
+    }
+    return (double)m_header->timeBaseNum / m_header->timeBaseDen;
+}
+
+bool FrameRingReader::acquire(FrameView* view, bool skipToLatest)
+{
+    if (!m_header || !view) {
+        return false;
+    }
+
+    m_consumer->heartbeatMs.store((quint64)QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+
+    const quint64 written = m_header->writeSeq.load(std::memory_order_acquire);
+    const quint64 next = m_consumer->nextSeq.load(std::memory_order_relaxed);
+    if (written == 0 || next >= written) {
+        return false;
+    }
+
+    // Ȼɵ֡Ѿˣӻڻһ֡ʼ
+    const quint64 slotCount = m_header->slotCount;
+    quint64 target = skipToLatest ? written - 1 : qMax(next, written > slotCount ? written - slotCount : 0);
+
+    const int slotIndex = (int)(target % slotCount);
+    const FrameRingSlot& slot = m_header->slots[slotIndex];
+    const quint64 version = slot.version.load(std::memory_order_acquire);
+    if ((version & 1) || slot.frameSeq.load(std::memory_order_relaxed) != target) {
+        return false; // ڱдԺȡ
+    }
+
+    const uchar* base = static_cast<const uchar*>(m_data.constData()) + m_header->dataOffset
+        + m_header->slotBytes * slotIndex;
+    view->seq = target;
+    view->pts = slot.pts.load(std::memory_order_relaxed);
+    view->y = base;
+    view->uv = base + (qint64)m_header->linesize * m_header->height;
+    view->width = m_header->width;
+    view->height = m_header->height;
+    view->linesize = m_header->linesize;
+    view->version = version;
+    view->slot = slotIndex;
+    return true;
+}
+
+bool FrameRingReader::release(const FrameView& view)
+{
+    if (!m_header || view.slot < 0) {
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool intact = m_header->slots[view.slot].version.load(std::memory_order_relaxed) == view.version;
+    if (!intact) {
+        m_consumer->torn.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_consumer->reads.fetch_add(1, std::memory_order_relaxed);
+    m_consumer->nextSeq.store(view.seq + 1, std::memory_order_release);
+    return intact;
+}
+
+quint64 FrameRingReader::lag() const
+{
+    if (!m_header) {
+        return 0;
+    }
+    const quint64 written = m_header->writeSeq.load(std::memory_order_acquire);
+    const quint64 next = m_consumer->nextSeq.load(std::memory_order_relaxed);
+    return written > next ? written - next : 0;
+}
+
+quint64 FrameRingReader::overwrites() const
+{
+    return m_consumer ? m_consumer->overwrites.load(std::memory_order_relaxed) : 0;
+}
+
+quint64 FrameRingReader::torn() const
+{
+    return m_consumer ? m_consumer->torn.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,119 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QSharedMemory>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// ֡ڴ滷д NV12 ֡ķֱӳȡظ
+// ιڴ棺
+//   <key>      ֡ݣͷ + λֻӳ
+//   <key>.ctl  ߵǼǱдԼĶλãд˾ݴͳӳٺ͸
+// д˴Ӳȴߣÿversion Ϊʾд
+// ֡ټһ versionû˵
+#define FRAME_RING_MAGIC 0x474E5246u    // "FRNG"
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_MAX_SLOTS 16
+#define FRAME_RING_MAX_CONSUMERS 8
+#define FRAME_RING_HEADER_SIZE 4096
+#define FRAME_RING_CONSUMER_TIMEOUT_MS 30000
+
+struct FrameRingSlot
+{
+    std::atomic<quint64> version;       // 
+    std::atomic<quint64> frameSeq;      // ֡ȫ
+    std::atomic<qint64> pts;            // ԭʼʱµPTS
+    std::atomic<quint64> publishMs;     // дʱ䣨1970ĺ룩
+    quint64 reserved[4];
+};
+static_assert(sizeof(FrameRingSlot) == 64, "FrameRingSlot layout changed");
+
+struct FrameRingHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 slotCount;
+    quint32 reserved0;
+    qint32 width;                       // ֡ͳһΪóߴ NV12
+    qint32 height;
+    qint32 linesize;                    // Y  UV ƽֽ
+    qint32 timeBaseNum;
+    qint32 timeBaseDen;
+    quint32 reserved1;
+    quint64 slotBytes;                  // ÿ۵ֽ4096룩
+    quint64 dataOffset;                 // һԶʼƫ
+    std::atomic<quint64> writeSeq;      // ѷ֡֡Ϊ writeSeq-1
+    std::atomic<quint64> writerPid;     // 0 ʾдѹر
+    std::atomic<quint64> heartbeatMs;
+    quint64 reserved2[3];
+    FrameRingSlot slots[FRAME_RING_MAX_SLOTS];
+};
+static_assert(sizeof(FrameRingHeader) <= FRAME_RING_HEADER_SIZE, "FrameRingHeader too large");
+
+struct FrameRingConsumer
+{
+    std::atomic<quint64> pid;           // 0 ʾ
+    std::atomic<quint64> nextSeq;       // һ֡ţlag = writeSeq - nextSeq
+    std::atomic<quint64> heartbeatMs;
+    std::atomic<quint64> overwrites;    // дͳƣûͱǵ֡
+    std::atomic<quint64> torn;          // ͳƣĹбǶϵ֡
+    std::atomic<quint64> reads;
+    quint64 reserved[2];
+};
+static_assert(sizeof(FrameRingConsumer) == 64, "FrameRingConsumer layout changed");
+
+struct FrameRingControl
+{
+    quint32 magic;
+    quint32 version;
+    quint64 reserved[7];
+    FrameRingConsumer consumers[FRAME_RING_MAX_CONSUMERS];
+};
+
+// ָڴеһ֡ release ֮ǰЧ
+struct FrameView
+{
+    quint64 seq = 0;
+    qint64 pts = 0;
+    const uchar* y = nullptr;
+    const uchar* uv = nullptr;
+    int width = 0;
+    int height = 0;
+    int linesize = 0;
+    quint64 version = 0;
+    int slot = -1;
+};
+
+// Ѷˣʹã FFmpeg
+class FrameRingReader
+{
+public:
+    FrameRingReader();
+    ~FrameRingReader();
+
+    bool open(const QString& key);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    int width() const { return m_header ? m_header->width : 0; }
+    int height() const { return m_header ? m_header->height : 0; }
+    double timeBase() const;
+
+    // ȡһ֡û֡ʱ falseskipToLatest Ϊ true ʱֱ֡
+    bool acquire(FrameView* view, bool skipToLatest = true);
+    // ã false ʾĹв۱д˸ǣһ֡ĽӦ
+    bool release(const FrameView& view);
+
+    quint64 lag() const;
+    quint64 overwrites() const;
+    quint64 torn() const;
+
+private:
+    QSharedMemory m_data;
+    QSharedMemory m_control;
+    const FrameRingHeader* m_header = nullptr;
+    FrameRingConsumer* m_consumer = nullptr;
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,136 @@
+#include "framescaler.h"
+#include <QDebug>
+
+extern "C" {
+#include "libswscale/swscale.h"
+#include "libavutil/opt.h"
+}
+
+FrameScaler::FrameScaler()
+{
+}
+
+FrameScaler::~FrameScaler()
+{
+    release();
+}
+
+void FrameScaler::setThreadCount(int threads)
+{
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads != m_threads) {
+        m_threads = threads;
+        release(); // ֻ߳ڳʼǰ
+    }
+}
+
+void FrameScaler::release()
+{
+    if (m_swsCtx) {
+        sws_freeContext(m_swsCtx);
+        m_swsCtx = nullptr;
+    }
+    m_srcW = m_srcH = m_dstW = m_dstH = 0;
+    m_format = AV_PIX_FMT_NONE;
+    m_dstFormat = AV_PIX_FMT_NONE;
+}
+
+bool FrameScaler::fitSize(int srcW, int srcH, int boxW, int boxH, int* outW, int* outH)
+{
+    if (srcW <= 0 || srcH <= 0 || boxW <= 0 || boxH <= 0) {
+        return false;
+    }
+    if (boxW >= srcW && boxH >= srcH) {
+        return false;
+    }
+
+    double scale = qMin((double)boxW / srcW, (double)boxH / srcH);
+    int w = ((int)(srcW * scale)) & ~1;
+    int h = ((int)(srcH * scale)) & ~1;
+    if (w < 2 || h < 2) {
+        return false;
+    }
+    // 仯̫Сֵţֱϴԭͼ
+    if (w * 10 >= srcW * 9 && h * 10 >= srcH * 9) {
+        return false;
+    }
+
+    *outW = w;
+    *outH = h;
+    return true;
+}
+
+bool FrameScaler::ensureContext(const AVFrame* src, int dstW, int dstH, AVPixelFormat dstFormat)
+{
+    AVPixelFormat format = (AVPixelFormat)src->format;
+    if (m_swsCtx && m_srcW == src->width && m_srcH == src->height
+        && m_dstW == dstW && m_dstH == dstH && m_format == format && m_dstFormat == dstFormat) {
+        return true;
+    }
+
+    release();
+
+    m_swsCtx = sws_alloc_context();
+    if (!m_swsCtx) {
+        return false;
+    }
+
+    av_opt_set_int(m_swsCtx, "srcw", src->width, 0);
+    av_opt_set_int(m_swsCtx, "srch", src->height, 0);
+    av_opt_set_int(m_swsCtx, "src_format", format, 0);
+    av_opt_set_int(m_swsCtx, "dstw", dstW, 0);
+    av_opt_set_int(m_swsCtx, "dsth", dstH, 0);
+    av_opt_set_int(m_swsCtx, "dst_format", dstFormat, 0);
+    av_opt_set_int(m_swsCtx, "sws_flags", SWS_FAST_BILINEAR, 0);
+    av_opt_set_int(m_swsCtx, "threads", m_threads, 0);
+
+    if (sws_init_context(m_swsCtx, nullptr, nullptr) < 0) {
+        qWarning() << "FrameScaler: sws_init_context failed" << src->width << src->height << "->" << dstW << dstH;
+        sws_freeContext(m_swsCtx);
+        m_swsCtx = nullptr;
+        return false;
+    }
+
+    m_srcW = src->width;
+    m_srcH = src->height;
+    m_dstW = dstW;
+    m_dstH = dstH;
+    m_format = format;
+    m_dstFormat = dstFormat;
+    return true;
+}
+
+AVFrame* FrameScaler::scale(const AVFrame* src, int dstW, int dstH, AVPixelFormat dstFormat)
+{
+    if (!src) {
+        return nullptr;
+    }
+    if (dstFormat == AV_PIX_FMT_NONE) {
+        dstFormat = (AVPixelFormat)src->format;
+    }
+    if (!ensureContext(src, dstW, dstH, dstFormat)) {
+        return nullptr;
+    }
+
+    AVFrame* dst = av_frame_alloc();
+    if (!dst) {
+        return nullptr;
+    }
+    dst->width = dstW;
+    dst->height = dstH;
+    dst->format = dstFormat;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    av_frame_copy_props(dst, src);
+
+    // sws_scale_frame ᰴ threads ѡƬָ߳
+    if (sws_scale_frame(m_swsCtx, dst, src) < 0) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    return dst;
+}
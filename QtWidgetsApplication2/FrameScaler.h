@@ -0,0 +1,43 @@
+#ifndef FRAMESCALER_H
+#define FRAMESCALER_H
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libavutil/pixfmt.h"
+}
+
+struct SwsContext;
+
+// ţѽ֡Сʾߴ磬ϴ
+// ʹ libswscaleڲΪSIMDʵ֣Ƭ߳
+class FrameScaler
+{
+public:
+    FrameScaler();
+    ~FrameScaler();
+
+    void setThreadCount(int threads);
+
+    //  src ŵ dstW x dstHdstFormat Ϊ AV_PIX_FMT_NONE ʱظʽֲ
+    // ·֡ɵ߸ av_frame_freeʧܷ nullptr
+    AVFrame* scale(const AVFrame* src, int dstW, int dstH, AVPixelFormat dstFormat = AV_PIX_FMT_NONE);
+
+    //  srcW x srcH Ž boxW x boxHȡż
+    // ֻȷʵҪСʱ trueboxЧСԴߴʱfalseʹԭʼֱʣ
+    static bool fitSize(int srcW, int srcH, int boxW, int boxH, int* outW, int* outH);
+
+private:
+    bool ensureContext(const AVFrame* src, int dstW, int dstH, AVPixelFormat dstFormat);
+    void release();
+
+    SwsContext* m_swsCtx = nullptr;
+    int m_srcW = 0;
+    int m_srcH = 0;
+    int m_dstW = 0;
+    int m_dstH = 0;
+    AVPixelFormat m_format = AV_PIX_FMT_NONE;
+    AVPixelFormat m_dstFormat = AV_PIX_FMT_NONE;
+    int m_threads = 1;
+};
+
+#endif // FRAMESCALER_H
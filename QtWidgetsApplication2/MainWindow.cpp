@@ -23,6 +23,7 @@ MainWindow::MainWindow(QWidget* parent)
     });
 
     m_player->setVideoWidget(ui.openGLWidget);
+    m_player->setDisplayDownscale(true);
     ui.openGLWidget->setVisible(false);
 
     ui.rtspUrlLineEdit->setText("rtsp://192.168.89.34:8554/test");
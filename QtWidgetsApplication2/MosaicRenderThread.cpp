@@ -0,0 +1,584 @@
+#include "mosaicrenderthread.h"
+#include "threadpolicy.h"
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QOffscreenSurface>
+#include <QVector>
+#include <QDebug>
+
+// ÿӵĸʽΪԴ룬иӹһһλ
+static const char* mosaicVertexShaderSource =
+"attribute vec4 vertexIn;\n"
+"attribute vec2 textureIn;\n"
+"attribute vec2 tileFormat;\n"   // x: ƽ, y: ȫΧ
+"attribute vec4 tileCoeffs;\n"
+"varying vec2 textureOut;\n"
+"varying vec2 format;\n"
+"varying vec4 coeffs;\n"
+"void main(void)\n"
+"{\n"
+"    gl_Position = vertexIn;\n"
+"    textureOut = textureIn;\n"
+"    format = tileFormat;\n"
+"    coeffs = tileCoeffs;\n"
+"}\n";
+
+// ɫͼͼһߴ硢Ӳͬͬһͬʱ Y  UV
+static const char* mosaicFragmentShaderSource =
+"varying vec2 textureOut;\n"
+"varying vec2 format;\n"
+"varying vec4 coeffs;\n"
+"uniform sampler2D tex_y;\n"
+"uniform sampler2D tex_uv;\n"
+"uniform sampler2D tex_u;\n"
+"uniform sampler2D tex_v;\n"
+"void main(void)\n"
+"{\n"
+"    float y = texture2D(tex_y, textureOut).r;\n"
+"    vec2 uv;\n"
+"    if (format.x > 0.5)\n"
+"        uv = vec2(texture2D(tex_u, textureOut).r, texture2D(tex_v, textureOut).r);\n"
+"    else\n"
+"        uv = texture2D(tex_uv, textureOut).rg;\n"
+"    if (format.y > 0.5) {\n"
+"        uv -= 0.5;\n"
+"    }\n"
+"    else {\n"
+"        y = (y - 0.0627) / 0.8588;\n"
+"        uv = (uv - 0.0627) / 0.8784 - 0.5;\n"
+"    }\n"
+"    float r = y + coeffs.x * uv.y;\n"
+"    float g = y - coeffs.y * uv.x - coeffs.z * uv.y;\n"
+"    float b = y + coeffs.w * uv.x;\n"
+"    gl_FragColor = vec4(r, g, b, 1.0);\n"
+"}\n";
+
+MosaicRenderThread::MosaicRenderThread(QOpenGLContext* shareContext, QOffscreenSurface* surface, QObject* parent)
+    : QThread(parent), m_surface(surface)
+{
+    m_context = new QOpenGLContext();
+    m_context->setFormat(shareContext->format());
+    m_context->setShareContext(shareContext);
+    if (!m_context->create()) {
+        qCritical() << "MosaicRenderThread: failed to create shared OpenGL context.";
+    }
+    m_context->moveToThread(this);
+}
+
+MosaicRenderThread::~MosaicRenderThread()
+{
+    stop();
+    wait();
+    delete m_context;
+    m_context = nullptr;
+}
+
+void MosaicRenderThread::setGrid(int columns, int rows)
+{
+    columns = qBound(1, columns, MOSAIC_MAX_TILES);
+    rows = qBound(1, rows, MOSAIC_MAX_TILES / columns);
+    m_columns = columns;
+    m_rows = rows;
+}
+
+void MosaicRenderThread::setTileSource(int index, QQueue<AVFrame*>* queue, QMutex* mutex)
+{
+    if (index < 0 || index >= MOSAIC_MAX_TILES) {
+        return;
+    }
+    QMutexLocker locker(&m_sourceMutex);
+    m_tiles[index].queue = queue;
+    m_tiles[index].mutex = mutex;
+    if (!queue) {
+        clearTile(index);
+    }
+}
+
+void MosaicRenderThread::clearTile(int index)
+{
+    if (index >= 0 && index < MOSAIC_MAX_TILES) {
+        m_clearTiles.fetch_or(1ULL << index);
+    }
+}
+
+void MosaicRenderThread::setTargetSize(int width, int height)
+{
+    m_targetW = width;
+    m_targetH = height;
+}
+
+void MosaicRenderThread::setFrameInterval(int ms)
+{
+    m_frameIntervalMs = qMax(1, ms);
+}
+
+void MosaicRenderThread::clear()
+{
+    m_clearRequested = true;
+}
+
+void MosaicRenderThread::stop()
+{
+    m_stopped = true;
+}
+
+GLuint MosaicRenderThread::lockFrontTexture()
+{
+    m_frontMutex.lock();
+    QOpenGLFramebufferObject* front = m_fbo[m_backIndex ^ 1];
+    return (m_frontValid && front) ? front->texture() : 0;
+}
+
+void MosaicRenderThread::unlockFrontTexture()
+{
+    m_frontMutex.unlock();
+}
+
+RenderStats MosaicRenderThread::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+bool MosaicRenderThread::initResources()
+{
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+
+    glGenTextures(4, m_atlas);
+    for (int i = 0; i < 4; ++i) {
+        glBindTexture(GL_TEXTURE_2D, m_atlas[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    m_program = new QOpenGLShaderProgram();
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, mosaicVertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, mosaicFragmentShaderSource);
+    if (!m_program->link()) {
+        qCritical() << "MosaicRenderThread: shader link failed" << m_program->log();
+        return false;
+    }
+    m_program->bind();
+    m_program->setUniformValue("tex_y", 0);
+    m_program->setUniformValue("tex_uv", 1);
+    m_program->setUniformValue("tex_u", 2);
+    m_program->setUniformValue("tex_v", 3);
+    m_program->release();
+    return true;
+}
+
+void MosaicRenderThread::releaseResources()
+{
+    clearTargets();
+
+    delete m_program;
+    m_program = nullptr;
+    if (m_atlas[0]) {
+        glDeleteTextures(4, m_atlas);
+        m_atlas[0] = m_atlas[1] = m_atlas[2] = m_atlas[3] = 0;
+    }
+    m_atlasColumns = m_atlasRows = 0;
+    m_slotW = m_slotH = 0;
+
+    QMutexLocker locker(&m_frontMutex);
+    for (int i = 0; i < 2; ++i) {
+        delete m_fbo[i];
+        m_fbo[i] = nullptr;
+    }
+    for (int i = 0; i < MOSAIC_MAX_TILES; ++i) {
+        if (m_tiles[i].frame) {
+            av_frame_free(&m_tiles[i].frame);
+        }
+        m_tiles[i].videoW = m_tiles[i].videoH = 0;
+    }
+}
+
+bool MosaicRenderThread::allocateAtlas(int columns, int rows, int targetW, int targetH)
+{
+    // ȡÿʾߴ磨żɫͼһ룩ͼߴ
+    int slotW = qMin((targetW + columns - 1) / columns, m_maxTextureSize / columns) & ~1;
+    int slotH = qMin((targetH + rows - 1) / rows, m_maxTextureSize / rows) & ~1;
+    if (slotW < 2 || slotH < 2) {
+        return false;
+    }
+
+    m_atlasColumns = columns;
+    m_atlasRows = rows;
+    m_slotW = slotW;
+    m_slotH = slotH;
+    const int atlasW = slotW * columns;
+    const int atlasH = slotH * rows;
+
+    glBindTexture(GL_TEXTURE_2D, m_atlas[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasW, atlasH, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, m_atlas[1]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG, atlasW / 2, atlasH / 2, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+    for (int i = 2; i < 4; ++i) {
+        glBindTexture(GL_TEXTURE_2D, m_atlas[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasW / 2, atlasH / 2, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    // ͼϣлĸȫϴ
+    for (int i = 0; i < MOSAIC_MAX_TILES; ++i) {
+        m_tiles[i].dirty = m_tiles[i].frame != nullptr;
+    }
+    qDebug() << "Mosaic atlas" << columns << "x" << rows << "slots of" << slotW << "x" << slotH;
+    return true;
+}
+
+bool MosaicRenderThread::uploadTile(int index)
+{
+    Tile& tile = m_tiles[index];
+    tile.dirty = false;
+    AVFrame* frame = tile.frame;
+    if (!frame || !frame->data[0] || index >= m_atlasColumns * m_atlasRows) {
+        return false;
+    }
+
+    // 8λ͸λ16λʽֱϴ16λϴʱת8λʽתNV12
+    // ȸӴ֡СڣͨѾӳߴߵ
+    VideoPlaneLayout layout;
+    const bool direct = videoPlaneLayout((AVPixelFormat)frame->format, &layout) && layout.sampleScale == 1.0f;
+    int dstW = frame->width;
+    int dstH = frame->height;
+    if (dstW > m_slotW || dstH > m_slotH) {
+        const double scale = qMin((double)m_slotW / dstW, (double)m_slotH / dstH);
+        dstW = qMax(2, (int)(dstW * scale) & ~1);
+        dstH = qMax(2, (int)(dstH * scale) & ~1);
+    }
+    AVFrame* converted = nullptr;
+    if (!direct || dstW != frame->width || dstH != frame->height) {
+        converted = tile.scaler.scale(frame, dstW, dstH, direct ? AV_PIX_FMT_NONE : AV_PIX_FMT_NV12);
+        if (!converted || !videoPlaneLayout((AVPixelFormat)converted->format, &layout)) {
+            av_frame_free(&converted);
+            return false;
+        }
+        frame = converted;
+    }
+    if (!frame->data[1] || (layout.planar && !frame->data[2])) {
+        av_frame_free(&converted);
+        return false;
+    }
+
+    const GLenum type = layout.sixteenBit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    const int bytesPerSample = layout.sixteenBit ? 2 : 1;
+    const int x = (index % m_atlasColumns) * m_slotW;
+    const int y = (index / m_atlasColumns) * m_slotH;
+    const int chromaW = (frame->width + 1) / 2;
+    const int chromaH = (frame->height + 1) / 2;
+
+    glBindTexture(GL_TEXTURE_2D, m_atlas[0]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[0] / bytesPerSample);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, frame->width, frame->height, GL_RED, type, frame->data[0]);
+    if (layout.planar) {
+        for (int plane = 1; plane <= 2; ++plane) {
+            glBindTexture(GL_TEXTURE_2D, m_atlas[plane + 1]);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[plane] / bytesPerSample);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x / 2, y / 2, chromaW, chromaH, GL_RED, type, frame->data[plane]);
+        }
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, m_atlas[1]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[1] / (2 * bytesPerSample));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x / 2, y / 2, chromaW, chromaH, GL_RG, type, frame->data[1]);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    tile.videoW = frame->width;
+    tile.videoH = frame->height;
+    tile.planar = layout.planar;
+    tile.fullRange = layout.fullRange || frame->color_range == AVCOL_RANGE_JPEG;
+    yuvToRgbCoefficients(frame->colorspace, tile.coeffs);
+
+    av_frame_free(&converted);
+    m_tileUploads.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void MosaicRenderThread::drawGrid()
+{
+    const int targetW = m_targetW;
+    const int targetH = m_targetH;
+    if (targetW <= 0 || targetH <= 0 || m_slotW <= 0 || m_slotH <= 0) {
+        return;
+    }
+
+    QOpenGLFramebufferObject*& back = m_fbo[m_backIndex];
+    if (!back || back->width() != targetW || back->height() != targetH) {
+        delete back;
+        back = new QOpenGLFramebufferObject(targetW, targetH);
+    }
+
+    back->bind();
+    glViewport(0, 0, targetW, targetH);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // ÿлĸΣֿ߱Ⱦ
+    const int columns = m_atlasColumns;
+    const int rows = m_atlasRows;
+    const float atlasW = (float)(m_slotW * columns);
+    const float atlasH = (float)(m_slotH * rows);
+    const float cellW = 2.0f / columns;
+    const float cellH = 2.0f / rows;
+    const float cellAspect = ((float)targetW / columns) / ((float)targetH / rows);
+
+    QVector<GLfloat> vertices, texcoords, formats, coeffs;
+    const int tileCount = columns * rows;
+    vertices.reserve(tileCount * 12);
+    texcoords.reserve(tileCount * 12);
+    formats.reserve(tileCount * 12);
+    coeffs.reserve(tileCount * 24);
+
+    for (int i = 0; i < tileCount; ++i) {
+        const Tile& tile = m_tiles[i];
+        if (tile.videoW <= 0 || tile.videoH <= 0) {
+            continue;
+        }
+
+        float scaleX = 1.0f;
+        float scaleY = 1.0f;
+        const float videoAspect = (float)tile.videoW / (float)tile.videoH;
+        if (cellAspect > videoAspect) {
+            scaleX = videoAspect / cellAspect;
+        }
+        else {
+            scaleY = cellAspect / videoAspect;
+        }
+        const float cx = -1.0f + cellW * (i % columns + 0.5f);
+        const float cy = 1.0f - cellH * (i / columns + 0.5f);
+        const float left = cx - cellW * 0.5f * scaleX;
+        const float right = cx + cellW * 0.5f * scaleX;
+        const float top = cy + cellH * 0.5f * scaleY;
+        const float bottom = cy - cellH * 0.5f * scaleY;
+
+        // հɫأԹ˲ɵڸ
+        const float x = (float)((i % columns) * m_slotW);
+        const float y = (float)((i / columns) * m_slotH);
+        const float u0 = (x + 1.0f) / atlasW;
+        const float u1 = (x + tile.videoW - 1.0f) / atlasW;
+        const float v0 = (y + 1.0f) / atlasH;
+        const float v1 = (y + tile.videoH - 1.0f) / atlasH;
+
+        const GLfloat quad[] = { left, bottom, right, bottom, left, top, left, top, right, bottom, right, top };
+        const GLfloat uv[] = { u0, v1, u1, v1, u0, v0, u0, v0, u1, v1, u1, v0 };
+        for (int k = 0; k < 12; ++k) {
+            vertices.append(quad[k]);
+            texcoords.append(uv[k]);
+        }
+        for (int k = 0; k < 6; ++k) {
+            formats.append(tile.planar ? 1.0f : 0.0f);
+            formats.append(tile.fullRange ? 1.0f : 0.0f);
+            for (int c = 0; c < 4; ++c) {
+                coeffs.append(tile.coeffs[c]);
+            }
+        }
+    }
+
+    if (!vertices.isEmpty()) {
+        for (int i = 0; i < 4; ++i) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, m_atlas[i]);
+        }
+
+        m_program->bind();
+        const int vertexIn = m_program->attributeLocation("vertexIn");
+        const int textureIn = m_program->attributeLocation("textureIn");
+        const int tileFormat = m_program->attributeLocation("tileFormat");
+        const int tileCoeffs = m_program->attributeLocation("tileCoeffs");
+        m_program->enableAttributeArray(vertexIn);
+        m_program->enableAttributeArray(textureIn);
+        m_program->enableAttributeArray(tileFormat);
+        m_program->enableAttributeArray(tileCoeffs);
+        m_program->setAttributeArray(vertexIn, GL_FLOAT, vertices.constData(), 2);
+        m_program->setAttributeArray(textureIn, GL_FLOAT, texcoords.constData(), 2);
+        m_program->setAttributeArray(tileFormat, GL_FLOAT, formats.constData(), 2);
+        m_program->setAttributeArray(tileCoeffs, GL_FLOAT, coeffs.constData(), 4);
+
+        glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 2);
+
+        m_program->disableAttributeArray(vertexIn);
+        m_program->disableAttributeArray(textureIn);
+        m_program->disableAttributeArray(tileFormat);
+        m_program->disableAttributeArray(tileCoeffs);
+        m_program->release();
+        for (int i = 3; i >= 0; --i) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, GL_NONE);
+        }
+    }
+    back->release();
+
+    glFinish();
+    swapBuffers();
+}
+
+void MosaicRenderThread::run()
+{
+    ThreadPolicyScope policyScope(StageRender);
+    const int MAX_TILE_BACKLOG = 2;
+
+    if (!m_context->makeCurrent(m_surface)) {
+        qCritical() << "MosaicRenderThread: makeCurrent failed.";
+        return;
+    }
+    initializeOpenGLFunctions();
+
+    if (!initResources()) {
+        releaseResources();
+        m_context->doneCurrent();
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    m_statsTimer.start();
+    qint64 nextPresentMs = 0;
+    int lastW = 0, lastH = 0;
+
+    while (!m_stopped) {
+        bool redraw = false;
+
+        if (m_clearRequested.exchange(false)) {
+            m_clearTiles = ~0ULL;
+        }
+        const quint64 clearMask = m_clearTiles.exchange(0);
+        if (clearMask) {
+            for (int i = 0; i < MOSAIC_MAX_TILES; ++i) {
+                if ((clearMask >> i) & 1) {
+                    if (m_tiles[i].frame) {
+                        av_frame_free(&m_tiles[i].frame);
+                    }
+                    m_tiles[i].videoW = m_tiles[i].videoH = 0;
+                    m_tiles[i].dirty = false;
+                }
+            }
+            redraw = true;
+        }
+
+        const int columns = m_columns;
+        const int rows = m_rows;
+        const int targetW = m_targetW;
+        const int targetH = m_targetH;
+        if (targetW != lastW || targetH != lastH || columns != m_atlasColumns || rows != m_atlasRows) {
+            if (allocateAtlas(columns, rows, targetW, targetH)) {
+                lastW = targetW;
+                lastH = targetH;
+                redraw = true;
+            }
+        }
+
+        // ÿÿһ·ȡһ֡ĳһ·ѹʱֻµģǽ׷֡
+        const qint64 now = clock.elapsed();
+        int maxDepth = 0;
+        if (now >= nextPresentMs && m_atlasColumns > 0) {
+            QMutexLocker locker(&m_sourceMutex);
+            for (int i = 0; i < m_atlasColumns * m_atlasRows; ++i) {
+                Tile& tile = m_tiles[i];
+                if (!tile.queue || !tile.mutex) {
+                    continue;
+                }
+                AVFrame* next = nullptr;
+                {
+                    QMutexLocker queueLocker(tile.mutex);
+                    while (tile.queue->size() > MAX_TILE_BACKLOG) {
+                        AVFrame* stale = tile.queue->dequeue();
+                        av_frame_free(&stale);
+                    }
+                    if (!tile.queue->isEmpty()) {
+                        next = tile.queue->dequeue();
+                    }
+                    maxDepth = qMax(maxDepth, tile.queue->size());
+                }
+                if (next) {
+                    if (tile.frame) {
+                        av_frame_free(&tile.frame);
+                    }
+                    tile.frame = next;
+                    tile.dirty = true;
+                }
+            }
+        }
+
+        // ֻϴ֡ĸ
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+        for (int i = 0; i < m_atlasColumns * m_atlasRows; ++i) {
+            if (m_tiles[i].dirty) {
+                uploadTile(i);
+                redraw = true;
+            }
+        }
+        const double uploadMs = stageTimer.nsecsElapsed() / 1000000.0;
+
+        if (redraw) {
+            stageTimer.restart();
+            drawGrid();
+            const double drawMs = stageTimer.nsecsElapsed() / 1000000.0;
+            updateStats(uploadMs, drawMs, maxDepth);
+            emit frameReady();
+
+            const int interval = m_frameIntervalMs;
+            if (nextPresentMs + interval < now) {
+                nextPresentMs = now;
+            }
+            nextPresentMs += interval;
+        }
+        else {
+            qint64 wait = nextPresentMs - clock.elapsed();
+            msleep((unsigned long)qBound<qint64>(1, wait, 5));
+        }
+    }
+
+    releaseResources();
+    m_context->doneCurrent();
+    qDebug() << "Mosaic render thread finished.";
+}
+
+void MosaicRenderThread::swapBuffers()
+{
+    QMutexLocker locker(&m_frontMutex);
+    m_backIndex ^= 1;
+    m_frontValid = true;
+}
+
+void MosaicRenderThread::clearTargets()
+{
+    QMutexLocker locker(&m_frontMutex);
+    m_frontValid = false;
+}
+
+void MosaicRenderThread::updateStats(double uploadMs, double drawMs, int queueDepth)
+{
+    const double alpha = 0.1; // ָƽϵ
+    const double frameMs = uploadMs + drawMs;
+    m_framesInWindow++;
+    m_maxInWindow = qMax(m_maxInWindow, frameMs);
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.presentedFrames++;
+    m_stats.queueDepth = queueDepth;
+    if (m_stats.presentedFrames == 1) {
+        m_stats.avgUploadMs = uploadMs;
+        m_stats.avgDrawMs = drawMs;
+    }
+    else {
+        m_stats.avgUploadMs = m_stats.avgUploadMs * (1.0 - alpha) + uploadMs * alpha;
+        m_stats.avgDrawMs = m_stats.avgDrawMs * (1.0 - alpha) + drawMs * alpha;
+    }
+
+    const qint64 elapsed = m_statsTimer.elapsed();
+    if (elapsed >= 1000) {
+        m_stats.fps = m_framesInWindow * 1000.0 / elapsed;
+        m_stats.maxFrameMs = m_maxInWindow;
+        m_framesInWindow = 0;
+        m_maxInWindow = 0.0;
+        m_statsTimer.restart();
+    }
+}
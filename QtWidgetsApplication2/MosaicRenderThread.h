@@ -0,0 +1,121 @@
+#ifndef MOSAICRENDERTHREAD_H
+#define MOSAICRENDERTHREAD_H
+
+#include <QThread>
+#include <QQueue>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QOpenGLFunctions>
+#include <atomic>
+
+extern "C" {
+#include "libavutil/frame.h"
+}
+
+#include "renderthread.h"
+#include "framescaler.h"
+
+#define MOSAIC_MAX_TILES 64
+
+class QOpenGLContext;
+class QOpenGLShaderProgram;
+class QOpenGLFramebufferObject;
+class QOffscreenSurface;
+
+// ·ƴӵȾ̣߳· Y / UV(UV) ƽϴŹͼУ
+// ÿ·ռһӣһλơһɫ
+// ӳߴĿߴ磬ڸӵ֡Сֻյ֡ĸӲϴ
+class MosaicRenderThread : public QThread, protected QOpenGLFunctions
+{
+    Q_OBJECT
+public:
+    // surface GUI̴߳ɵ߹
+    MosaicRenderThread(QOpenGLContext* shareContext, QOffscreenSurface* surface, QObject* parent = nullptr);
+    ~MosaicRenderThread();
+
+    // ޸ģӰȱ
+    void setGrid(int columns, int rows);
+    //  index ӵʾУqueue Ϊձʾһʾ
+    void setTileSource(int index, QQueue<AVFrame*>* queue, QMutex* mutex);
+    void clearTile(int index);
+
+    void setTargetSize(int width, int height);
+    void setFrameInterval(int ms);
+    void clear();
+    void stop();
+
+    //  RenderThread ͬGUI̺߳ϳʱȡµRGB0ʾûл
+    GLuint lockFrontTexture();
+    void unlockFrontTexture();
+
+    // presentedFrames ΪϳɴavgUploadMs Ϊÿκϳиӵϴʱ
+    RenderStats stats() const;
+    quint64 tileUploads() const { return m_tileUploads; }
+
+signals:
+    void frameReady();
+
+protected:
+    void run() override;
+
+private:
+    struct Tile
+    {
+        QQueue<AVFrame*>* queue = nullptr;
+        QMutex* mutex = nullptr;
+        AVFrame* frame = nullptr;   // һ֡ͼؽҪϴ
+        bool dirty = false;
+        int videoW = 0;
+        int videoH = 0;
+        bool planar = false;
+        bool fullRange = false;
+        GLfloat coeffs[4] = { 1.402f, 0.344136f, 0.714136f, 1.772f };
+        FrameScaler scaler;
+    };
+
+    bool initResources();
+    void releaseResources();
+    bool allocateAtlas(int columns, int rows, int targetW, int targetH);
+    bool uploadTile(int index);
+    void drawGrid();
+    void swapBuffers();
+    void clearTargets();
+    void updateStats(double uploadMs, double drawMs, int queueDepth);
+
+    QOpenGLContext* m_context = nullptr;
+    QOffscreenSurface* m_surface = nullptr;
+
+    Tile m_tiles[MOSAIC_MAX_TILES];
+    QMutex m_sourceMutex;
+    std::atomic<quint64> m_clearTiles{ 0 };    // ոӵλͼ
+
+    volatile bool m_stopped = false;
+    std::atomic<bool> m_clearRequested{ false };
+    std::atomic<int> m_columns{ 2 };
+    std::atomic<int> m_rows{ 2 };
+    std::atomic<int> m_targetW{ 0 };
+    std::atomic<int> m_targetH{ 0 };
+    std::atomic<int> m_frameIntervalMs{ 33 };
+    std::atomic<quint64> m_tileUploads{ 0 };
+
+    QOpenGLShaderProgram* m_program = nullptr;
+    GLuint m_atlas[4] = { 0, 0, 0, 0 };  // Y, UV(֯), U, V
+    int m_atlasColumns = 0;
+    int m_atlasRows = 0;
+    int m_slotW = 0;
+    int m_slotH = 0;
+    int m_maxTextureSize = 4096;
+
+    QOpenGLFramebufferObject* m_fbo[2] = { nullptr, nullptr };
+    int m_backIndex = 0;
+    bool m_frontValid = false;
+    QMutex m_frontMutex;
+
+    mutable QMutex m_statsMutex;
+    RenderStats m_stats;
+    QElapsedTimer m_statsTimer;
+    quint64 m_framesInWindow = 0;
+    double m_maxInWindow = 0.0;
+};
+
+#endif // MOSAICRENDERTHREAD_H
@@ -0,0 +1,177 @@
+#include "mosaicwidget.h"
+#include <QOpenGLShader>
+#include <QOffscreenSurface>
+#include <QDebug>
+
+// ϳõɫ VideoWidget ֱͬȾ߳RGB
+static const char* mosaicBlitVertexShaderSource =
+"attribute vec4 vertexIn;\n"
+"attribute vec2 textureIn;\n"
+"varying vec2 textureOut;\n"
+"void main(void)\n"
+"{\n"
+"    gl_Position = vertexIn;\n"
+"    textureOut = textureIn;\n"
+"}\n";
+
+static const char* mosaicBlitFragmentShaderSource =
+"varying vec2 textureOut;\n"
+"uniform sampler2D tex_rgb;\n"
+"void main(void)\n"
+"{\n"
+"    gl_FragColor = texture2D(tex_rgb, textureOut);\n"
+"}\n";
+
+MosaicWidget::MosaicWidget(QWidget* parent) : QOpenGLWidget(parent)
+{
+}
+
+MosaicWidget::~MosaicWidget()
+{
+    makeCurrent();
+    stopRenderThread();
+    delete m_program;
+    m_program = nullptr;
+    doneCurrent();
+}
+
+void MosaicWidget::setGrid(int columns, int rows)
+{
+    m_columns = qBound(1, columns, MOSAIC_MAX_TILES);
+    m_rows = qBound(1, rows, MOSAIC_MAX_TILES / m_columns);
+    if (m_renderThread) {
+        m_renderThread->setGrid(m_columns, m_rows);
+    }
+    emitTileSize();
+}
+
+void MosaicWidget::setTileSource(int index, QQueue<AVFrame*>* queue, QMutex* mutex)
+{
+    if (index < 0 || index >= MOSAIC_MAX_TILES) {
+        return;
+    }
+    m_sources[index].queue = queue;
+    m_sources[index].mutex = mutex;
+    if (m_renderThread) {
+        m_renderThread->setTileSource(index, queue, mutex);
+    }
+}
+
+void MosaicWidget::clearTile(int index)
+{
+    if (m_renderThread) {
+        m_renderThread->clearTile(index);
+    }
+}
+
+RenderStats MosaicWidget::renderStats() const
+{
+    return m_renderThread ? m_renderThread->stats() : RenderStats();
+}
+
+quint64 MosaicWidget::tileUploads() const
+{
+    return m_renderThread ? m_renderThread->tileUploads() : 0;
+}
+
+void MosaicWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    // ؼ¹ҵĶ㴰ʱĻؽɵȾ߳Ҫͣ
+    stopRenderThread();
+    delete m_program;
+
+    m_program = new QOpenGLShaderProgram(this);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, mosaicBlitVertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, mosaicBlitFragmentShaderSource);
+    m_program->link();
+    m_program->bind();
+    m_program->setUniformValue("tex_rgb", 0);
+    m_program->release();
+
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(context()->format());
+    m_surface->create();
+
+    m_renderThread = new MosaicRenderThread(context(), m_surface);
+    m_renderThread->setGrid(m_columns, m_rows);
+    m_renderThread->setTargetSize(m_pixelW, m_pixelH);
+    for (int i = 0; i < MOSAIC_MAX_TILES; ++i) {
+        if (m_sources[i].queue) {
+            m_renderThread->setTileSource(i, m_sources[i].queue, m_sources[i].mutex);
+        }
+    }
+    QObject::connect(m_renderThread, &MosaicRenderThread::frameReady, this, [this]() { update(); }, Qt::QueuedConnection);
+    m_renderThread->start();
+}
+
+void MosaicWidget::paintGL()
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!m_renderThread) {
+        return;
+    }
+
+    // ѾȾ̺߳ϳΪһ
+    GLuint texture = m_renderThread->lockFrontTexture();
+    if (texture) {
+        const GLfloat vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        const GLfloat texcoords[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        m_program->bind();
+        int vertexIn = m_program->attributeLocation("vertexIn");
+        int textureIn = m_program->attributeLocation("textureIn");
+        m_program->enableAttributeArray(vertexIn);
+        m_program->enableAttributeArray(textureIn);
+        m_program->setAttributeArray(vertexIn, GL_FLOAT, vertices, 2);
+        m_program->setAttributeArray(textureIn, GL_FLOAT, texcoords, 2);
+
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        m_program->disableAttributeArray(vertexIn);
+        m_program->disableAttributeArray(textureIn);
+        m_program->release();
+        glBindTexture(GL_TEXTURE_2D, GL_NONE);
+    }
+    m_renderThread->unlockFrontTexture();
+}
+
+void MosaicWidget::resizeGL(int w, int h)
+{
+    glViewport(0, 0, w, h);
+
+    const qreal ratio = devicePixelRatioF();
+    m_pixelW = qRound(w * ratio);
+    m_pixelH = qRound(h * ratio);
+    if (m_renderThread) {
+        m_renderThread->setTargetSize(m_pixelW, m_pixelH);
+    }
+    emitTileSize();
+}
+
+void MosaicWidget::emitTileSize()
+{
+    if (m_pixelW > 0 && m_pixelH > 0) {
+        emit sigTileSizeChanged(m_pixelW / m_columns, m_pixelH / m_rows);
+    }
+}
+
+void MosaicWidget::stopRenderThread()
+{
+    if (m_renderThread) {
+        m_renderThread->stop();
+        m_renderThread->wait();
+        delete m_renderThread;
+        m_renderThread = nullptr;
+    }
+    if (m_surface) {
+        delete m_surface;
+        m_surface = nullptr;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef MOSAICWIDGET_H
+#define MOSAICWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QMutex>
+#include <QQueue>
+extern "C" {
+#include "libavutil/frame.h"
+}
+
+#include "mosaicrenderthread.h"
+
+class QOffscreenSurface;
+
+// ǽһؼһȾ߳ʾ·棬ÿ·һ VideoWidget
+// ÿ·ʾͨ setTileSource 루RTSPPlayer::setMosaicTile
+class MosaicWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+    Q_OBJECT
+public:
+    explicit MosaicWidget(QWidget* parent = nullptr);
+    ~MosaicWidget();
+
+    void setGrid(int columns, int rows);
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+
+    void setTileSource(int index, QQueue<AVFrame*>* queue, QMutex* mutex);
+    void clearTile(int index);
+
+    RenderStats renderStats() const;
+    quint64 tileUploads() const;
+
+signals:
+    // ӵĳߴ磨أ˰С
+    void sigTileSizeChanged(int width, int height);
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+    void resizeGL(int w, int h) override;
+
+private:
+    void stopRenderThread();
+    void emitTileSize();
+
+    struct Source
+    {
+        QQueue<AVFrame*>* queue = nullptr;
+        QMutex* mutex = nullptr;
+    };
+
+    QOpenGLShaderProgram* m_program = nullptr;
+    MosaicRenderThread* m_renderThread = nullptr;
+    QOffscreenSurface* m_surface = nullptr;
+
+    Source m_sources[MOSAIC_MAX_TILES];
+    int m_columns = 2;
+    int m_rows = 2;
+    int m_pixelW = 0;
+    int m_pixelH = 0;
+};
+
+#endif // MOSAICWIDGET_H
@@ -0,0 +1,182 @@
+#include "motiondetector.h"
+#include <QDebug>
+
+extern "C" {
+#include "libavutil/pixdesc.h"
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOTION_USE_SSE2 1
+#endif
+
+static const int TARGET_WIDTH = 256; // Ŀȣ4KԼÿ15ȡһ
+
+static inline int popcount16(unsigned int v)
+{
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0F0F;
+    return (v + (v >> 8)) & 0x1F;
+}
+
+int countChangedPixels(const uint8_t* a, const uint8_t* b, int count, uint8_t threshold)
+{
+    int changed = 0;
+    int i = 0;
+#ifdef MOTION_USE_SSE2
+    const __m128i t = _mm_set1_epi8((char)threshold);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        // |a-b| = sat(a-b) | sat(b-a)
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        // diff > t  <=>  sat(diff-t) != 0
+        __m128i over = _mm_cmpeq_epi8(_mm_subs_epu8(diff, t), zero);
+        changed += popcount16(~_mm_movemask_epi8(over) & 0xFFFF);
+    }
+#endif
+    for (; i < count; ++i) {
+        int d = a[i] - b[i];
+        if (d > threshold || -d > threshold) {
+            changed++;
+        }
+    }
+    return changed;
+}
+
+MotionDetector::MotionDetector()
+{
+}
+
+void MotionDetector::setOptions(const MotionOptions& options)
+{
+    m_options = options;
+    m_options.sampleFps = qBound(1.0, m_options.sampleFps, 5.0);
+    m_options.pixelThreshold = qBound(1, m_options.pixelThreshold, 254);
+    m_reference.clear();
+    m_width = m_height = 0;
+    m_active = false;
+    m_sampleTimer.invalidate();
+}
+
+bool MotionDetector::shouldSample()
+{
+    if (!m_options.enabled) {
+        return false;
+    }
+    const qint64 interval = (qint64)(1000.0 / m_options.sampleFps);
+    if (m_sampleTimer.isValid() && m_sampleTimer.elapsed() < interval) {
+        return false;
+    }
+    m_sampleTimer.start();
+    return true;
+}
+
+bool MotionDetector::decimate(const AVFrame* frame)
+{
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_RGB) || !frame->data[0] || frame->width <= 0) {
+        return false;
+    }
+
+    const int step = qMax(1, frame->width / TARGET_WIDTH);
+    const int w = frame->width / step;
+    const int h = frame->height / step;
+    if (w != m_width || h != m_height) {
+        m_width = w;
+        m_height = h;
+        m_reference.clear();
+    }
+    m_current.resize(w * h);
+
+    // ÿȡ 2x2 ƽֵ
+    const int depth = desc->comp[0].depth;
+    const int shift = desc->comp[0].shift + (depth > 8 ? depth - 8 : 0);
+    const bool wide = desc->comp[0].step > 1;
+    const int nextRow = (step > 1 && frame->height > 1) ? frame->linesize[0] : 0;
+    const int nextCol = step > 1 ? 1 : 0;
+
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = frame->data[0] + (size_t)y * step * frame->linesize[0];
+        uint8_t* out = m_current.data() + y * w;
+        if (wide) {
+            const uint16_t* r0 = (const uint16_t*)row;
+            const uint16_t* r1 = (const uint16_t*)(row + nextRow);
+            for (int x = 0; x < w; ++x) {
+                const int c = x * step;
+                unsigned int sum = (r0[c] >> shift) + (r0[c + nextCol] >> shift)
+                    + (r1[c] >> shift) + (r1[c + nextCol] >> shift);
+                out[x] = (uint8_t)qMin(255u, (sum + 2) >> 2);
+            }
+        }
+        else {
+            const uint8_t* r1 = row + nextRow;
+            for (int x = 0; x < w; ++x) {
+                const int c = x * step;
+                out[x] = (uint8_t)((row[c] + row[c + nextCol] + r1[c] + r1[c + nextCol] + 2) >> 2);
+            }
+        }
+    }
+    return true;
+}
+
+double MotionDetector::process(const AVFrame* frame)
+{
+    if (!frame || !decimate(frame)) {
+        return -1.0;
+    }
+
+    if (m_reference.size() != m_current.size()) {
+        m_reference = m_current;
+        return -1.0;
+    }
+
+    QVector<QRectF> zones = m_options.zones;
+    if (zones.isEmpty()) {
+        zones.append(QRectF(0.0, 0.0, 1.0, 1.0));
+    }
+
+    double maxLevel = 0.0;
+    for (const QRectF& zone : zones) {
+        const QRectF clipped = zone.intersected(QRectF(0.0, 0.0, 1.0, 1.0));
+        const int x0 = (int)(clipped.left() * m_width);
+        const int x1 = (int)(clipped.right() * m_width);
+        const int y0 = (int)(clipped.top() * m_height);
+        const int y1 = (int)(clipped.bottom() * m_height);
+        const int zoneW = x1 - x0;
+        if (zoneW <= 0 || y1 <= y0) {
+            continue;
+        }
+
+        int changed = 0;
+        for (int y = y0; y < y1; ++y) {
+            const int offset = y * m_width + x0;
+            changed += countChangedPixels(m_current.constData() + offset, m_reference.constData() + offset,
+                zoneW, (uint8_t)m_options.pixelThreshold);
+        }
+        maxLevel = qMax(maxLevel, (double)changed / ((double)zoneW * (y1 - y0)));
+    }
+
+    m_reference.swap(m_current);
+    return maxLevel;
+}
+
+bool MotionDetector::updateState(double level, bool* changed)
+{
+    const bool wasActive = m_active;
+    if (level >= m_options.areaThreshold) {
+        m_lastMotionTimer.start();
+        m_active = true;
+    }
+    else if (m_active && m_lastMotionTimer.isValid()
+        && m_lastMotionTimer.elapsed() > (qint64)(m_options.holdSeconds * 1000.0)) {
+        m_active = false;
+    }
+
+    if (changed) {
+        *changed = (wasActive != m_active);
+    }
+    return m_active;
+}
@@ -0,0 +1,59 @@
+#ifndef MOTIONDETECTOR_H
+#define MOTIONDETECTOR_H
+
+#include <QRectF>
+#include <QVector>
+#include <QElapsedTimer>
+
+extern "C" {
+#include "libavutil/frame.h"
+}
+
+// ƶ
+struct MotionOptions
+{
+    bool enabled = false;
+    double sampleFps = 2.0;       // ֡ʣ1-5 fps
+    int pixelThreshold = 25;      // ȲֵΪ仯 (0-255)
+    double areaThreshold = 0.02;  // ڱ仯ռȳֵΪƶ
+    double holdSeconds = 10.0;    // һμ⵽ƶ󱣳ֶòΪƶ
+    QVector<QRectF> zones;        // һ(0-1)ļΪձʾ
+};
+
+// ڳСYƽ֡رȽʹSSE2
+class MotionDetector
+{
+public:
+    MotionDetector();
+
+    void setOptions(const MotionOptions& options);
+    const MotionOptions& options() const { return m_options; }
+
+    // ֡ʾһ֡ǷҪ
+    bool shouldSample();
+
+    // һ֡⣬ر仯ı仯ռȣһ֡ûвο֡ʱ -1
+    double process(const AVFrame* frame);
+
+    // ļͱʱжϵǰǷƶ״̬
+    bool updateState(double level, bool* changed);
+    bool isActive() const { return m_active; }
+
+private:
+    bool decimate(const AVFrame* frame);
+
+    MotionOptions m_options;
+    QElapsedTimer m_sampleTimer;
+    QElapsedTimer m_lastMotionTimer;
+    bool m_active = false;
+
+    QVector<uint8_t> m_current;   // ǰͼ
+    QVector<uint8_t> m_reference; // һγͼ
+    int m_width = 0;
+    int m_height = 0;
+};
+
+// ͳвֵ threshold ظ
+int countChangedPixels(const uint8_t* a, const uint8_t* b, int count, uint8_t threshold);
+
+#endif // MOTIONDETECTOR_H
@@ -0,0 +1,204 @@
+#include "packetcapture.h"
+#include <QDebug>
+
+#define PACKET_CAPTURE_MAX_PACKET (64u * 1024 * 1024)   // Сļ
+
+PacketCaptureWriter::PacketCaptureWriter()
+{
+}
+
+PacketCaptureWriter::~PacketCaptureWriter()
+{
+    close();
+}
+
+bool PacketCaptureWriter::open(const QString& filePath, const AVStream* stream)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Packet capture: cannot create" << filePath << m_file.errorString();
+        return false;
+    }
+
+    const AVCodecParameters* par = stream->codecpar;
+    PacketCaptureHeader header = {};
+    header.magic = PACKET_CAPTURE_MAGIC;
+    header.version = PACKET_CAPTURE_VERSION;
+    header.timeBaseNum = stream->time_base.num;
+    header.timeBaseDen = stream->time_base.den;
+    header.frameRateNum = stream->avg_frame_rate.num;
+    header.frameRateDen = stream->avg_frame_rate.den;
+    header.codecId = par->codec_id;
+    header.codecTag = par->codec_tag;
+    header.format = par->format;
+    header.width = par->width;
+    header.height = par->height;
+    header.profile = par->profile;
+    header.level = par->level;
+    header.colorRange = par->color_range;
+    header.colorPrimaries = par->color_primaries;
+    header.colorTrc = par->color_trc;
+    header.colorSpace = par->color_space;
+    header.chromaLocation = par->chroma_location;
+    header.fieldOrder = par->field_order;
+    header.sarNum = par->sample_aspect_ratio.num;
+    header.sarDen = par->sample_aspect_ratio.den;
+    header.extradataSize = par->extradata ? par->extradata_size : 0;
+    header.bitRate = par->bit_rate;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (header.extradataSize > 0) {
+        m_file.write(reinterpret_cast<const char*>(par->extradata), header.extradataSize);
+    }
+
+    m_started = false;
+    m_packets = 0;
+    qDebug() << "Packet capture started:" << filePath;
+    return true;
+}
+
+void PacketCaptureWriter::write(const AVPacket* packet)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (!m_started) {
+        // ӹؼ֡ʼطʱһܽ
+        if (!key) {
+            return;
+        }
+        m_started = true;
+        m_clock.start();
+    }
+
+    PacketCaptureRecord record = {};
+    record.arrivalUs = m_clock.nsecsElapsed() / 1000;
+    record.pts = packet->pts;
+    record.dts = packet->dts;
+    record.duration = packet->duration;
+    record.flags = packet->flags;
+    record.size = packet->size;
+    m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_file.write(reinterpret_cast<const char*>(packet->data), packet->size);
+    ++m_packets;
+
+    // ÿGOPһ̣쳣˳ʱඪһGOP
+    if (key) {
+        m_file.flush();
+    }
+}
+
+void PacketCaptureWriter::close()
+{
+    if (m_file.isOpen()) {
+        qDebug() << "Packet capture finished:" << m_file.fileName() << m_packets << "packets";
+        m_file.close();
+    }
+}
+
+PacketCaptureReader::PacketCaptureReader()
+{
+}
+
+PacketCaptureReader::~PacketCaptureReader()
+{
+    close();
+}
+
+bool PacketCaptureReader::open(const QString& filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Packet capture: cannot open" << filePath << m_file.errorString();
+        return false;
+    }
+    if (m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) != sizeof(m_header)
+        || m_header.magic != PACKET_CAPTURE_MAGIC || m_header.version != PACKET_CAPTURE_VERSION
+        || m_header.timeBaseNum <= 0 || m_header.timeBaseDen <= 0 || m_header.extradataSize < 0) {
+        qWarning() << "Packet capture: invalid file" << filePath;
+        close();
+        return false;
+    }
+    m_extradata = m_file.read(m_header.extradataSize);
+    if (m_extradata.size() != m_header.extradataSize) {
+        qWarning() << "Packet capture: truncated header" << filePath;
+        close();
+        return false;
+    }
+    m_firstRecordPos = m_file.pos();
+    return true;
+}
+
+void PacketCaptureReader::close()
+{
+    m_file.close();
+    m_extradata.clear();
+    m_header = {};
+}
+
+bool PacketCaptureReader::fillCodecParameters(AVCodecParameters* par) const
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    par->codec_type = AVMEDIA_TYPE_VIDEO;
+    par->codec_id = (AVCodecID)m_header.codecId;
+    par->codec_tag = m_header.codecTag;
+    par->format = m_header.format;
+    par->width = m_header.width;
+    par->height = m_header.height;
+    par->profile = m_header.profile;
+    par->level = m_header.level;
+    par->color_range = (AVColorRange)m_header.colorRange;
+    par->color_primaries = (AVColorPrimaries)m_header.colorPrimaries;
+    par->color_trc = (AVColorTransferCharacteristic)m_header.colorTrc;
+    par->color_space = (AVColorSpace)m_header.colorSpace;
+    par->chroma_location = (AVChromaLocation)m_header.chromaLocation;
+    par->field_order = (AVFieldOrder)m_header.fieldOrder;
+    par->sample_aspect_ratio = AVRational{ m_header.sarNum, m_header.sarDen };
+    par->bit_rate = m_header.bitRate;
+
+    av_freep(&par->extradata);
+    par->extradata_size = 0;
+    if (!m_extradata.isEmpty()) {
+        par->extradata = (uint8_t*)av_mallocz(m_extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!par->extradata) {
+            return false;
+        }
+        memcpy(par->extradata, m_extradata.constData(), m_extradata.size());
+        par->extradata_size = m_extradata.size();
+    }
+    return true;
+}
+
+bool PacketCaptureReader::readPacket(AVPacket* out, qint64* arrivalUs)
+{
+    PacketCaptureRecord record;
+    if (m_file.read(reinterpret_cast<char*>(&record), sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    if (record.size > PACKET_CAPTURE_MAX_PACKET || av_new_packet(out, (int)record.size) < 0) {
+        return false;
+    }
+    if (m_file.read(reinterpret_cast<char*>(out->data), record.size) != (qint64)record.size) {
+        av_packet_unref(out);
+        return false;
+    }
+    out->pts = record.pts;
+    out->dts = record.dts;
+    out->duration = record.duration;
+    out->flags = (int)record.flags;
+    if (arrivalUs) {
+        *arrivalUs = record.arrivalUs;
+    }
+    return true;
+}
+
+bool PacketCaptureReader::rewind()
+{
+    return m_file.isOpen() && m_file.seek(m_firstRecordPos);
+}
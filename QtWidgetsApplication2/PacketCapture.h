@@ -0,0 +1,106 @@
+#ifndef PACKETCAPTURE_H
+#define PACKETCAPTURE_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+// ץļԭ⸴óƵʱͽûĻϸֳ
+// ֣128 ֽļͷ + extradata +  (40 ֽڼ¼ͷ + )
+// ʱӵһдİǹؼ֡ʼʱλ΢
+#define PACKET_CAPTURE_MAGIC 0x50414352u   // "RCAP"
+#define PACKET_CAPTURE_VERSION 1
+
+struct PacketCaptureHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32 timeBaseNum;
+    qint32 timeBaseDen;
+    qint32 frameRateNum;
+    qint32 frameRateDen;
+    qint32 codecId;
+    quint32 codecTag;
+    qint32 format;
+    qint32 width;
+    qint32 height;
+    qint32 profile;
+    qint32 level;
+    qint32 colorRange;
+    qint32 colorPrimaries;
+    qint32 colorTrc;
+    qint32 colorSpace;
+    qint32 chromaLocation;
+    qint32 fieldOrder;
+    qint32 sarNum;
+    qint32 sarDen;
+    qint32 extradataSize;
+    qint64 bitRate;
+    quint64 reserved[4];
+};
+static_assert(sizeof(PacketCaptureHeader) == 128, "PacketCaptureHeader layout changed");
+
+struct PacketCaptureRecord
+{
+    qint64 arrivalUs;
+    qint64 pts;
+    qint64 dts;
+    qint64 duration;
+    quint32 flags;
+    quint32 size;
+};
+static_assert(sizeof(PacketCaptureRecord) == 40, "PacketCaptureRecord layout changed");
+
+//  DemuxThread ڶ߳д룬ӵһؼ֡ʼ
+class PacketCaptureWriter
+{
+public:
+    PacketCaptureWriter();
+    ~PacketCaptureWriter();
+
+    bool open(const QString& filePath, const AVStream* stream);
+    void write(const AVPacket* packet);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    qint64 packetsWritten() const { return m_packets; }
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    bool m_started = false;
+    qint64 m_packets = 0;
+};
+
+class PacketCaptureReader
+{
+public:
+    PacketCaptureReader();
+    ~PacketCaptureReader();
+
+    bool open(const QString& filePath);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    AVRational timeBase() const { return AVRational{ m_header.timeBaseNum, m_header.timeBaseDen }; }
+    AVRational frameRate() const { return AVRational{ m_header.frameRateNum, m_header.frameRateDen }; }
+    // ļͷеĽ par extradata
+    bool fillCodecParameters(AVCodecParameters* par) const;
+
+    // һ*arrivalUs Ϊץʱĵʱ䣻ļ¼ץжϣ false
+    bool readPacket(AVPacket* out, qint64* arrivalUs);
+    // صһ
+    bool rewind();
+
+private:
+    QFile m_file;
+    PacketCaptureHeader m_header = {};
+    QByteArray m_extradata;
+    qint64 m_firstRecordPos = 0;
+};
+
+#endif // PACKETCAPTURE_H
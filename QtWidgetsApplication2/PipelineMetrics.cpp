@@ -0,0 +1,152 @@
+#include "pipelinemetrics.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QThread>
+#include <QVector>
+#include <cstring>
+
+// ڼ¼߳ÿ100msˢһ̱ûͷŵĲ۳ʱɱռ
+#define METRICS_STALE_MS 60000
+
+static QMutex s_metricsMutex;
+static QSharedMemory* s_sharedMemory = nullptr;
+static bool s_sharedMemoryFailed = false;
+// ڴ治ʱʹõ˽п飬ͷźŻ︴ö delete
+// Գоָ̣߳Ⱦ̣߳һдҲԽ
+static QVector<StreamMetrics*> s_localPool;
+
+MetricsSegment* PipelineMetrics::segment()
+{
+    QMutexLocker locker(&s_metricsMutex);
+    if (s_sharedMemory) {
+        return static_cast<MetricsSegment*>(s_sharedMemory->data());
+    }
+    if (s_sharedMemoryFailed) {
+        return nullptr;
+    }
+
+    QSharedMemory* shm = new QSharedMemory(METRICS_SHM_KEY);
+    bool created = shm->create(sizeof(MetricsSegment));
+    if (!created && !shm->attach()) {
+        qWarning() << "Metrics shared memory unavailable:" << shm->errorString();
+        delete shm;
+        s_sharedMemoryFailed = true;
+        return nullptr;
+    }
+
+    MetricsSegment* seg = static_cast<MetricsSegment*>(shm->data());
+    if (created) {
+        shm->lock();
+        memset(seg, 0, sizeof(MetricsSegment));
+        seg->header.magic = METRICS_MAGIC;
+        seg->header.version = METRICS_VERSION;
+        seg->header.maxStreams = METRICS_MAX_STREAMS;
+        seg->header.streamSize = sizeof(StreamMetrics);
+        shm->unlock();
+    }
+    else {
+        // һ̸մûüдͷ
+        for (int i = 0; i < 100 && seg->header.magic == 0; ++i) {
+            QThread::msleep(1);
+        }
+    }
+
+    if (shm->size() < (int)sizeof(MetricsSegment) || seg->header.magic != METRICS_MAGIC
+        || seg->header.version != METRICS_VERSION) {
+        qWarning() << "Metrics shared memory has an incompatible layout, metrics stay private";
+        delete shm;
+        s_sharedMemoryFailed = true;
+        return nullptr;
+    }
+
+    s_sharedMemory = shm;
+    return seg;
+}
+
+void PipelineMetrics::resetSlot(StreamMetrics* metrics)
+{
+    std::atomic<quint64>* counters[] = {
+        &metrics->packetsIn, &metrics->bytesIn, &metrics->keyframesIn, &metrics->streamOpens,
+        &metrics->streamFailures, &metrics->decodeQueueDepth, &metrics->recordQueueDepth,
+        &metrics->framesDecoded, &metrics->framesDropped, &metrics->decodeTimeUs, &metrics->showQueueDepth,
+        &metrics->packetsWritten, &metrics->bytesWritten, &metrics->filesClosed, &metrics->recording,
+        &metrics->framesPresented, &metrics->renderQueueDepth,
+    };
+    for (std::atomic<quint64>* counter : counters) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    memset(metrics->name, 0, sizeof(metrics->name));
+}
+
+StreamMetrics* PipelineMetrics::acquire(const QString& name)
+{
+    MetricsSegment* seg = segment();
+    const quint64 pid = (quint64)QCoreApplication::applicationPid();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (seg) {
+        for (int i = 0; i < METRICS_MAX_STREAMS; ++i) {
+            StreamMetrics* slot = &seg->streams[i];
+            quint64 owner = slot->ownerPid.load(std::memory_order_acquire);
+            bool stale = owner != 0 && owner != pid
+                && now - (qint64)slot->heartbeatMs.load(std::memory_order_relaxed) > METRICS_STALE_MS;
+            if ((owner == 0 || stale)
+                && slot->ownerPid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+                resetSlot(slot);
+                setName(slot, name);
+                slot->heartbeatMs.store((quint64)now, std::memory_order_release);
+                return slot;
+            }
+        }
+        qWarning() << "Metrics shared memory is full, stream" << name << "is not exported";
+    }
+
+    StreamMetrics* local = nullptr;
+    {
+        QMutexLocker locker(&s_metricsMutex);
+        if (!s_localPool.isEmpty()) {
+            local = s_localPool.takeLast();
+        }
+    }
+    if (!local) {
+        local = new StreamMetrics;
+        memset(local, 0, sizeof(StreamMetrics));
+    }
+    resetSlot(local);
+    local->ownerPid.store(pid, std::memory_order_relaxed);
+    setName(local, name);
+    return local;
+}
+
+void PipelineMetrics::release(StreamMetrics* metrics)
+{
+    if (!metrics) {
+        return;
+    }
+    MetricsSegment* seg = segment();
+    if (seg && metrics >= seg->streams && metrics < seg->streams + METRICS_MAX_STREAMS) {
+        metrics->ownerPid.store(0, std::memory_order_release);
+        return;
+    }
+    QMutexLocker locker(&s_metricsMutex);
+    s_localPool.append(metrics);
+}
+
+void PipelineMetrics::setName(StreamMetrics* metrics, const QString& name)
+{
+    if (!metrics) {
+        return;
+    }
+    QByteArray utf8 = name.toUtf8().left(METRICS_NAME_SIZE - 1);
+    char buffer[METRICS_NAME_SIZE] = { 0 };
+    memcpy(buffer, utf8.constData(), utf8.size());
+    memcpy(metrics->name, buffer, sizeof(buffer));
+}
+
+void PipelineMetrics::heartbeat(StreamMetrics* metrics)
+{
+    metricsSet(metrics, &StreamMetrics::heartbeatMs, (quint64)QDateTime::currentMSecsSinceEpoch());
+}
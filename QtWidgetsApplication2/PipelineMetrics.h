@@ -0,0 +1,100 @@
+#ifndef PIPELINEMETRICS_H
+#define PIPELINEMETRICS_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// ڴеͳƣⲿسMetricsReaderȡ
+// ̶ֹֻ8ֽԭͶ飬Ķֶʱ METRICS_VERSION
+#define METRICS_SHM_KEY "QtRtspPlayer.Metrics"
+#define METRICS_MAGIC 0x5352544Du   // "MTRS"
+#define METRICS_VERSION 1
+#define METRICS_MAX_STREAMS 64
+#define METRICS_NAME_SIZE 64
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "metrics need lock-free 64-bit atomics in shared memory");
+
+// ·ļֻdepth/recording Ϊǰֵ
+struct StreamMetrics
+{
+    std::atomic<quint64> ownerPid;          // 0 ʾв
+    std::atomic<quint64> heartbeatMs;       // һθʱ䣨1970ĺ룩
+    char name[METRICS_NAME_SIZE];           // ַƣ0β
+
+    // DemuxThread
+    std::atomic<quint64> packetsIn;
+    std::atomic<quint64> bytesIn;
+    std::atomic<quint64> keyframesIn;
+    std::atomic<quint64> streamOpens;
+    std::atomic<quint64> streamFailures;
+    std::atomic<quint64> decodeQueueDepth;
+    std::atomic<quint64> recordQueueDepth;
+
+    // DecodeThread
+    std::atomic<quint64> framesDecoded;
+    std::atomic<quint64> framesDropped;
+    std::atomic<quint64> decodeTimeUs;
+    std::atomic<quint64> showQueueDepth;
+
+    // RecordThread
+    std::atomic<quint64> packetsWritten;
+    std::atomic<quint64> bytesWritten;
+    std::atomic<quint64> filesClosed;
+    std::atomic<quint64> recording;
+
+    // RenderThread / VideoWidget
+    std::atomic<quint64> framesPresented;
+    std::atomic<quint64> renderQueueDepth;
+
+    quint64 reserved[5];
+};
+static_assert(sizeof(StreamMetrics) == 256, "StreamMetrics layout changed");
+
+struct MetricsHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 maxStreams;
+    quint32 streamSize;
+    quint64 reserved[6];
+};
+static_assert(sizeof(MetricsHeader) == 64, "MetricsHeader layout changed");
+
+struct MetricsSegment
+{
+    MetricsHeader header;
+    StreamMetrics streams[METRICS_MAX_STREAMS];
+};
+
+// ¼ֻ relaxed ԭӲ·ûж⿪
+inline void metricsAdd(StreamMetrics* metrics, std::atomic<quint64> StreamMetrics::* counter, quint64 value = 1)
+{
+    if (metrics) {
+        (metrics->*counter).fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+inline void metricsSet(StreamMetrics* metrics, std::atomic<quint64> StreamMetrics::* gauge, quint64 value)
+{
+    if (metrics) {
+        (metrics->*gauge).store(value, std::memory_order_relaxed);
+    }
+}
+
+class PipelineMetrics
+{
+public:
+    // ڹڴռһۣڴ治ûʱؽڵ˽п飬÷ж
+    // صڴڽ̽ǰһֱЧrelease ֮д벻
+    static StreamMetrics* acquire(const QString& name);
+    static void release(StreamMetrics* metrics);
+    static void setName(StreamMetrics* metrics, const QString& name);
+    static void heartbeat(StreamMetrics* metrics);
+
+private:
+    static MetricsSegment* segment();
+    static void resetSlot(StreamMetrics* metrics);
+};
+
+#endif // PIPELINEMETRICS_H
@@ -0,0 +1,395 @@
+#include "playbackthread.h"
+#include "threadpolicy.h"
+#include "decodethread.h"
+#include <QDebug>
+
+#define MAX_PLAYBACK_DECODE_QUEUE 30
+#define TRICK_KEYFRAMES_PER_SEC 8       // /ʱÿĹؼ֡
+#define TRICK_MAX_SCAN_PACKETS 2000     // һؼ֡ʱİ
+
+PlaybackThread::PlaybackThread(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex, QObject* parent)
+    : DemuxThread(decodeQueue, decodeMutex, nullptr, nullptr, parent)
+{
+}
+
+PlaybackThread::~PlaybackThread()
+{
+    stop();
+    wait();
+}
+
+void PlaybackThread::seek(double seconds)
+{
+    m_seekMs = (qint64)(qMax(0.0, seconds) * 1000.0);
+}
+
+void PlaybackThread::setSpeed(double speed)
+{
+    if (speed == 0.0) {
+        return;
+    }
+    m_speed = qBound(-256.0, speed, 256.0);
+}
+
+void PlaybackThread::clearDecodeQueue()
+{
+    m_decodeEdge.clear();
+}
+
+void PlaybackThread::setDecoder(DecodeThread* decoder)
+{
+    QMutexLocker locker(&m_decoderMutex);
+    m_decoder = decoder;
+}
+
+void PlaybackThread::requestDecoderFlush(int64_t skipUntilPts)
+{
+    QMutexLocker locker(&m_decoderMutex);
+    if (m_decoder) {
+        m_decoder->requestFlush(skipUntilPts);
+    }
+}
+
+bool PlaybackThread::seekToPts(int64_t targetPts)
+{
+    const AVRational timeBase = m_videoStream->time_base;
+
+    if (m_hasIndex) {
+        const int i = m_index.find(av_rescale_q(targetPts, timeBase, m_index.timeBase()));
+        if (i >= 0) {
+            const RecordIndexEntry& entry = m_index.at(i);
+            // ְֽ֧ڶλĸʽts/flv ȣֱؼ֡λ
+            if (!(m_formatCtx->iformat->flags & AVFMT_NO_BYTE_SEEK) && entry.offset >= 0
+                && av_seek_frame(m_formatCtx, -1, entry.offset, AVSEEK_FLAG_BYTE) >= 0) {
+                return true;
+            }
+            // MP4 ֽܰڶλѾ֪ؼ֡׼ȷPTSdemuxer ǰ
+            const int64_t keyPts = av_rescale_q(entry.pts, m_index.timeBase(), timeBase);
+            if (avformat_seek_file(m_formatCtx, m_videoStreamIndex, INT64_MIN, keyPts, keyPts, 0) >= 0) {
+                return true;
+            }
+        }
+    }
+
+    // û¼ʱ demuxer Ŀ֮ǰĹؼ֡
+    return avformat_seek_file(m_formatCtx, m_videoStreamIndex, INT64_MIN, targetPts, targetPts, 0) >= 0;
+}
+
+AVPacket* PlaybackThread::readKeyframe(int64_t targetPts, int64_t currentPts, bool forward)
+{
+    const AVRational timeBase = m_videoStream->time_base;
+
+    if (m_hasIndex && m_index.count() > 0) {
+        // ֱѡؼ֡ĿڵǰGOPʱǰ/һ
+        const int current = m_index.find(av_rescale_q(currentPts, timeBase, m_index.timeBase()));
+        int i = m_index.find(av_rescale_q(targetPts, timeBase, m_index.timeBase()));
+        i = forward ? qMax(i, current + 1) : qMin(i, current - 1);
+        if (i < 0 || i >= m_index.count()) {
+            return nullptr;
+        }
+        targetPts = av_rescale_q(m_index.at(i).pts, m_index.timeBase(), timeBase);
+    }
+
+    // ûĵÿǰһЩֱҵȵǰĹؼ֡
+    int64_t backStep = qMax<int64_t>(currentPts - targetPts, av_rescale_q(1, AVRational{ 1, 1 }, timeBase));
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        if (!forward && targetPts < m_startPts - backStep) {
+            return nullptr;
+        }
+        if (!seekToPts(targetPts)) {
+            return nullptr;
+        }
+
+        AVPacket* packet = av_packet_alloc();
+        for (int scanned = 0; scanned < TRICK_MAX_SCAN_PACKETS && !m_stopped; ++scanned) {
+            m_interruptCallbackData.timer.restart();
+            if (av_read_frame(m_formatCtx, packet) < 0) {
+                av_packet_free(&packet);
+                return nullptr;
+            }
+            // ǹؼֻ֡
+            if (packet->stream_index != m_videoStreamIndex || !(packet->flags & AV_PKT_FLAG_KEY)) {
+                av_packet_unref(packet);
+                continue;
+            }
+            const int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            if (ts != AV_NOPTS_VALUE && (forward ? ts > currentPts : ts < currentPts)) {
+                m_bytesRead.fetch_add(packet->size, std::memory_order_relaxed);
+                m_packetsRead.fetch_add(1, std::memory_order_relaxed);
+                return packet;
+            }
+            av_packet_unref(packet);
+            if (!forward) {
+                break;  // ҵĹؼ֡ȵǰ磬ǰ
+            }
+        }
+        av_packet_free(&packet);
+        if (forward) {
+            return nullptr;
+        }
+        targetPts -= backStep;
+        backStep *= 2;
+    }
+    return nullptr;
+}
+
+void PlaybackThread::run()
+{
+    ThreadPolicyScope policyScope(StageDemux);
+    m_formatCtx = avformat_alloc_context();
+    if (!m_formatCtx)
+    {
+        qCritical() << "Could not allocate format context";
+        return;
+    }
+
+    // ļᳬʱصֻӦ stop()
+    m_interruptCallbackData.timeout_ms = 5000;
+    m_interruptCallbackData.timer.start();
+    m_formatCtx->interrupt_callback.callback = interrupt_callback;
+    m_formatCtx->interrupt_callback.opaque = &m_interruptCallbackData;
+
+    int ret = avformat_open_input(&m_formatCtx, m_url.toStdString().c_str(), nullptr, nullptr);
+    if (ret < 0)
+    {
+        char errbuf[1024] = { 0 };
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        qCritical() << "Could not open recording:" << m_url << "Error:" << errbuf;
+        m_formatCtx = nullptr;
+        emit sigStreamFailed(u8"޷¼ļ");
+        return;
+    }
+
+    if (avformat_find_stream_info(m_formatCtx, nullptr) < 0
+        || (m_videoStreamIndex = av_find_best_stream(m_formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0)) < 0)
+    {
+        qCritical() << "Could not find video stream in recording" << m_url;
+        avformat_close_input(&m_formatCtx);
+        emit sigStreamFailed(u8"¼ļûƵ");
+        return;
+    }
+    m_videoStream = m_formatCtx->streams[m_videoStreamIndex];
+
+    const AVRational timeBase = m_videoStream->time_base;
+    m_startPts = m_videoStream->start_time != AV_NOPTS_VALUE ? m_videoStream->start_time : 0;
+    if (m_formatCtx->duration != AV_NOPTS_VALUE) {
+        m_durationMs = m_formatCtx->duration / 1000;
+    }
+    else if (m_videoStream->duration != AV_NOPTS_VALUE) {
+        m_durationMs = (qint64)(m_videoStream->duration * av_q2d(timeBase) * 1000.0);
+    }
+    m_hasIndex = m_index.open(m_url);
+    if (!m_hasIndex) {
+        qDebug() << "No keyframe index for" << m_url << ", seeking falls back to the demuxer";
+    }
+    metricsAdd(m_metrics, &StreamMetrics::streamOpens);
+    emit sigStreamOpened();
+
+    QElapsedTimer clock;
+    clock.start();
+
+    // ԵһDTSǽӣͣڼѻ׼ƣͬ TimeshiftThread
+    int64_t basePts = AV_NOPTS_VALUE;
+    qint64 baseMs = 0;
+    qint64 pausedAt = -1;
+    int64_t skipUntil = AV_NOPTS_VALUE;  // תĿ֮ǰİȴ뵽Ŀ֡
+    AVPacket* pending = nullptr;
+    bool eof = false;
+
+    // ؼ֡ģʽ/ˣ״̬
+    bool trickActive = false;
+    bool trickEnd = false;
+    int64_t trickPts = AV_NOPTS_VALUE;  // ͳĹؼ֡
+    qint64 trickDueMs = 0;
+    double lastSpeed = m_speed;
+
+    while (!m_stopped)
+    {
+        const qint64 seekMs = m_seekMs.exchange(-1);
+        if (seekMs >= 0) {
+            if (pending) {
+                av_packet_free(&pending);
+            }
+            const int64_t target = m_startPts + av_rescale_q(seekMs, AVRational{ 1, 1000 }, timeBase);
+            if (seekToPts(target)) {
+                // С֪֮ͨͽȥĵһһ flush ֮
+                clearDecodeQueue();
+                requestDecoderFlush(target);
+                skipUntil = target;
+                basePts = AV_NOPTS_VALUE;
+                eof = false;
+                m_positionMs = seekMs;
+                trickPts = target;
+                trickEnd = false;
+                trickDueMs = clock.elapsed();
+            }
+            else {
+                qWarning() << "Seek failed in" << m_url << "at" << seekMs << "ms";
+            }
+        }
+
+        const double speed = m_speed;
+        if (speed != lastSpeed) {
+            lastSpeed = speed;
+            basePts = AV_NOPTS_VALUE;  // ٱˣ¶ǽ
+        }
+
+        if (isTrickSpeed(speed)) {
+            if (!trickActive) {
+                // Ŷӵֻͨ֡չؼ֡
+                if (pending) {
+                    av_packet_free(&pending);
+                }
+                clearDecodeQueue();
+                // ֻؼ֡ɲñʱлؽʱҲϣ
+                requestDecoderFlush();
+                trickActive = true;
+                trickEnd = false;
+                trickPts = m_startPts + av_rescale_q(m_positionMs, AVRational{ 1, 1000 }, timeBase);
+                trickDueMs = clock.elapsed();
+            }
+            if (m_paused || trickEnd || m_stopped) {
+                msleep(10);
+                continue;
+            }
+
+            const qint64 now = clock.elapsed();
+            if (now < trickDueMs) {
+                msleep((unsigned long)qMin<qint64>(trickDueMs - now, 10));
+                continue;
+            }
+
+            // ûһؼ֡͵ȣʾҲѹ
+            if (m_decodeEdge.size() >= 2) {
+                msleep(5);
+                continue;
+            }
+
+            // ÿýʱǰ speed * ֻȡһĹؼ֡
+            const qint64 intervalMs = 1000 / TRICK_KEYFRAMES_PER_SEC;
+            const int64_t target = trickPts + (int64_t)(speed * intervalMs / 1000.0 / av_q2d(timeBase));
+            AVPacket* key = readKeyframe(target, trickPts, speed > 0.0);
+            if (!key) {
+                qDebug() << (speed > 0.0 ? "Fast-forward reached the end" : "Reverse reached the beginning");
+                trickEnd = true;
+                emit sigPlaybackFinished();
+                continue;
+            }
+
+            const int64_t prevPts = trickPts;
+            trickPts = key->pts != AV_NOPTS_VALUE ? key->pts : key->dts;
+            m_positionMs = (qint64)((trickPts - m_startPts) * av_q2d(timeBase) * 1000.0);
+            metricsAdd(m_metrics, &StreamMetrics::packetsIn);
+            metricsAdd(m_metrics, &StreamMetrics::bytesIn, key->size);
+            m_decodeEdge.enqueue(key);
+
+            // ʵѡеĹؼ֡ƽࣺGOP  speed * ʱreadKeyframe ٿһGOP
+            // һ֡Ҫȵýʱ䰴ٲ꣬ͱҲᰴÿһGOPٶ
+            const qint64 stepMs = (qint64)(qAbs(trickPts - prevPts) * av_q2d(timeBase) * 1000.0 / qAbs(speed));
+            trickDueMs += qMax(intervalMs, stepMs);
+            if (trickDueMs < now - intervalMs) {
+                trickDueMs = now;  // ʱ׷
+            }
+            continue;
+        }
+        if (trickActive) {
+            // صţӵǰؼ֡¿ʼ֡
+            trickActive = false;
+            qint64 expected = -1;
+            m_seekMs.compare_exchange_strong(expected, m_positionMs.load());
+            continue;
+        }
+
+        const bool paused = m_paused;
+        if (paused && skipUntil == AV_NOPTS_VALUE) {
+            if (pausedAt < 0) {
+                pausedAt = clock.elapsed();
+            }
+            msleep(10);
+            continue;
+        }
+        if (!paused && pausedAt >= 0) {
+            baseMs += clock.elapsed() - pausedAt;
+            pausedAt = -1;
+        }
+
+        if (!pending) {
+            if (eof) {
+                msleep(10);
+                continue;
+            }
+            pending = av_packet_alloc();
+            m_interruptCallbackData.timer.restart();
+            ret = av_read_frame(m_formatCtx, pending);
+            if (ret < 0) {
+                av_packet_free(&pending);
+                if (m_stopped) break;
+                if (ret == AVERROR_EOF) {
+                    // ͣһ֡Ȼ
+                    qDebug() << "End of recording reached.";
+                    eof = true;
+                    skipUntil = AV_NOPTS_VALUE;
+                    emit sigPlaybackFinished();
+                    continue;
+                }
+                char errbuf[1024] = { 0 };
+                av_strerror(ret, errbuf, sizeof(errbuf));
+                qWarning() << "av_read_frame error:" << errbuf;
+                emit sigStreamFailed(u8"ȡ¼ļʧܡ");
+                break;
+            }
+            if (pending->stream_index != m_videoStreamIndex) {
+                av_packet_free(&pending);
+                continue;
+            }
+            m_bytesRead.fetch_add(pending->size, std::memory_order_relaxed);
+            m_packetsRead.fetch_add(1, std::memory_order_relaxed);
+            metricsAdd(m_metrics, &StreamMetrics::packetsIn);
+            metricsAdd(m_metrics, &StreamMetrics::bytesIn, pending->size);
+        }
+
+        // ļ DTS ˳ƽ
+        const int64_t ts = pending->dts != AV_NOPTS_VALUE ? pending->dts : pending->pts;
+        const bool reachedTarget = skipUntil == AV_NOPTS_VALUE || (ts != AV_NOPTS_VALUE && ts >= skipUntil);
+        if (ts != AV_NOPTS_VALUE && reachedTarget && !paused) {
+            if (basePts == AV_NOPTS_VALUE || ts < basePts) {
+                basePts = ts;
+                baseMs = clock.elapsed();
+            }
+            const qint64 dueMs = baseMs + (qint64)((ts - basePts) * av_q2d(timeBase) * 1000.0 / speed);
+            const qint64 waitMs = dueMs - clock.elapsed();
+            if (waitMs > 0) {
+                msleep((unsigned long)qMin<qint64>(waitMs, 10));
+                continue;
+            }
+        }
+
+        // ̱Ƚ죬Լ٣˵Ĺؼ֡
+        const bool full = m_decodeEdge.size() >= MAX_PLAYBACK_DECODE_QUEUE;
+        if (!full) {
+            const int depth = m_decodeEdge.enqueue(pending);
+            pending = nullptr;
+            metricsSet(m_metrics, &StreamMetrics::decodeQueueDepth, qMax(depth, 0));
+        }
+        if (full) {
+            msleep(5);
+            continue;
+        }
+
+        if (ts != AV_NOPTS_VALUE && reachedTarget) {
+            skipUntil = AV_NOPTS_VALUE;
+            m_positionMs = (qint64)((ts - m_startPts) * av_q2d(timeBase) * 1000.0);
+        }
+    }
+
+    if (pending) {
+        av_packet_free(&pending);
+    }
+    m_index.close();
+    if (m_formatCtx)
+    {
+        avformat_close_input(&m_formatCtx);
+        m_formatCtx = nullptr;
+    }
+    qDebug() << "Playback thread finished.";
+}
@@ -0,0 +1,63 @@
+#ifndef PLAYBACKTHREAD_H
+#define PLAYBACKTHREAD_H
+
+#include "demuxthread.h"
+#include "recordindex.h"
+
+class DecodeThread;
+
+// ¼طţ DemuxThread ļPTSƵͽ
+//  RecordThread д .idx ʱתֱӲλؼ֡Ҫļز
+class PlaybackThread : public DemuxThread
+{
+    Q_OBJECT
+public:
+    PlaybackThread(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex, QObject* parent = nullptr);
+    ~PlaybackThread();
+
+    // ת¼ seconds 룬ɻط߳һѭִУͣʱҲĿ֡ȥ
+    void seek(double seconds);
+    void setPaused(bool paused) { m_paused = paused; }
+    bool isPaused() const { return m_paused; }
+
+    // طű٣0 < speed <= 2 ʱ֡룬ֻıࣻΪţʱؼ֡ģʽ
+    // ÿ͹̶Ĺؼ֡ȥ룬мĹؼ֡CPU ռ뱶޹
+    void setSpeed(double speed);
+    double speed() const { return m_speed; }
+    static bool isTrickSpeed(double speed) { return speed < 0.0 || speed > 2.0; }
+
+    double durationSeconds() const { return m_durationMs / 1000.0; }
+    double positionSeconds() const { return m_positionMs / 1000.0; }
+    bool hasIndex() const { return m_hasIndex; }
+
+    // תҪ flush Ḷ̌߳ɲڴáͷǰÿ
+    void setDecoder(DecodeThread* decoder);
+
+signals:
+    void sigPlaybackFinished();
+
+protected:
+    void run() override;
+
+private:
+    bool seekToPts(int64_t targetPts);
+    void clearDecodeQueue();
+    void requestDecoderFlush(int64_t skipUntilPts = AV_NOPTS_VALUE);
+    // ҵ target ϸ currentPts ֮ǰţ֮󣨿Ĺؼ֡İ
+    AVPacket* readKeyframe(int64_t targetPts, int64_t currentPts, bool forward);
+
+    RecordIndex m_index;
+    int64_t m_startPts = 0;
+    std::atomic<qint64> m_seekMs{ -1 };
+    std::atomic<bool> m_paused{ false };
+    std::atomic<double> m_speed{ 1.0 };
+    std::atomic<qint64> m_durationMs{ 0 };
+    std::atomic<qint64> m_positionMs{ 0 };
+    std::atomic<bool> m_hasIndex{ false };
+
+    // ߳GUI̴߳ɾطֻ߳ڳڼ
+    QMutex m_decoderMutex;
+    DecodeThread* m_decoder = nullptr;
+};
+
+#endif // PLAYBACKTHREAD_H
@@ -0,0 +1,334 @@
+#include "proxyrecordthread.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QWaitCondition>
+#include <cstring>
+
+extern "C" {
+#include "libavutil/opt.h"
+}
+
+#define PROXY_EDGE_FRAMES 2     // ֻ֡ʱ֡
+#define PROXY_TS_JUMP_MS 5000   // ֡ʱֵΪ
+
+static QMutex s_poolMutex;
+static QWaitCondition s_poolFree;
+static int s_poolLimit = 0;
+static int s_poolBusy = 0;
+
+static int poolLimitLocked()
+{
+    return s_poolLimit > 0 ? s_poolLimit : qMax(1, QThread::idealThreadCount() / 4);
+}
+
+void ProxyWorkerPool::setLimit(int workers)
+{
+    QMutexLocker locker(&s_poolMutex);
+    s_poolLimit = workers;
+    s_poolFree.wakeAll();
+}
+
+int ProxyWorkerPool::limit()
+{
+    QMutexLocker locker(&s_poolMutex);
+    return poolLimitLocked();
+}
+
+bool ProxyWorkerPool::acquire(int timeoutMs)
+{
+    QMutexLocker locker(&s_poolMutex);
+    QElapsedTimer timer;
+    timer.start();
+    while (s_poolBusy >= poolLimitLocked()) {
+        const qint64 remaining = timeoutMs - timer.elapsed();
+        if (remaining <= 0) {
+            return false;
+        }
+        s_poolFree.wait(&s_poolMutex, (unsigned long)remaining);
+    }
+    ++s_poolBusy;
+    return true;
+}
+
+void ProxyWorkerPool::release()
+{
+    QMutexLocker locker(&s_poolMutex);
+    --s_poolBusy;
+    s_poolFree.wakeOne();
+}
+
+ProxyRecordThread::ProxyRecordThread(const ProxyOptions& options, QObject* parent)
+    : FrameSink(StageProxy, PROXY_EDGE_FRAMES, EdgeDropOldest, parent), m_options(options)
+{
+    m_options.fps = qBound(1.0, m_options.fps, 60.0);
+    m_options.bitrateKbps = qMax(50, m_options.bitrateKbps);
+    // ֮֡ûҪӹؼ֡ʼ
+    m_input.setStartAtKeyframe(false);
+}
+
+ProxyRecordThread::~ProxyRecordThread()
+{
+    stop();
+    wait();
+    closeFile();
+}
+
+QString ProxyRecordThread::proxyPath(const QString& recordPath)
+{
+    QFileInfo info(recordPath);
+    return info.path() + "/" + info.completeBaseName() + "_proxy.mp4";
+}
+
+void ProxyRecordThread::startRecord(const QString& filePath)
+{
+    {
+        QMutexLocker locker(&m_pathMutex);
+        m_nextPath = filePath;
+    }
+    m_fileChanged = true;
+    m_isRecording = true;
+}
+
+void ProxyRecordThread::stopRecord()
+{
+    m_isRecording = false;
+}
+
+void ProxyRecordThread::splitRecord(const QString& newFilePath)
+{
+    if (!m_isRecording) {
+        return;
+    }
+    startRecord(newFilePath);
+}
+
+ProxyStats ProxyRecordThread::stats() const
+{
+    ProxyStats stats;
+    stats.framesEncoded = m_framesEncoded;
+    stats.framesSkipped = m_framesSkipped;
+    stats.framesDropped = m_input.dropped() + m_framesBusy;
+    stats.bytesWritten = m_bytesWritten;
+    stats.avgEncodeMs = stats.framesEncoded > 0 ? m_encodeUs / 1000.0 / stats.framesEncoded : 0.0;
+    return stats;
+}
+
+bool ProxyRecordThread::openFile(int width, int height)
+{
+    {
+        QMutexLocker locker(&m_pathMutex);
+        m_filePath = m_nextPath;
+    }
+    const QByteArray path = m_filePath.toUtf8();
+
+    const AVCodec* codec = avcodec_find_encoder_by_name(m_options.encoder.toUtf8().constData());
+    if (!codec) {
+        codec = avcodec_find_encoder_by_name("libopenh264");
+    }
+    if (!codec) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    }
+    if (!codec) {
+        qWarning() << "Proxy: no software encoder available";
+        return false;
+    }
+
+    if (avformat_alloc_output_context2(&m_outputFmtCtx, nullptr, nullptr, path.constData()) < 0) {
+        qWarning() << "Proxy: could not create output context for" << m_filePath;
+        return false;
+    }
+
+    m_encoder = avcodec_alloc_context3(codec);
+    if (!m_encoder) {
+        closeFile();
+        return false;
+    }
+    m_encoder->width = width;
+    m_encoder->height = height;
+    m_encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    m_encoder->time_base = AVRational{ 1, 1000 };
+    m_encoder->framerate = AVRational{ qRound(m_options.fps), 1 };
+    m_encoder->bit_rate = (int64_t)m_options.bitrateKbps * 1000;
+    m_encoder->gop_size = qMax(1, qRound(m_options.fps * 2.0));
+    m_encoder->max_b_frames = 0;
+    // ÿ·ֻһ̣߳жɱ빤λ
+    m_encoder->thread_count = 1;
+    if (m_outputFmtCtx->oformat->flags & AVFMT_GLOBALHEADER) {
+        m_encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    if (strcmp(codec->name, "libx264") == 0) {
+        av_opt_set(m_encoder->priv_data, "preset", "veryfast", 0);
+        av_opt_set(m_encoder->priv_data, "tune", "zerolatency", 0);
+    }
+    if (avcodec_open2(m_encoder, codec, nullptr) < 0) {
+        qWarning() << "Proxy: could not open encoder" << codec->name;
+        closeFile();
+        return false;
+    }
+
+    AVStream* outStream = avformat_new_stream(m_outputFmtCtx, nullptr);
+    if (!outStream || avcodec_parameters_from_context(outStream->codecpar, m_encoder) < 0) {
+        closeFile();
+        return false;
+    }
+    outStream->time_base = m_encoder->time_base;
+
+    if (!(m_outputFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&m_outputFmtCtx->pb, path.constData(), AVIO_FLAG_WRITE) < 0) {
+            qWarning() << "Proxy: could not open output file" << m_filePath;
+            closeFile();
+            return false;
+        }
+    }
+    if (avformat_write_header(m_outputFmtCtx, nullptr) < 0) {
+        qWarning() << "Proxy: error writing header";
+        closeFile();
+        return false;
+    }
+    m_headerWritten = true;
+
+    m_packet = av_packet_alloc();
+    m_fileClock.start();
+    m_nextDueMs = 0;
+    m_firstTs = AV_NOPTS_VALUE;
+    m_tsBaseMs = 0;
+    m_lastOutPts = AV_NOPTS_VALUE;
+    qDebug() << "Proxy recording started to" << m_filePath << width << "x" << height << codec->name;
+    return true;
+}
+
+void ProxyRecordThread::closeFile()
+{
+    if (!m_outputFmtCtx) {
+        return;
+    }
+
+    if (m_headerWritten) {
+        encode(nullptr);    // ȡʣµİ
+        av_write_trailer(m_outputFmtCtx);
+    }
+    if (m_outputFmtCtx->pb && !(m_outputFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&m_outputFmtCtx->pb);
+    }
+    avformat_free_context(m_outputFmtCtx);
+    m_outputFmtCtx = nullptr;
+    avcodec_free_context(&m_encoder);
+    av_packet_free(&m_packet);
+
+    if (m_headerWritten) {
+        m_headerWritten = false;
+        qDebug() << "Proxy recording saved to" << m_filePath;
+        emit sigProxyFinished(m_filePath);
+    }
+}
+
+bool ProxyRecordThread::encode(AVFrame* frame)
+{
+    if (avcodec_send_frame(m_encoder, frame) < 0) {
+        return false;
+    }
+    AVStream* outStream = m_outputFmtCtx->streams[0];
+    while (avcodec_receive_packet(m_encoder, m_packet) >= 0) {
+        av_packet_rescale_ts(m_packet, m_encoder->time_base, outStream->time_base);
+        m_packet->stream_index = 0;
+        const int size = m_packet->size;
+        if (av_interleaved_write_frame(m_outputFmtCtx, m_packet) < 0) {
+            qWarning() << "Proxy: error muxing packet";
+        }
+        else {
+            m_bytesWritten.fetch_add(size, std::memory_order_relaxed);
+        }
+        av_packet_unref(m_packet);
+    }
+    return true;
+}
+
+int64_t ProxyRecordThread::frameTimeMs(const AVFrame* frame)
+{
+    const int64_t ts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (ts == AV_NOPTS_VALUE || frame->time_base.num <= 0 || frame->time_base.den <= 0) {
+        return m_fileClock.elapsed();
+    }
+
+    int64_t ms = AV_NOPTS_VALUE;
+    if (m_firstTs != AV_NOPTS_VALUE) {
+        ms = m_tsBaseMs + av_rescale_q(ts - m_firstTs, frame->time_base, AVRational{ 1, 1000 });
+    }
+    if (ms == AV_NOPTS_VALUE || (m_lastOutPts != AV_NOPTS_VALUE
+        && (ms < m_lastOutPts - PROXY_TS_JUMP_MS || ms > m_lastOutPts + PROXY_TS_JUMP_MS))) {
+        m_firstTs = ts;
+        m_tsBaseMs = m_lastOutPts != AV_NOPTS_VALUE ? m_lastOutPts + 1 : 0;
+        ms = m_tsBaseMs;
+    }
+    return ms;
+}
+
+bool ProxyRecordThread::process(AVFrame* frame)
+{
+    if (!m_isRecording) {
+        closeFile();
+        return true;
+    }
+    if (m_fileChanged.exchange(false)) {
+        closeFile();
+    }
+
+    // ֡ʣýʱ䣩ȡ̫֡ʱ׷
+    const qint64 intervalMs = qMax<qint64>(1, qRound64(1000.0 / m_options.fps));
+    if (m_outputFmtCtx) {
+        const qint64 now = frameTimeMs(frame);
+        if (now < m_nextDueMs) {
+            m_framesSkipped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        m_nextDueMs = (m_nextDueMs + intervalMs < now) ? now + intervalMs : m_nextDueMs + intervalMs;
+    }
+
+    // б빤λæ˵CPUһ֡
+    if (!ProxyWorkerPool::acquire((int)(intervalMs / 2))) {
+        m_framesBusy.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int width = frame->width & ~1;
+    int height = frame->height & ~1;
+    FrameScaler::fitSize(frame->width, frame->height, m_options.maxWidth, m_options.maxHeight, &width, &height);
+    AVFrame* scaled = m_scaler.scale(frame, width, height, AV_PIX_FMT_YUV420P);
+    if (scaled) {
+        if (m_outputFmtCtx || openFile(scaled->width, scaled->height)) {
+            int64_t pts = frameTimeMs(frame);
+            if (m_lastOutPts != AV_NOPTS_VALUE && pts <= m_lastOutPts) {
+                pts = m_lastOutPts + 1;
+            }
+            m_lastOutPts = pts;
+            scaled->pts = pts;
+            scaled->pict_type = AV_PICTURE_TYPE_NONE;
+            if (encode(scaled)) {
+                m_framesEncoded.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        else {
+            m_isRecording = false;  // 򲻿Ͳԣԭʼ¼Ӱ
+        }
+        av_frame_free(&scaled);
+    }
+    ProxyWorkerPool::release();
+    m_encodeUs.fetch_add(timer.nsecsElapsed() / 1000, std::memory_order_relaxed);
+    return true;
+}
+
+void ProxyRecordThread::idle()
+{
+    // ֹͣ¼Ѿͷţ֡
+    if (!m_isRecording) {
+        closeFile();
+    }
+}
+
+void ProxyRecordThread::run()
+{
+    FrameSink::run();
+    closeFile();
+}
@@ -0,0 +1,108 @@
+#ifndef PROXYRECORDTHREAD_H
+#define PROXYRECORDTHREAD_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+#include "stagegraph.h"
+#include "framescaler.h"
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+// ¼ԭʼ¼ͬʱ¼һݵͷֱʡ֡ʵСļԶԤ
+struct ProxyOptions
+{
+    int maxWidth = 640;         // С
+    int maxHeight = 360;
+    double fps = 10.0;          // ֡ʣĽֱ֡
+    int bitrateKbps = 400;
+    QString encoder = "libx264";    // Ҳʱγ libopenh264mpeg4
+};
+
+struct ProxyStats
+{
+    quint64 framesEncoded = 0;
+    quint64 framesSkipped = 0;  // ֡
+    quint64 framesDropped = 0;  // CPU ߱֡ + Ȳ빤λ֡
+    quint64 bytesWritten = 0;
+    double avgEncodeMs = 0.0;   // ÿ֡ + ʱ
+};
+
+// 빤λд¼ãͬʱ··ռô
+// ÿֻһ̣߳λǴ¼CPUԤ
+class ProxyWorkerPool
+{
+public:
+    static void setLimit(int workers);      // <=0 Ϊ CPU ķ֮һ1
+    static int limit();
+    static bool acquire(int timeoutMs);
+    static void release();
+};
+
+//  DecodeThread ֡ϵߣţlibswscaleSIMD롢д MP4
+// ֻ 2 ֡֡ʱ֡ѹԭʼ¼ RecordThread İ·Ӱ
+class ProxyRecordThread : public FrameSink
+{
+    Q_OBJECT
+public:
+    explicit ProxyRecordThread(const ProxyOptions& options, QObject* parent = nullptr);
+    ~ProxyRecordThread();
+
+    // ¼ļԵĴļ<Ŀ¼>/<ļ>_proxy.mp4
+    static QString proxyPath(const QString& recordPath);
+
+    void startRecord(const QString& filePath);
+    void stopRecord();
+    // һ֡ļ¿ʼļӹؼ֡ʼ
+    void splitRecord(const QString& newFilePath);
+    bool isRecording() const { return m_isRecording; }
+
+    ProxyStats stats() const;
+
+signals:
+    void sigProxyFinished(QString path);
+
+protected:
+    void run() override;
+    bool process(AVFrame* frame) override;
+    void idle() override;
+
+private:
+    bool openFile(int width, int height);
+    void closeFile();
+    bool encode(AVFrame* frame);
+    int64_t frameTimeMs(const AVFrame* frame);
+
+    ProxyOptions m_options;
+    std::atomic<bool> m_isRecording{ false };
+    std::atomic<bool> m_fileChanged{ false };
+    QMutex m_pathMutex;
+    QString m_nextPath;
+    QString m_filePath;
+
+    FrameScaler m_scaler;
+    AVFormatContext* m_outputFmtCtx = nullptr;
+    AVCodecContext* m_encoder = nullptr;
+    AVPacket* m_packet = nullptr;
+    bool m_headerWritten = false;
+    // ļʱ룩֡ʱ㣬ļһ֡ԭʼ¼ʱһ£
+    // ʱ䣨תʱһ֡¶룬ûʱ֡˻صʱ
+    QElapsedTimer m_fileClock;
+    int64_t m_firstTs = AV_NOPTS_VALUE;
+    int64_t m_tsBaseMs = 0;
+    int64_t m_lastOutPts = AV_NOPTS_VALUE;
+    qint64 m_nextDueMs = 0;
+
+    std::atomic<quint64> m_framesEncoded{ 0 };
+    std::atomic<quint64> m_framesSkipped{ 0 };
+    std::atomic<quint64> m_framesBusy{ 0 };
+    std::atomic<quint64> m_bytesWritten{ 0 };
+    std::atomic<quint64> m_encodeUs{ 0 };
+};
+
+#endif // PROXYRECORDTHREAD_H
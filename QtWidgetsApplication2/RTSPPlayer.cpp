@@ -1,23 +1,67 @@
 #include "rtspplayer.h"
+#include "screenshotthread.h"
+#ifndef NVR_HEADLESS
 #include "videowidget.h"
+#include "mosaicwidget.h"
+#endif
+#include <QDateTime>
+#include "timeshiftbuffer.h"
+#include "timeshiftthread.h"
+#include "playbackthread.h"
+#include "standbypool.h"
+#include "replaythread.h"
+
+#define DISPLAY_IDLE_DELAY_MS 500
 
 RTSPPlayer::RTSPPlayer(QObject* parent) : QObject(parent)
 {
     avformat_network_init();
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(DISPLAY_IDLE_DELAY_MS);
+    connect(&m_idleTimer, &QTimer::timeout, this, &RTSPPlayer::onDisplayIdleTimeout);
 }
 
 RTSPPlayer::~RTSPPlayer()
 {
     stopPlay();
+#ifndef NVR_HEADLESS
+    detachMosaicTile();
+#endif
     avformat_network_deinit();
 }
 
+#ifndef NVR_HEADLESS
 void RTSPPlayer::setVideoWidget(VideoWidget* widget)
 {
     m_videoWidget = widget;
     m_videoWidget->setMyQueue(&m_showPacketQueue);
     m_videoWidget->setMyMutex(&m_showMutex);
+    connect(m_videoWidget, &VideoWidget::sigDisplaySizeChanged, this, &RTSPPlayer::onDisplaySizeChanged);
+    connect(m_videoWidget, &VideoWidget::sigVisibilityChanged, this, &RTSPPlayer::onDisplayVisibilityChanged);
+    m_displayHidden = !m_videoWidget->isDisplayVisible();
+}
+
+void RTSPPlayer::setMosaicTile(MosaicWidget* widget, int index)
+{
+    detachMosaicTile();
+    m_mosaicWidget = widget;
+    m_mosaicIndex = index;
+    widget->setTileSource(index, &m_showPacketQueue, &m_showMutex);
+    connect(widget, &MosaicWidget::sigTileSizeChanged, this, &RTSPPlayer::onDisplaySizeChanged);
+    setDisplayDownscale(true);
+}
+
+void RTSPPlayer::detachMosaicTile()
+{
+    if (m_mosaicWidget) {
+        disconnect(m_mosaicWidget, nullptr, this, nullptr);
+        m_mosaicWidget->setTileSource(m_mosaicIndex, nullptr, nullptr);
+    }
+    m_mosaicWidget = nullptr;
+    m_mosaicIndex = -1;
 }
+#endif
 
 void RTSPPlayer::startPlay(const QString& url)
 {
@@ -27,31 +71,346 @@ void RTSPPlayer::startPlay(const QString& url)
 
     stopPlay(); //ȷɵ
 
+    m_switchTimer.start();
+    m_switchLatencyMs = -1;
     m_rtspUrl = url;
 
-    m_demuxThread = new DemuxThread(&m_decodePacketQueue, &m_decodeMutex, &m_recordPacketQueue, &m_recordMutex, this);
-    m_decodeThread = new DecodeThread(&m_decodePacketQueue, &m_decodeMutex,&m_showPacketQueue, &m_showMutex, this);
+    m_metrics = PipelineMetrics::acquire(url);
+    DemuxThread* standby = m_standbyPool ? m_standbyPool->take(url) : nullptr;
+    m_switchWarm = standby != nullptr;
+    if (standby) {
+        standby->setParent(this);
+        m_demuxThread = standby;
+    }
+    else {
+        m_demuxThread = new DemuxThread(&m_decodePacketQueue, &m_decodeMutex, &m_recordPacketQueue, &m_recordMutex, this);
+    }
     m_recordThread = new RecordThread(&m_recordPacketQueue, &m_recordMutex, this);
-    connect(m_decodeThread, &DecodeThread::sigGetFirstFrame, this, &RTSPPlayer::sigGetFirstFrame, Qt::QueuedConnection);
-	connect(m_demuxThread, &DemuxThread::sigStreamFailed, this, &RTSPPlayer::sigStreamFailed, Qt::QueuedConnection);
+    m_demuxThread->setMetrics(m_metrics);
+    m_recordThread->setMetrics(m_metrics);
+#ifndef NVR_HEADLESS
+    if (m_videoWidget) {
+        m_videoWidget->setMetrics(m_metrics);
+    }
+#endif
+    connectDemux();
     connect(m_recordThread, &RecordThread::sigRealRecordStart, this, &RTSPPlayer::sigRealRecordStart, Qt::QueuedConnection);
     connect(m_recordThread, &RecordThread::sigRecordFinished, this, &RTSPPlayer::sigRecordFinished, Qt::QueuedConnection);
-    connect(this, &RTSPPlayer::screenshotRequested, m_decodeThread, &DecodeThread::onScreenshotRequested, Qt::QueuedConnection);
+    m_recordThread->setPreRollSeconds(m_preRollSeconds);
+    m_recordThread->start();
+
+    m_subFailed = false;
+    m_displayOwner = 0;
+    if (standby) {
+        // ԤѾ򿪲GOP϶к󻺴İֱӽУ
+        // ֻʾһӦĻ棬ǰֻ֡벻
+        const int64_t lastPts = m_demuxThread->attachOutputs(&m_decodePacketQueue, &m_decodeMutex,
+            &m_recordPacketQueue, &m_recordMutex);
+        updateDecoder();
+        if (m_decodeThread && lastPts != AV_NOPTS_VALUE) {
+            m_decodeThread->requestFlush(lastPts);
+        }
+        qDebug() << "Adopted standby connection for" << url;
+        emit sigStreamOpened();
+        openTimeshiftBuffer();
+        openRestream();
+    }
+    else {
+        m_demuxThread->setDecodeEnabled(false);
+        updateDecoder();
+        m_demuxThread->start(m_rtspUrl);
+    }
+    updateStreamSelection();
+}
+
+void RTSPPlayer::connectDemux()
+{
+    connect(m_demuxThread, &DemuxThread::sigStreamFailed, this, &RTSPPlayer::sigStreamFailed, Qt::QueuedConnection);
+    connect(m_demuxThread, &DemuxThread::sigStreamOpened, this, &RTSPPlayer::sigStreamOpened, Qt::QueuedConnection);
+    connect(m_demuxThread, &DemuxThread::sigStreamOpened, this, &RTSPPlayer::openTimeshiftBuffer, Qt::QueuedConnection);
+    connect(m_demuxThread, &DemuxThread::sigStreamOpened, this, &RTSPPlayer::openRestream, Qt::QueuedConnection);
+    connect(m_demuxThread, &DemuxThread::sigStreamAlert, this, &RTSPPlayer::sigStreamAlert, Qt::QueuedConnection);
+    m_demuxThread->setStreamThresholds(m_streamThresholds);
+}
+
+void RTSPPlayer::onFirstFrameShown()
+{
+    // һ֮֡ǰʡģʽͨյһ֡ʾؼ
+    if (!m_firstFrameShown) {
+        m_firstFrameShown = true;
+        if (m_displayHidden) {
+            m_idleTimer.start();
+        }
+    }
+
+    if (!m_switchTimer.isValid() || m_switchLatencyMs >= 0) {
+        return;
+    }
+    m_switchLatencyMs = m_switchTimer.elapsed();
+    qDebug() << "Switch to" << m_rtspUrl << "took" << m_switchLatencyMs << "ms"
+        << (m_switchWarm ? "(standby)" : "(cold)");
+    emit sigSwitchLatency(m_switchLatencyMs, m_switchWarm);
+}
+
+void RTSPPlayer::onDisplayVisibilityChanged(bool visible)
+{
+    m_displayHidden = !visible;
+    if (visible) {
+        m_idleTimer.stop();
+        setDisplayIdle(false);
+    }
+    else if (m_firstFrameShown) {
+        m_idleTimer.start();
+    }
+}
+
+void RTSPPlayer::onDisplayIdleTimeout()
+{
+    if (m_displayHidden && m_demuxThread) {
+        setDisplayIdle(true);
+    }
+}
+
+void RTSPPlayer::setDisplayIdle(bool idle)
+{
+    if (m_displayIdle == idle) {
+        return;
+    }
+    m_displayIdle = idle;
+    qDebug() << "Display" << (idle ? "hidden, entering idle mode" : "visible, resuming at next keyframe");
+
+    if (m_subDecodeThread) {
+        m_subDecodeThread->setIdle(idle);
+        m_subDecodeThread->setShowEnabled(!idle);
+    }
+    updateDecoder();
+
+    if (idle) {
+        // ʣµָ֡ʱѾʱֱӶ
+        QMutexLocker locker(&m_showMutex);
+        while (!m_showPacketQueue.isEmpty()) {
+            AVFrame* frame = m_showPacketQueue.dequeue();
+            av_frame_free(&frame);
+        }
+    }
+}
+
+bool RTSPPlayer::displayWanted() const
+{
+    return !m_recordOnly || m_liveView || m_timeshiftThread || m_playbackThread;
+}
+
+bool RTSPPlayer::mainDisplayWanted() const
+{
+    // еʱʾֱĵһ֡ӹ
+    return displayWanted() && (!m_useSub || m_displayOwner == 0);
+}
+
+void RTSPPlayer::setSubStream(const QString& url, int maxWidth)
+{
+    m_subUrl = url;
+    m_subMaxWidth = maxWidth;
+    m_subFailed = false;
+    updateStreamSelection();
+}
+
+void RTSPPlayer::updateStreamSelection()
+{
+    // ȫʱʾߴΪ 0x0ҪԭʼֱʣлһЩ϶ʱл
+    const int limit = m_useSub ? m_subMaxWidth * 5 / 4 : m_subMaxWidth;
+    const bool wantSub = !m_subUrl.isEmpty() && !m_subFailed && m_demuxThread && !m_playbackThread && !m_replayThread
+        && !m_timeshiftThread && displayWanted() && m_displayW > 0 && m_displayW <= limit;
+    if (wantSub == m_useSub) {
+        if (!displayWanted() && m_subDemuxThread) {
+            stopSubStream();
+        }
+        return;
+    }
+
+    m_useSub = wantSub;
+    if (wantSub) {
+        qDebug() << "Display" << m_displayW << "x" << m_displayH << ", switching to sub stream" << m_subUrl;
+        startSubStream();
+        return;
+    }
+
+    qDebug() << "Display" << m_displayW << "x" << m_displayH << ", switching back to main stream";
+    if (m_displayOwner == 1 && displayWanted()) {
+        // ӹʾonDisplayClaimedͣ
+        updateDecoder();
+    }
+    else {
+        stopSubStream();
+        updateDecoder();
+    }
+}
+
+void RTSPPlayer::startSubStream()
+{
+    if (m_subDemuxThread) {
+        return;
+    }
+
+    m_subDemuxThread = new DemuxThread(&m_subDecodePacketQueue, &m_subDecodeMutex, nullptr, nullptr, this);
+    m_subDecodeThread = new DecodeThread(&m_subDecodePacketQueue, &m_subDecodeMutex, &m_showPacketQueue, &m_showMutex, this);
+    m_subDecodeThread->setSource(m_subDemuxThread);
+    m_subDecodeThread->setDisplayOwner(&m_displayOwner, 1);
+    m_subDecodeThread->claimDisplay();
+    m_subDecodeThread->setDownscaleEnabled(m_displayDownscale);
+    m_subDecodeThread->setDisplaySize(m_displayW, m_displayH);
+    m_subDecodeThread->setThreadAutoTune(m_decoderAutoTune);
+    m_subDecodeThread->setIdle(m_displayIdle);
+    m_subDecodeThread->setShowEnabled(!m_displayIdle);
+    connect(m_subDecodeThread, &DecodeThread::sigDisplayClaimed, this, &RTSPPlayer::onDisplayClaimed, Qt::QueuedConnection);
+    connect(m_subDemuxThread, &DemuxThread::sigStreamFailed, this, &RTSPPlayer::onSubStreamFailed, Qt::QueuedConnection);
+
+    // ӵһؼ֡ʼ
+    m_subDemuxThread->waitDecodeKeyframe();
+    m_subDecodeThread->start();
+    m_subDemuxThread->start(m_subUrl);
+}
+
+void RTSPPlayer::stopSubStream()
+{
+    if (m_subDemuxThread) {
+        m_subDemuxThread->stop();
+    }
+    if (m_subDecodeThread) {
+        m_subDecodeThread->stop();
+        m_subDecodeThread->wait();
+        delete m_subDecodeThread;
+        m_subDecodeThread = nullptr;
+    }
+    if (m_subDemuxThread) {
+        m_subDemuxThread->wait();
+        delete m_subDemuxThread;
+        m_subDemuxThread = nullptr;
+    }
+
+    QMutexLocker locker(&m_subDecodeMutex);
+    while (!m_subDecodePacketQueue.isEmpty()) {
+        AVPacket* temp = m_subDecodePacketQueue.dequeue();
+        av_packet_free(&temp);
+    }
+    m_displayOwner = 0;
+}
+
+void RTSPPlayer::onDisplayClaimed(int id)
+{
+    if (id == 1) {
+        // Ѿʾֻ¼ԼƶҪĽ룩
+        if (m_useSub) {
+            updateDecoder();
+        }
+        qDebug() << "Sub stream is now on screen";
+    }
+    else if (m_subDemuxThread && !m_useSub) {
+        stopSubStream();
+        qDebug() << "Main stream is now on screen";
+    }
+}
+
+void RTSPPlayer::onSubStreamFailed(QString error)
+{
+    qWarning() << "Sub stream failed:" << error << ", staying on main stream";
+    m_subFailed = true;
+    m_useSub = false;
+    if (m_displayOwner == 1) {
+        // Ѿʾӹ
+        updateDecoder();
+    }
+    else {
+        stopSubStream();
+        updateDecoder();
+    }
+}
+
+bool RTSPPlayer::needDecoder() const
+{
+    return mainDisplayWanted() || m_snapshotPending || m_motionRecordEnabled || !m_publishKey.isEmpty()
+        || (m_proxyThread && m_proxyThread->isRecording());
+}
+
+void RTSPPlayer::updateDecoder()
+{
+    if (!m_demuxThread) {
+        return;
+    }
+
+    if (needDecoder()) {
+        ensureDecoder();
+        const bool show = mainDisplayWanted() && !m_displayIdle;
+        m_decodeThread->setShowEnabled(show);
+        m_decodeThread->setIdle(m_displayIdle);
+        if (show && m_displayOwner != 0) {
+            m_decodeThread->claimDisplay();
+        }
+    }
+    else {
+        releaseDecoder();
+    }
+    updateProxyOutput();
+}
+
+void RTSPPlayer::updateProxyOutput()
+{
+    if (!m_proxyThread || !m_decodeThread) {
+        return;
+    }
+    if (m_proxyThread->isRecording()) {
+        m_decodeThread->frameOutput()->connect(m_proxyThread->input());
+    }
+    else {
+        m_decodeThread->frameOutput()->disconnect(m_proxyThread->input());
+    }
+}
+
+void RTSPPlayer::ensureDecoder()
+{
+    if (m_decodeThread) {
+        return;
+    }
+
+    m_decodeThread = new DecodeThread(&m_decodePacketQueue, &m_decodeMutex,&m_showPacketQueue, &m_showMutex, this);
+    connect(m_decodeThread, &DecodeThread::sigGetFirstFrame, this, &RTSPPlayer::sigGetFirstFrame, Qt::QueuedConnection);
+    connect(m_decodeThread, &DecodeThread::sigMotionChanged, this, &RTSPPlayer::onMotionChanged, Qt::QueuedConnection);
+
+    m_decodeThread->setDownscaleEnabled(m_displayDownscale);
+    m_decodeThread->setDisplaySize(m_displayW, m_displayH);
+    m_decodeThread->setThreadAutoTune(m_decoderAutoTune);
+    m_decodeThread->setKeyframeOnly(m_keyframeOnly);
+    m_decodeThread->setMotionOptions(m_motionOptions);
+    m_decodeThread->setMetrics(m_metrics);
+    m_decodeThread->setFramePublishing(m_publishKey, m_publishSlots);
+    m_decodeThread->setSource(m_demuxThread);
+    m_decodeThread->setDisplayOwner(&m_displayOwner, 0);
+    connect(m_decodeThread, &DecodeThread::sigDisplayClaimed, this, &RTSPPlayer::onDisplayClaimed, Qt::QueuedConnection);
+    connect(m_decodeThread, &DecodeThread::sigFirstFrameShown, this, &RTSPPlayer::onFirstFrameShown, Qt::QueuedConnection);
 
     m_decodeThread->start();
-    m_recordThread->start();
-    m_demuxThread->start(m_rtspUrl);
+    if (m_playbackThread) {
+        m_playbackThread->setDecoder(m_decodeThread);
+    }
+    m_demuxThread->setDecodeEnabled(m_timeshiftThread == nullptr); // ʱƻطʱ TimeshiftThread Ͱ
 }
 
-void RTSPPlayer::stopPlay()
+void RTSPPlayer::releaseDecoder()
 {
     if (m_demuxThread) {
-        m_demuxThread->stop();
-        m_demuxThread->wait();
-        delete m_demuxThread;
-        m_demuxThread = nullptr;
+        m_demuxThread->setDecodeEnabled(false);
+    }
+
+    // ûȵ֡Ľͼᱨʧ
+    for (ScreenshotThread* sink : m_screenshots) {
+        stopScreenshot(sink);
+    }
+    if (m_decodeThread && m_proxyThread) {
+        m_decodeThread->frameOutput()->disconnect(m_proxyThread->input());
     }
 
+    if (m_playbackThread) {
+        m_playbackThread->setDecoder(nullptr);
+    }
     if (m_decodeThread) {
         m_decodeThread->stop();
         m_decodeThread->wait();
@@ -59,6 +418,86 @@ void RTSPPlayer::stopPlay()
         m_decodeThread = nullptr;
     }
 
+    {
+        QMutexLocker locker(&m_decodeMutex);
+        while (!m_decodePacketQueue.isEmpty()) {
+            AVPacket* temp = m_decodePacketQueue.dequeue();
+            av_packet_free(&temp);
+        }
+    }
+    {
+        QMutexLocker locker(&m_showMutex);
+        while (!m_showPacketQueue.isEmpty()) {
+            AVFrame* temp = m_showPacketQueue.dequeue();
+            av_frame_free(&temp);
+        }
+    }
+}
+
+void RTSPPlayer::requestStop()
+{
+    if (m_demuxThread) {
+        m_demuxThread->stop();
+    }
+    if (m_decodeThread) {
+        m_decodeThread->stop();
+    }
+    if (m_recordThread) {
+        m_recordThread->stop();
+    }
+    if (m_subDemuxThread) {
+        m_subDemuxThread->stop();
+    }
+    if (m_subDecodeThread) {
+        m_subDecodeThread->stop();
+    }
+}
+
+void RTSPPlayer::stopPlay()
+{
+    m_idleTimer.stop();
+    m_displayIdle = false;
+    m_firstFrameShown = false;
+    m_keyframeOnly = false;
+    m_motionRecording = false;
+    m_snapshotPending = false;
+    if (m_proxyThread) {
+        m_proxyThread->stopRecord();
+    }
+
+    stopSubStream();
+    m_useSub = false;
+
+    if (m_timeshiftThread) {
+        m_timeshiftThread->stop();
+        m_timeshiftThread->wait();
+        delete m_timeshiftThread;
+        m_timeshiftThread = nullptr;
+    }
+
+    // תƵı߽ڽ⸴̵߳ϣԤӳػ֮ǰȶϿ
+    closeRestream();
+
+    if (m_demuxThread) {
+        if (m_standbyPool && !m_playbackThread && !m_replayThread && m_demuxThread->isOpened()) {
+            // ӻúõģԤӳأлһ·ʱ
+            m_demuxThread->setTimeshiftBuffer(nullptr);
+            m_demuxThread->setMetrics(nullptr);
+            m_standbyPool->giveBack(m_rtspUrl, m_demuxThread);
+        }
+        else {
+            m_demuxThread->stop();
+            m_demuxThread->wait();
+            delete m_demuxThread;
+        }
+        m_demuxThread = nullptr;
+        m_playbackThread = nullptr;
+        m_replayThread = nullptr;
+    }
+
+    releaseDecoder();
+    closeTimeshift();
+
     if (m_recordThread) {
         m_recordThread->stop();
         m_recordThread->wait();
@@ -76,12 +515,37 @@ void RTSPPlayer::stopPlay()
     };
     clearQueue(m_decodePacketQueue, m_decodeMutex);
     clearQueue(m_recordPacketQueue, m_recordMutex);
+
+    if (m_metrics) {
+#ifndef NVR_HEADLESS
+        if (m_videoWidget) {
+            m_videoWidget->setMetrics(nullptr);
+        }
+#endif
+        PipelineMetrics::release(m_metrics);
+        m_metrics = nullptr;
+    }
 }
 
 void RTSPPlayer::startRecord(const QString& filePath)
 {
     if (m_demuxThread && m_recordThread) {
         m_recordThread->startRecord(filePath, m_demuxThread->videoStream());
+        if (m_proxyThread) {
+            m_proxyThread->startRecord(ProxyRecordThread::proxyPath(filePath));
+            updateDecoder();
+        }
+    }
+}
+
+void RTSPPlayer::startTimelapseRecord(const QString& filePath, double keyframeIntervalSec, double playbackSpeed)
+{
+    if (m_demuxThread && m_recordThread) {
+        TimelapseOptions options;
+        options.enabled = true;
+        options.keyframeIntervalSec = keyframeIntervalSec;
+        options.playbackSpeed = playbackSpeed;
+        m_recordThread->startRecord(filePath, m_demuxThread->videoStream(), options);
     }
 }
 
@@ -90,13 +554,565 @@ void RTSPPlayer::stopRecord()
     if (m_recordThread) {
         m_recordThread->stopRecord();
     }
+    if (m_proxyThread && m_proxyThread->isRecording()) {
+        m_proxyThread->stopRecord();
+        updateDecoder();
+    }
+}
+
+void RTSPPlayer::splitRecord(const QString& newFilePath)
+{
+    if (m_recordThread) {
+        m_recordThread->splitRecord(newFilePath);
+    }
+    if (m_proxyThread) {
+        m_proxyThread->splitRecord(ProxyRecordThread::proxyPath(newFilePath));
+    }
+}
+
+void RTSPPlayer::setProxyRecording(bool enabled, const ProxyOptions& options)
+{
+    if (m_proxyThread) {
+        if (m_decodeThread) {
+            m_decodeThread->frameOutput()->disconnect(m_proxyThread->input());
+        }
+        delete m_proxyThread;
+        m_proxyThread = nullptr;
+    }
+
+    if (enabled) {
+        m_proxyThread = new ProxyRecordThread(options, this);
+        connect(m_proxyThread, &ProxyRecordThread::sigProxyFinished, this, &RTSPPlayer::sigProxyFinished, Qt::QueuedConnection);
+        // ¼ֻǸģȼڽԭʼ¼
+        // һ¼ʼЧ
+        m_proxyThread->start(QThread::LowPriority);
+    }
+    updateDecoder();
+}
+
+ProxyStats RTSPPlayer::proxyStats() const
+{
+    return m_proxyThread ? m_proxyThread->stats() : ProxyStats();
+}
+
+bool RTSPPlayer::isRecording() const
+{
+    return m_recordThread && m_recordThread->isRecording();
+}
+
+StreamAnalysis RTSPPlayer::streamAnalysis(double windowSec) const
+{
+    return m_demuxThread ? m_demuxThread->streamAnalysis(windowSec) : StreamAnalysis();
+}
+
+void RTSPPlayer::setStreamThresholds(const StreamThresholds& thresholds)
+{
+    m_streamThresholds = thresholds;
+    if (m_demuxThread) {
+        m_demuxThread->setStreamThresholds(thresholds);
+    }
+}
+
+quint64 RTSPPlayer::bytesReceived() const
+{
+    return m_demuxThread ? m_demuxThread->bytesRead() : 0;
+}
+
+quint64 RTSPPlayer::packetsReceived() const
+{
+    return m_demuxThread ? m_demuxThread->packetsRead() : 0;
+}
+
+quint64 RTSPPlayer::bytesRecorded() const
+{
+    return m_recordThread ? m_recordThread->bytesWritten() : 0;
 }
 
 void RTSPPlayer::screenshot(const QString& filePath)
 {
-    emit screenshotRequested(filePath);
+    // ֻ¼ģʽûнʱһͼͷ
+    if (!m_decodeThread && m_demuxThread) {
+        m_snapshotPending = true;
+        updateDecoder();
+    }
+    if (!m_decodeThread) {
+        return;
+    }
+
+    // ͼ߳̽ڽ֡ϣֻʱŶһ֡
+    ScreenshotThread* sink = new ScreenshotThread(filePath, this);
+    connect(sink, &ScreenshotThread::screenshotSaved, this, &RTSPPlayer::onScreenshotFinished, Qt::QueuedConnection);
+    m_screenshots.append(sink);
+    sink->start();
+    m_decodeThread->frameOutput()->connect(sink->input());
+    qDebug() << "Screenshot requested for" << filePath;
+}
+
+void RTSPPlayer::stopScreenshot(ScreenshotThread* sink)
+{
+    if (m_decodeThread) {
+        m_decodeThread->frameOutput()->disconnect(sink->input());
+    }
+    sink->stop();
+    sink->wait();
+}
+
+void RTSPPlayer::setRecordOnly(bool enabled)
+{
+    m_recordOnly = enabled;
+    updateDecoder();
+    updateStreamSelection();
+}
+
+void RTSPPlayer::setLiveView(bool enabled)
+{
+    m_liveView = enabled;
+    updateDecoder();
+    updateStreamSelection();
+}
+void RTSPPlayer::setDisplayDownscale(bool enabled)
+{
+    m_displayDownscale = enabled;
+    if (m_decodeThread) {
+        m_decodeThread->setDownscaleEnabled(enabled);
+    }
+    if (m_subDecodeThread) {
+        m_subDecodeThread->setDownscaleEnabled(enabled);
+    }
+}
+
+void RTSPPlayer::setDecoderAutoTune(bool enabled)
+{
+    m_decoderAutoTune = enabled;
+}
+
+DecoderStats RTSPPlayer::decoderStats() const
+{
+    if (m_decodeThread) {
+        return m_decodeThread->decoderStats();
+    }
+    return DecoderStats();
+}
+
+void RTSPPlayer::openRecording(const QString& filePath)
+{
+    stopPlay();
+
+    m_rtspUrl = filePath;
+
+    m_metrics = PipelineMetrics::acquire(filePath);
+    m_playbackThread = new PlaybackThread(&m_decodePacketQueue, &m_decodeMutex, this);
+    m_demuxThread = m_playbackThread;   // ̡߳ͳƺͽͼͨ봦
+    m_demuxThread->setMetrics(m_metrics);
+#ifndef NVR_HEADLESS
+    if (m_videoWidget) {
+        m_videoWidget->setMetrics(m_metrics);
+    }
+#endif
+    connect(m_playbackThread, &DemuxThread::sigStreamFailed, this, &RTSPPlayer::sigStreamFailed, Qt::QueuedConnection);
+    connect(m_playbackThread, &DemuxThread::sigStreamOpened, this, &RTSPPlayer::sigStreamOpened, Qt::QueuedConnection);
+    connect(m_playbackThread, &PlaybackThread::sigPlaybackFinished, this, &RTSPPlayer::sigPlaybackFinished, Qt::QueuedConnection);
+
+    updateDecoder();
+    m_playbackThread->start(filePath);
+}
+
+bool RTSPPlayer::startCapture(const QString& filePath)
+{
+    return m_demuxThread && !m_playbackThread && m_demuxThread->startCapture(filePath);
+}
+
+void RTSPPlayer::stopCapture()
+{
+    if (m_demuxThread) {
+        m_demuxThread->stopCapture();
+    }
+}
+
+bool RTSPPlayer::isCapturing() const
+{
+    return m_demuxThread && m_demuxThread->isCapturing();
+}
+
+void RTSPPlayer::openCapture(const QString& filePath, bool realtime, bool loop)
+{
+    stopPlay();
+
+    m_switchTimer.start();
+    m_switchLatencyMs = -1;
+    m_switchWarm = false;
+    m_rtspUrl = filePath;
+
+    m_metrics = PipelineMetrics::acquire(filePath);
+    m_replayThread = new ReplayThread(&m_decodePacketQueue, &m_decodeMutex, &m_recordPacketQueue, &m_recordMutex, this);
+    m_replayThread->setRealtime(realtime);
+    m_replayThread->setLoop(loop);
+    m_demuxThread = m_replayThread;     // ֱȫͬΣ롢ʾ¼
+    m_recordThread = new RecordThread(&m_recordPacketQueue, &m_recordMutex, this);
+    m_demuxThread->setMetrics(m_metrics);
+    m_recordThread->setMetrics(m_metrics);
+#ifndef NVR_HEADLESS
+    if (m_videoWidget) {
+        m_videoWidget->setMetrics(m_metrics);
+    }
+#endif
+    connectDemux();
+    connect(m_replayThread, &ReplayThread::sigReplayFinished, this, &RTSPPlayer::sigReplayFinished, Qt::QueuedConnection);
+    connect(m_recordThread, &RecordThread::sigRealRecordStart, this, &RTSPPlayer::sigRealRecordStart, Qt::QueuedConnection);
+    connect(m_recordThread, &RecordThread::sigRecordFinished, this, &RTSPPlayer::sigRecordFinished, Qt::QueuedConnection);
+    m_recordThread->setPreRollSeconds(m_preRollSeconds);
+    m_recordThread->start();
+
+    m_subFailed = false;
+    m_displayOwner = 0;
+    m_demuxThread->setDecodeEnabled(false);
+    updateDecoder();
+    m_replayThread->start(filePath);
+}
+
+void RTSPPlayer::playbackSeek(double seconds)
+{
+    if (!m_playbackThread) {
+        return;
+    }
+    // ûʾľɻֱӶ flush ɻط߳ת
+    {
+        QMutexLocker locker(&m_showMutex);
+        while (!m_showPacketQueue.isEmpty()) {
+            AVFrame* temp = m_showPacketQueue.dequeue();
+            av_frame_free(&temp);
+        }
+    }
+    m_playbackThread->seek(seconds);
+}
+
+void RTSPPlayer::playbackPause(bool paused)
+{
+    if (m_playbackThread) {
+        m_playbackThread->setPaused(paused);
+    }
+}
+
+void RTSPPlayer::setPlaybackSpeed(double speed)
+{
+    if (!m_playbackThread) {
+        return;
+    }
+    m_playbackThread->setSpeed(speed);
+    m_keyframeOnly = PlaybackThread::isTrickSpeed(m_playbackThread->speed());
+    if (m_decodeThread) {
+        m_decodeThread->setKeyframeOnly(m_keyframeOnly);
+    }
+}
+
+double RTSPPlayer::playbackSpeed() const
+{
+    return m_playbackThread ? m_playbackThread->speed() : 1.0;
+}
+
+double RTSPPlayer::playbackDuration() const
+{
+    return m_playbackThread ? m_playbackThread->durationSeconds() : 0.0;
+}
+
+double RTSPPlayer::playbackPosition() const
+{
+    return m_playbackThread ? m_playbackThread->positionSeconds() : 0.0;
+}
+
+void RTSPPlayer::setTimeshift(bool enabled, const QString& filePath, qint64 capacityBytes)
+{
+    m_timeshiftEnabled = enabled;
+    m_timeshiftPath = filePath;
+    m_timeshiftBytes = capacityBytes;
+
+    if (!enabled) {
+        timeshiftGoLive();
+        closeTimeshift();
+    }
+    else if (m_demuxThread && m_demuxThread->videoStream()) {
+        openTimeshiftBuffer();
+    }
 }
+
+void RTSPPlayer::openTimeshiftBuffer()
+{
+    if (!m_timeshiftEnabled || m_timeshiftBuffer || !m_demuxThread || !m_demuxThread->videoStream()) {
+        return;
+    }
+
+    TimeshiftBuffer* buffer = new TimeshiftBuffer();
+    if (!buffer->open(m_timeshiftPath, m_timeshiftBytes, m_demuxThread->videoStream()->time_base)) {
+        delete buffer;
+        return;
+    }
+    m_timeshiftBuffer = buffer;
+    m_demuxThread->setTimeshiftBuffer(buffer);
+}
+
+void RTSPPlayer::closeTimeshift()
+{
+    if (m_timeshiftThread) {
+        timeshiftGoLive();
+    }
+    if (m_demuxThread) {
+        m_demuxThread->setTimeshiftBuffer(nullptr);
+    }
+    if (m_timeshiftBuffer) {
+        // setTimeshiftBuffer(nullptr) ʱ⸴߳Ѿ append У֮Ҳٷ
+        m_timeshiftBuffer->close();
+        delete m_timeshiftBuffer;
+        m_timeshiftBuffer = nullptr;
+    }
+}
+
+void RTSPPlayer::setRestream(bool enabled, const QString& directory, const RestreamOptions& options)
+{
+    closeRestream();
+    m_restreamEnabled = enabled;
+    m_restreamDir = directory;
+    m_restreamOptions = options;
+    if (enabled) {
+        openRestream();
+    }
+}
+
+RestreamStats RTSPPlayer::restreamStats() const
+{
+    return m_restreamThread ? m_restreamThread->stats() : RestreamStats();
+}
+
+void RTSPPlayer::openRestream()
+{
+    if (!m_restreamEnabled || m_restreamThread || !m_demuxThread || !m_demuxThread->videoStream()) {
+        return;
+    }
+
+    RestreamThread* sink = new RestreamThread(m_restreamDir, m_restreamOptions, this);
+    if (!sink->setStream(m_demuxThread->videoStream())) {
+        delete sink;
+        return;
+    }
+    connect(sink, &RestreamThread::sigRestreamFailed, this, &RTSPPlayer::sigRestreamFailed, Qt::QueuedConnection);
+    m_restreamThread = sink;
+    sink->start();
+    // ͽ롢¼ƹͬһֻһ
+    m_demuxThread->packetOutput()->connect(sink->input());
+}
+
+void RTSPPlayer::closeRestream()
+{
+    if (!m_restreamThread) {
+        return;
+    }
+    if (m_demuxThread) {
+        m_demuxThread->packetOutput()->disconnect(m_restreamThread->input());
+    }
+    m_restreamThread->stop();
+    m_restreamThread->wait();
+    delete m_restreamThread;
+    m_restreamThread = nullptr;
+}
+
+void RTSPPlayer::flushDecodePath()
+{
+    if (m_decodeThread) {
+        m_decodeThread->requestFlush();
+    }
+    {
+        QMutexLocker locker(&m_decodeMutex);
+        while (!m_decodePacketQueue.isEmpty()) {
+            AVPacket* temp = m_decodePacketQueue.dequeue();
+            av_packet_free(&temp);
+        }
+    }
+    {
+        QMutexLocker locker(&m_showMutex);
+        while (!m_showPacketQueue.isEmpty()) {
+            AVFrame* temp = m_showPacketQueue.dequeue();
+            av_frame_free(&temp);
+        }
+    }
+}
+
+bool RTSPPlayer::enterTimeshift(qint64 position, bool paused)
+{
+    if (!m_timeshiftBuffer || position < 0) {
+        return false;
+    }
+
+    if (m_timeshiftThread) {
+        m_timeshiftThread->stop();
+        m_timeshiftThread->wait();
+        delete m_timeshiftThread;
+        m_timeshiftThread = nullptr;
+    }
+
+    m_timeshiftThread = new TimeshiftThread(m_timeshiftBuffer, &m_decodePacketQueue, &m_decodeMutex, this);
+    m_timeshiftThread->setStartPosition(position);
+    m_timeshiftThread->setPaused(paused);
+
+    // ֱֹͣͰѾŶӵֱݣٴӻеĹؼ֡ʼ
+    if (m_demuxThread) {
+        m_demuxThread->setDecodeEnabled(false);
+    }
+    updateStreamSelection();  // ʱƻطŵ
+    updateDecoder();
+    flushDecodePath();
+    m_timeshiftThread->start();
+    return true;
+}
+
+bool RTSPPlayer::timeshiftSeek(double secondsBehindLive)
+{
+    if (!m_timeshiftBuffer) {
+        return false;
+    }
+    const qint64 livePts = m_timeshiftBuffer->livePts();
+    if (livePts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    if (secondsBehindLive <= 0.0) {
+        timeshiftGoLive();
+        return true;
+    }
+
+    const qint64 target = livePts - (qint64)(secondsBehindLive / av_q2d(m_timeshiftBuffer->timeBase()));
+    const bool paused = m_timeshiftThread && m_timeshiftThread->isPaused();
+    return enterTimeshift(m_timeshiftBuffer->seekPosition(target), paused);
+}
+
+void RTSPPlayer::timeshiftPause(bool paused)
+{
+    if (m_timeshiftThread) {
+        m_timeshiftThread->setPaused(paused);
+        return;
+    }
+    if (paused && m_timeshiftBuffer) {
+        // ֱͣͣڵǰָ֡ʱĹؼ֡Ų
+        enterTimeshift(m_timeshiftBuffer->seekPosition(m_timeshiftBuffer->livePts()), true);
+    }
+}
+
+void RTSPPlayer::timeshiftGoLive()
+{
+    if (!m_timeshiftThread) {
+        return;
+    }
+
+    m_timeshiftThread->stop();
+    m_timeshiftThread->wait();
+    delete m_timeshiftThread;
+    m_timeshiftThread = nullptr;
+
+    flushDecodePath();
+    if (m_demuxThread && m_decodeThread) {
+        m_demuxThread->setDecodeEnabled(true); // һؼ֡ʼֱ
+    }
+    updateDecoder();
+    updateStreamSelection();
+}
+
+double RTSPPlayer::timeshiftDelaySeconds() const
+{
+    return m_timeshiftThread ? m_timeshiftThread->delaySeconds() : 0.0;
+}
+
+double RTSPPlayer::timeshiftBufferedSeconds() const
+{
+    return m_timeshiftBuffer ? m_timeshiftBuffer->bufferedSeconds() : 0.0;
+}
+
+void RTSPPlayer::setFramePublishing(bool enabled, const QString& key, int slotCount)
+{
+    m_publishKey = enabled ? (key.isEmpty() ? QString("QtRtspPlayer.Frames") : key) : QString();
+    m_publishSlots = slotCount;
+    if (m_decodeThread) {
+        m_decodeThread->setFramePublishing(m_publishKey, m_publishSlots);
+    }
+    updateDecoder();
+}
+
+FramePublishStats RTSPPlayer::framePublishStats() const
+{
+    if (m_decodeThread) {
+        return m_decodeThread->framePublishStats();
+    }
+    return FramePublishStats();
+}
+
+void RTSPPlayer::setMotionRecording(bool enabled, const QString& directory, const MotionOptions& options,
+    double preRollSeconds)
+{
+    m_motionRecordEnabled = enabled;
+    m_motionRecordDir = directory;
+    m_motionOptions = options;
+    m_motionOptions.enabled = enabled || options.enabled;
+    m_preRollSeconds = enabled ? preRollSeconds : 0.0;
+
+    if (m_decodeThread) {
+        m_decodeThread->setMotionOptions(m_motionOptions);
+    }
+    if (m_recordThread) {
+        m_recordThread->setPreRollSeconds(m_preRollSeconds);
+    }
+    updateDecoder(); // ֻ¼ģʽƶҲҪ
+    if (!enabled && m_motionRecording) {
+        stopRecord();
+        m_motionRecording = false;
+    }
+}
+
+void RTSPPlayer::onMotionChanged(bool active, double level)
+{
+    Q_UNUSED(level);
+    emit sigMotionChanged(active);
+
+    if (!m_motionRecordEnabled || !m_recordThread) {
+        return;
+    }
+
+    if (active) {
+        // ֶ¼ƽʱӹ
+        if (!m_motionRecording && !m_recordThread->isRecording()) {
+            QString filePath = m_motionRecordDir + "/" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + "_motion.mp4";
+            startRecord(filePath);
+            m_motionRecording = true;
+            qDebug() << "Motion recording started:" << filePath;
+        }
+    }
+    else if (m_motionRecording) {
+        stopRecord();
+        m_motionRecording = false;
+    }
+}
+
+void RTSPPlayer::onDisplaySizeChanged(int width, int height)
+{
+    m_displayW = width;
+    m_displayH = height;
+    if (m_decodeThread) {
+        m_decodeThread->setDisplaySize(width, height);
+    }
+    if (m_subDecodeThread) {
+        m_subDecodeThread->setDisplaySize(width, height);
+    }
+    updateStreamSelection();
+}
+
 void RTSPPlayer::onScreenshotFinished(const QString& filePath, bool success)
 {
+    for (int i = m_screenshots.size() - 1; i >= 0; --i) {
+        ScreenshotThread* sink = m_screenshots.at(i);
+        if (sink->isFinished() || sink->filePath() == filePath) {
+            stopScreenshot(sink);
+            m_screenshots.removeAt(i);
+            sink->deleteLater();
+        }
+    }
+    if (m_snapshotPending) {
+        m_snapshotPending = false;
+        updateDecoder();
+    }
     emit screenshotFinished(filePath, success);
 }
\ No newline at end of file
@@ -4,7 +4,12 @@
 #include <QObject>
 #include <QString>
 #include <QQueue>
+#include <QList>
 #include <QMutex>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QPointer>
+#include <atomic>
 
 extern "C" {
 #include "libavcodec/avcodec.h"
@@ -13,8 +18,20 @@ extern "C" {
 #include "demuxthread.h"
 #include "decodethread.h"
 #include "recordthread.h"
+#include "restreamthread.h"
+#include "proxyrecordthread.h"
 
+class TimeshiftBuffer;
+class TimeshiftThread;
+class PlaybackThread;
+class ReplayThread;
+class StandbyPool;
+class ScreenshotThread;
+
+#ifndef NVR_HEADLESS
 class VideoWidget;
+class MosaicWidget;
+#endif
 
 class RTSPPlayer : public QObject
 {
@@ -23,29 +40,171 @@ public:
     explicit RTSPPlayer(QObject* parent = nullptr);
     ~RTSPPlayer();
 
+#ifndef NVR_HEADLESS
+    // 治ɼؼػ򴰿Сһʱʡģʽغʾ֡
+    // ûʱֻؼ֡¼תƲӰ죬¿ɼһؼָ֡
     void setVideoWidget(VideoWidget* widget);
+    // ʾǽĵ index 񣬴浥 VideoWidget˰ӳߴС
+    // ӻ򲥷ʱԶԭĸժ
+    void setMosaicTile(MosaicWidget* widget, int index);
+#endif
     void startPlay(const QString& url);
     void stopPlay();
+    // ֹֻ֪ͨ߳ͣȴͬʱرն·֮ stopPlay
+    void requestStop();
+
+    // ԤӳأstartPlay ĵַڳʱֱӽӹܣֻ뻺GOP
+    // stopPlay ʱӽӡɵ߹ڶ乲
+    void setStandbyPool(StandbyPool* pool) { m_standbyPool = pool; }
+    // һ startPlay һ֡ʾеĺʱ룩δͼΪ -1
+    qint64 lastSwitchLatencyMs() const { return m_switchLatencyMs; }
 
     void startRecord(const QString& filePath);
     void stopRecord();
+    void splitRecord(const QString& newFilePath);
+    bool isRecording() const;
+    // ¼ÿ¼ʱͬĿ¼¼һݵͷֱСļ<ļ>_proxy.mp4ӽ֡ź
+    // CPU ʱļ֡ԭʼ¼Ӱ죻ֻ¼ģʽ¼ڼн
+    void setProxyRecording(bool enabled, const ProxyOptions& options = ProxyOptions());
+    ProxyStats proxyStats() const;
+    // ʱ¼ƣֻдؼ֡ÿ intervalSec һ playbackSpeed ٻط
+    void startTimelapseRecord(const QString& filePath, double keyframeIntervalSec, double playbackSpeed);
 
     void screenshot(const QString& filePath);
 
+    // ֻ¼ģʽֻ DemuxThread  RecordThread
+    // ʵʱͼʱʱ꼴ͷ
+    void setRecordOnly(bool enabled);
+    void setLiveView(bool enabled);
+
+    // ʾȣأ maxWidth ҲȫʱΪ url ĵͷֱ
+    // Ŵȫʱллĵһ֡ɣ¼ʼʹ
+    // url Ϊձʾرգ´ startPlay ֮ǰûö
+    void setSubStream(const QString& url, int maxWidth = 960);
+    bool isShowingSubStream() const { return m_displayOwner == 1; }
+
+    // ̰߳ڳߴС֡
+    void setDisplayDownscale(bool enabled);
+
+    // ʱԶ߳/ģʽ´ startPlay Ч
+    void setDecoderAutoTune(bool enabled);
+    DecoderStats decoderStats() const;
+
+    // ͳƣ windowSec 룩ֿ硢ǽ
+    StreamAnalysis streamAnalysis(double windowSec = 5.0) const;
+    // 澯ֵָʱ sigStreamAlertЧ
+    void setStreamThresholds(const StreamThresholds& thresholds);
+
+    // ͳƣյƵֽ/д¼ֽ
+    quint64 bytesReceived() const;
+    quint64 packetsReceived() const;
+    quint64 bytesRecorded() const;
+
+    // ֡ڴ滷key / key.ctl FrameRingReader ȡ
+    // ЧرʱͷŹڴΣֻ¼ģʽҲᱣֽ
+    void setFramePublishing(bool enabled, const QString& key = QString(), int slotCount = 4);
+    FramePublishStats framePublishStats() const;
+
+    // ʱƣյƵ浽 filePath ָĻļ̶ capacityBytes С
+    // ͣ˵ʱ̣ٻصֱ¼Ӱ
+    void setTimeshift(bool enabled, const QString& filePath, qint64 capacityBytes = 512LL * 1024 * 1024);
+    bool timeshiftSeek(double secondsBehindLive);
+    void timeshiftPause(bool paused);
+    void timeshiftGoLive();
+    bool isTimeshifting() const { return m_timeshiftThread != nullptr; }
+    double timeshiftDelaySeconds() const;
+    double timeshiftBufferedSeconds() const;
+
+    // طű¼񣺴ֱ룬/ʾ/ͼճstopPlay ط
+    // ¼ .idx ؼ֡ʱתֱӲһֻ֡ĿڵһGOP
+    void openRecording(const QString& filePath);
+    bool isPlayback() const { return m_playbackThread != nullptr; }
+    void playbackSeek(double seconds);
+    void playbackPause(bool paused);
+    // ٻطţΪţ 2 򵹷ʱֻؼ֡CPU ռò汶
+    void setPlaybackSpeed(double speed);
+    double playbackSpeed() const;
+    double playbackDuration() const;
+    double playbackPosition() const;
+
+    // ץѵǰƵ͵ʱд filePathstopCapture  stopPlay 
+    bool startCapture(const QString& filePath);
+    void stopCapture();
+    bool isCapturing() const;
+    // ץطţֱ룬/ʾ/¼ճrealtime Ϊ false ʱܿͰ
+    void openCapture(const QString& filePath, bool realtime = true, bool loop = false);
+    bool isReplay() const { return m_replayThread != nullptr; }
+
+    //  HLS/LL-HLS תƣƵ±룬г CMAF ֶд directory¼񻥲Ӱ
+    // 򿪺ʼлԶ¿ʼ
+    void setRestream(bool enabled, const QString& directory, const RestreamOptions& options = RestreamOptions());
+    bool isRestreaming() const { return m_restreamThread != nullptr; }
+    RestreamStats restreamStats() const;
+
+    // ƶⴥ¼ƣ⵽ƶʱԶ¼Ƶ directoryƶ(ʱ)ֹͣ
+    // ǰĻ¼̵߳Ԥ¼岹
+    void setMotionRecording(bool enabled, const QString& directory, const MotionOptions& options,
+        double preRollSeconds = 5.0);
+
 signals:
-    void screenshotRequested(const QString& filePath);
     void screenshotFinished(const QString& filePath, bool success);
     void sigRealRecordStart();
     void sigRecordFinished(QString);
     void sigStreamFailed(QString error);
+    void sigStreamOpened();
     void sigGetFirstFrame();
+    void sigMotionChanged(bool active);
+    void sigPlaybackFinished();
+    void sigReplayFinished();
+    void sigRestreamFailed(QString error);
+    void sigProxyFinished(QString path);
+    // лʱwarm ʾӹԤ
+    void sigSwitchLatency(qint64 ms, bool warm);
+    void sigStreamAlert(int alert, bool active, double value);
 
 public slots:
     void onScreenshotFinished(const QString& filePath, bool success);
+    void onDisplaySizeChanged(int width, int height);
+    void onMotionChanged(bool active, double level);
+private slots:
+    void onDisplayClaimed(int id);
+    void onSubStreamFailed(QString error);
+    void onFirstFrameShown();
+    void onDisplayVisibilityChanged(bool visible);
+    void onDisplayIdleTimeout();
 private:
+#ifndef NVR_HEADLESS
+    void detachMosaicTile();
+#endif
+    bool displayWanted() const;
+    bool mainDisplayWanted() const;
+    void setDisplayIdle(bool idle);
+    void updateStreamSelection();
+    void startSubStream();
+    void stopSubStream();
+    void connectDemux();
+    bool needDecoder() const;
+    void updateDecoder();
+    void ensureDecoder();
+    void releaseDecoder();
+    // ӽ֡϶Ͽֹͣͼ߳
+    void stopScreenshot(ScreenshotThread* sink);
+    // ¼ڼѴ¼߳̽ӵ֡
+    void updateProxyOutput();
+    void openTimeshiftBuffer();
+    void closeTimeshift();
+    void openRestream();
+    void closeRestream();
+    bool enterTimeshift(qint64 position, bool paused);
+    void flushDecodePath();
+
+    StreamMetrics* m_metrics = nullptr;  // ڼռõĹڴͳƲ
+
     DemuxThread* m_demuxThread = nullptr;
     DecodeThread* m_decodeThread = nullptr;
     RecordThread* m_recordThread = nullptr;
+    PlaybackThread* m_playbackThread = nullptr;  // طʱ m_demuxThread ָͬһ
+    ReplayThread* m_replayThread = nullptr;      // ץطʱ m_demuxThread ָͬһ
 
     // ̰߳ȫ
     QQueue<AVPacket*> m_decodePacketQueue;
@@ -58,7 +217,65 @@ private:
     QMutex m_showMutex;
 
     QString m_rtspUrl;
+
+    StreamThresholds m_streamThresholds;
+    StandbyPool* m_standbyPool = nullptr;
+    QElapsedTimer m_switchTimer;
+    bool m_switchWarm = false;
+    qint64 m_switchLatencyMs = -1;
+#ifndef NVR_HEADLESS
     VideoWidget* m_videoWidget = nullptr;
+    QPointer<MosaicWidget> m_mosaicWidget;  // ʱѸӵʾժ
+    int m_mosaicIndex = -1;
+#endif
+    bool m_displayHidden = false;   // ʾؼǰɼ
+    bool m_displayIdle = false;     // ѽʡģʽ
+    bool m_firstFrameShown = false; // βлʾ
+    QTimer m_idleTimer;             // ɼһʱŽ룬лȫȶʱ
+
+    bool m_recordOnly = false;
+    bool m_liveView = false;
+    bool m_snapshotPending = false;  // ֻ¼ģʽΪͼʱ˽
+    QList<ScreenshotThread*> m_screenshots;     // ڽ֡ϡûɵĽͼ
+
+    bool m_keyframeOnly = false;    // طſ/ʱֻؼ֡
+    bool m_displayDownscale = false;
+    bool m_decoderAutoTune = true;
+
+    bool m_timeshiftEnabled = false;
+    QString m_timeshiftPath;
+    qint64 m_timeshiftBytes = 0;
+    TimeshiftBuffer* m_timeshiftBuffer = nullptr;
+    TimeshiftThread* m_timeshiftThread = nullptr;
+
+    bool m_restreamEnabled = false;
+    QString m_restreamDir;
+    RestreamOptions m_restreamOptions;
+    RestreamThread* m_restreamThread = nullptr;
+
+    ProxyRecordThread* m_proxyThread = nullptr;
+
+    // ֻʾԼĽ⸴/̣߳ʾ
+    QString m_subUrl;
+    int m_subMaxWidth = 960;
+    bool m_useSub = false;          // ʾ
+    bool m_subFailed = false;       // βϣٳ
+    std::atomic<int> m_displayOwner{ 0 };   // ǰʾ֡Ḷ̌߳0 1 
+    DemuxThread* m_subDemuxThread = nullptr;
+    DecodeThread* m_subDecodeThread = nullptr;
+    QQueue<AVPacket*> m_subDecodePacketQueue;
+    QMutex m_subDecodeMutex;
+
+    QString m_publishKey;
+    int m_publishSlots = 4;
+
+    bool m_motionRecordEnabled = false;
+    bool m_motionRecording = false;   // ǰ¼Ƿƶⷢ
+    QString m_motionRecordDir;
+    MotionOptions m_motionOptions;
+    double m_preRollSeconds = 0.0;
+    int m_displayW = 0;
+    int m_displayH = 0;
 };
 
 #endif // RTSPPLAYER_H
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "recordindex.h"
+#include <QDebug>
+#include <algorithm>
+
+#define RECORD_INDEX_MAX_PROBE 8
+
+RecordIndexWriter::RecordIndexWriter()
+{
+}
+
+RecordIndexWriter::~RecordIndexWriter()
+{
+    close();
+}
+
+bool RecordIndexWriter::open(const QString& mediaPath, AVRational timeBase)
+{
+    close();
+
+    m_file.setFileName(indexPath(mediaPath));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Record index: cannot create" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+
+    RecordIndexHeader header = {};
+    header.magic = RECORD_INDEX_MAGIC;
+    header.version = RECORD_INDEX_VERSION;
+    header.timeBaseNum = timeBase.num;
+    header.timeBaseDen = timeBase.den;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_lastPts = AV_NOPTS_VALUE;
+    return true;
+}
+
+void RecordIndexWriter::addKeyframe(qint64 pts, qint64 offset)
+{
+    // ֻܵ PTSʱ
+    if (!m_file.isOpen() || pts == AV_NOPTS_VALUE || (m_lastPts != AV_NOPTS_VALUE && pts <= m_lastPts)) {
+        return;
+    }
+    m_lastPts = pts;
+
+    RecordIndexEntry entry = { pts, offset };
+    m_file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    // ÿGOPдһΣֱ̣¼жʱ¼һ
+    m_file.flush();
+}
+
+void RecordIndexWriter::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+RecordIndex::RecordIndex()
+{
+}
+
+RecordIndex::~RecordIndex()
+{
+    close();
+}
+
+bool RecordIndex::open(const QString& mediaPath)
+{
+    close();
+
+    m_file.setFileName(RecordIndexWriter::indexPath(mediaPath));
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < (qint64)sizeof(RecordIndexHeader)) {
+        m_file.close();
+        return false;
+    }
+    m_map = m_file.map(0, size);
+    if (!m_map) {
+        qWarning() << "Record index: cannot map" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    const RecordIndexHeader* header = reinterpret_cast<const RecordIndexHeader*>(m_map);
+    if (header->magic != RECORD_INDEX_MAGIC || header->version != RECORD_INDEX_VERSION
+        || header->timeBaseNum <= 0 || header->timeBaseDen <= 0) {
+        qWarning() << "Record index: invalid header" << m_file.fileName();
+        close();
+        return false;
+    }
+
+    m_timeBase = AVRational{ header->timeBaseNum, header->timeBaseDen };
+    m_count = (int)((size - sizeof(RecordIndexHeader)) / sizeof(RecordIndexEntry));
+    m_entries = reinterpret_cast<const RecordIndexEntry*>(m_map + sizeof(RecordIndexHeader));
+    qDebug() << "Record index" << m_file.fileName() << m_count << "keyframes";
+    return true;
+}
+
+void RecordIndex::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_entries = nullptr;
+    m_count = 0;
+}
+
+int RecordIndex::find(qint64 pts) const
+{
+    if (m_count <= 0) {
+        return -1;
+    }
+    const qint64 first = m_entries[0].pts;
+    const qint64 last = m_entries[m_count - 1].pts;
+    if (pts <= first) {
+        return 0;
+    }
+    if (pts >= last) {
+        return m_count - 1;
+    }
+
+    // ֵ㣬ǰ at(i).pts <= pts < at(i + 1).pts
+    int i = (int)((double)(pts - first) / (double)(last - first) * (m_count - 1));
+    i = qBound(0, i, m_count - 2);
+    for (int step = 0; step < RECORD_INDEX_MAX_PROBE; ++step) {
+        if (m_entries[i].pts > pts) {
+            --i;
+        }
+        else if (m_entries[i + 1].pts <= pts) {
+            ++i;
+        }
+        else {
+            return i;
+        }
+    }
+
+    // ؼ֡ܲʱ˻ضֲ
+    const RecordIndexEntry* end = m_entries + m_count;
+    const RecordIndexEntry* it = std::upper_bound(m_entries, end, pts,
+        [](qint64 value, const RecordIndexEntry& entry) { return value < entry.pts; });
+    return (int)(it - m_entries) - 1;
+}
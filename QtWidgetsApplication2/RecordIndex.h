@@ -0,0 +1,80 @@
+#ifndef RECORDINDEX_H
+#define RECORDINDEX_H
+
+#include <QFile>
+#include <QString>
+
+extern "C" {
+#include "libavutil/avutil.h"
+#include "libavutil/rational.h"
+}
+
+// ¼ԱߵĹؼ֡ļ¼· + ".idx" RecordThread ¼д
+// ֣32 ֽļͷ + ɶĿĿļСƳ¼жҲдĲ
+// PTS ʹ¼ļƵʱ 0 ʼoffset Ϊؼ֡¼ļеֽλ
+#define RECORD_INDEX_MAGIC 0x58444952u   // "RIDX"
+#define RECORD_INDEX_VERSION 1
+
+struct RecordIndexHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32 timeBaseNum;
+    qint32 timeBaseDen;
+    quint64 reserved[2];
+};
+static_assert(sizeof(RecordIndexHeader) == 32, "RecordIndexHeader layout changed");
+
+struct RecordIndexEntry
+{
+    qint64 pts;
+    qint64 offset;
+};
+static_assert(sizeof(RecordIndexEntry) == 16, "RecordIndexEntry layout changed");
+
+class RecordIndexWriter
+{
+public:
+    RecordIndexWriter();
+    ~RecordIndexWriter();
+
+    bool open(const QString& mediaPath, AVRational timeBase);
+    void addKeyframe(qint64 pts, qint64 offset);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    static QString indexPath(const QString& mediaPath) { return mediaPath + ".idx"; }
+
+private:
+    QFile m_file;
+    qint64 m_lastPts = AV_NOPTS_VALUE;
+};
+
+// ֻļӳ䵽ڴ棬ҲҪ
+class RecordIndex
+{
+public:
+    RecordIndex();
+    ~RecordIndex();
+
+    bool open(const QString& mediaPath);
+    void close();
+    bool isOpen() const { return m_entries != nullptr; }
+
+    AVRational timeBase() const { return m_timeBase; }
+    int count() const { return m_count; }
+    const RecordIndexEntry& at(int i) const { return m_entries[i]; }
+
+    // PTS  pts һؼ֡ȵһؼ֡ʱصһ -1
+    // ؼ֡¾ȣȰλپͽͨҵ
+    int find(qint64 pts) const;
+
+private:
+    QFile m_file;
+    uchar* m_map = nullptr;
+    const RecordIndexEntry* m_entries = nullptr;
+    int m_count = 0;
+    AVRational m_timeBase{ 1, 1000 };
+};
+
+#endif // RECORDINDEX_H
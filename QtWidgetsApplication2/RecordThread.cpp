@@ -1,4 +1,5 @@
 #include "recordthread.h"
+#include "threadpolicy.h"
 #include <QDebug>
 
 RecordThread::RecordThread(QQueue<AVPacket*>* packetQueue, QMutex* queueMutex, QObject* parent)
@@ -12,13 +13,19 @@ RecordThread::~RecordThread()
     wait();
 }
 
-void RecordThread::startRecord(const QString& filePath, AVStream* videoStream)
+void RecordThread::startRecord(const QString& filePath, AVStream* videoStream, const TimelapseOptions& timelapse)
 {
     if (m_isRecording) {
         return;
     }
     m_filePath = filePath;
     m_inVideoStream = videoStream;
+    m_timelapse = timelapse;
+    if (m_timelapse.playbackSpeed <= 0.0) {
+        m_timelapse.playbackSpeed = 1.0;
+    }
+    m_lastKeyPts = AV_NOPTS_VALUE;
+    m_lastOutPts = AV_NOPTS_VALUE;
     m_isRecording = true;
     m_startTime = AV_NOPTS_VALUE; //  ʼʱ
 }
@@ -26,6 +33,22 @@ void RecordThread::startRecord(const QString& filePath, AVStream* videoStream)
 void RecordThread::stopRecord()
 {
     m_isRecording = false;
+    m_splitRequested = false;
+}
+
+void RecordThread::splitRecord(const QString& newFilePath)
+{
+    if (!m_isRecording) {
+        return;
+    }
+    QMutexLocker locker(&m_splitMutex);
+    m_splitPath = newFilePath;
+    m_splitRequested = true;
+}
+
+void RecordThread::setPreRollSeconds(double seconds)
+{
+    m_preRollMs = seconds > 0.0 ? (int)(seconds * 1000.0) : 0;
 }
 
 void RecordThread::stop()
@@ -43,14 +66,78 @@ void RecordThread::closeFile()
         }
         avformat_free_context(m_outputFmtCtx);
         m_outputFmtCtx = nullptr;
+        m_index.close();
+        metricsAdd(m_metrics, &StreamMetrics::filesClosed);
         qDebug() << "Recording stopped and file saved to" << m_filePath;
         emit sigRecordFinished(m_filePath);
     }
 }
 
+bool RecordThread::acceptTimelapsePacket(AVPacket* packet)
+{
+    // ֻؼ֡ǹؼ֡ǰ֡д޷
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    if (m_timelapse.keyframeIntervalSec > 0.0 && m_lastKeyPts != AV_NOPTS_VALUE) {
+        double elapsed = (packet->pts - m_lastKeyPts) * av_q2d(m_inVideoStream->time_base);
+        if (elapsed >= 0.0 && elapsed < m_timelapse.keyframeIntervalSec) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RecordThread::clearPreRoll()
+{
+    while (!m_preRoll.isEmpty()) {
+        AVPacket* p = m_preRoll.dequeue().packet;
+        av_packet_free(&p);
+    }
+}
+
+void RecordThread::trimPreRoll()
+{
+    const int MAX_PREROLL_PACKETS = 3000; // ڴޣ4K 30fps Լ100
+    const int preRollMs = m_preRollMs;
+    if (preRollMs <= 0) {
+        clearPreRoll();
+        return;
+    }
+
+    // ҵһѾ㹻ɡĹؼ֮֡ǰİԶ
+    const qint64 now = m_clock.elapsed();
+    int keepFrom = -1;
+    for (int i = 0; i < m_preRoll.size(); ++i) {
+        const PreRollPacket& p = m_preRoll.at(i);
+        if (now - p.arrivalMs < preRollMs) {
+            break;
+        }
+        if (p.packet->flags & AV_PKT_FLAG_KEY) {
+            keepFrom = i;
+        }
+    }
+    for (int i = 0; i < keepFrom; ++i) {
+        AVPacket* p = m_preRoll.dequeue().packet;
+        av_packet_free(&p);
+    }
+
+    // ͷǹؼ֡ʱһؼ֡Ϊֹ
+    while (!m_preRoll.isEmpty()
+        && (!(m_preRoll.head().packet->flags & AV_PKT_FLAG_KEY) || m_preRoll.size() > MAX_PREROLL_PACKETS)) {
+        AVPacket* p = m_preRoll.dequeue().packet;
+        av_packet_free(&p);
+    }
+}
+
 void RecordThread::run()
 {
+    ThreadPolicyScope policyScope(StageRecord);
+    m_clock.start();
     while (!m_stopped) {
+        PipelineMetrics::heartbeat(m_metrics);
+        metricsSet(m_metrics, &StreamMetrics::recording, m_outputFmtCtx ? 1 : 0);
+
         if (!m_isRecording) {
             // ֮ǰ¼ƣֹͣˣҪرļ
             if (m_outputFmtCtx) {
@@ -58,12 +145,20 @@ void RecordThread::run()
             }
 
             //  ؼ޸¼ʱ¼ƶԷֹѻ 
+            // Ԥ¼ʱѰƵԤ¼Уֻһ
+            const qint64 now = m_clock.elapsed();
             m_queueMutex->lock();
             while (!m_packetQueue->isEmpty()) {
                 AVPacket* p = m_packetQueue->dequeue();
-                av_packet_free(&p); // ȡ
+                if (m_preRollMs > 0) {
+                    m_preRoll.enqueue({ p, now });
+                }
+                else {
+                    av_packet_free(&p); // ȡ
+                }
             }
             m_queueMutex->unlock();
+            trimPreRoll();
 
             // ߣתCPU
             msleep(100);
@@ -72,14 +167,38 @@ void RecordThread::run()
 
         //  ߼عʼ 
 
-        m_queueMutex->lock();
-        if (m_packetQueue->isEmpty()) {
+        // дԤ¼еİǴӹؼ֡ʼ
+        AVPacket* packet = nullptr;
+        if (!m_preRoll.isEmpty()) {
+            packet = m_preRoll.dequeue().packet;
+        }
+        else {
+            m_queueMutex->lock();
+            if (m_packetQueue->isEmpty()) {
+                m_queueMutex->unlock();
+                msleep(10);
+                continue;
+            }
+            packet = m_packetQueue->dequeue();
             m_queueMutex->unlock();
-            msleep(10);
+        }
+
+        // ʱ¼ƣڴļ֮ǰ͹ˣİд
+        if (m_timelapse.enabled && !acceptTimelapsePacket(packet)) {
+            av_packet_free(&packet);
             continue;
         }
-        AVPacket* packet = m_packetQueue->dequeue();
-        m_queueMutex->unlock();
+
+        // ֶΣֻڹؼ֡лļļܶ
+        if (m_splitRequested && m_outputFmtCtx && (packet->flags & AV_PKT_FLAG_KEY)) {
+            closeFile();
+            {
+                QMutexLocker locker(&m_splitMutex);
+                m_filePath = m_splitPath;
+            }
+            m_splitRequested = false;
+            m_lastOutPts = AV_NOPTS_VALUE;
+        }
 
         // 1¼ƻûʼļδ򿪣ȴؼ֡
         if (!m_outputFmtCtx) {
@@ -133,6 +252,8 @@ void RecordThread::run()
                     continue;
                 }
 
+                // дļͷʱȷ
+                m_index.open(m_filePath, m_outputFmtCtx->streams[0]->time_base);
                 qDebug() << "Recording started to" << m_filePath;
                 m_startTime = packet->pts;
             }
@@ -144,21 +265,47 @@ void RecordThread::run()
         }
 
         // ִеģҪôǵһؼ֡ҪôǺͨ֡
-        packet->pts -= m_startTime;
-        packet->dts -= m_startTime;
+        if (m_timelapse.enabled) {
+            // طűѹʱᣬ֤ʱϸ
+            m_lastKeyPts = packet->pts;
+            int64_t outPts = (int64_t)((packet->pts - m_startTime) / m_timelapse.playbackSpeed);
+            if (m_lastOutPts != AV_NOPTS_VALUE && outPts <= m_lastOutPts) {
+                outPts = m_lastOutPts + 1;
+            }
+            m_lastOutPts = outPts;
+            packet->pts = outPts;
+            packet->dts = outPts;
+            packet->duration = 0;
+        }
+        else {
+            packet->pts -= m_startTime;
+            packet->dts -= m_startTime;
+        }
 
         // ʱת
         av_packet_rescale_ts(packet, m_inVideoStream->time_base, m_outputFmtCtx->streams[0]->time_base);
         packet->stream_index = 0;
         packet->pos = -1;
 
+        const int packetSize = packet->size;
+        if ((packet->flags & AV_PKT_FLAG_KEY) && m_outputFmtCtx->pb) {
+            // ֻһ·ʱд벻Ỻ棬д֮ǰλþؼ֡ļеƫ
+            m_index.addKeyframe(packet->pts, avio_tell(m_outputFmtCtx->pb));
+        }
         if (av_interleaved_write_frame(m_outputFmtCtx, packet) < 0) {
             qWarning() << "Error muxing packet";
         }
+        else {
+            m_bytesWritten.fetch_add(packetSize, std::memory_order_relaxed);
+            metricsAdd(m_metrics, &StreamMetrics::packetsWritten);
+            metricsAdd(m_metrics, &StreamMetrics::bytesWritten, packetSize);
+        }
 
         av_packet_free(&packet);
     }
 
     closeFile();
+    clearPreRoll();
+    metricsSet(m_metrics, &StreamMetrics::recording, 0);
     qDebug() << "Record thread finished.";
 }
\ No newline at end of file
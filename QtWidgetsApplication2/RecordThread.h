@@ -5,12 +5,24 @@
 #include <QQueue>
 #include <QMutex>
 #include <QString>
+#include <QElapsedTimer>
 #include <atomic>
 
+#include "pipelinemetrics.h"
+#include "recordindex.h"
+
 extern "C" {
 #include "libavformat/avformat.h"
 }
 
+// ʱ¼Ʋֻ±
+struct TimelapseOptions
+{
+    bool enabled = false;
+    double keyframeIntervalSec = 0.0; // 0 ʾÿؼ֡ÿ N 뱣һؼ֡
+    double playbackSpeed = 60.0;      // طű٣60 ʾһӵĻطһ
+};
+
 class RecordThread : public QThread
 {
     Q_OBJECT
@@ -18,9 +30,20 @@ public:
     RecordThread(QQueue<AVPacket*>* packetQueue, QMutex* queueMutex, QObject* parent = nullptr);
     ~RecordThread();
 
-    void startRecord(const QString& filePath, AVStream* videoStream);
+    void startRecord(const QString& filePath, AVStream* videoStream,
+        const TimelapseOptions& timelapse = TimelapseOptions());
     void stopRecord();
+    // ֶΣһؼ֡رյǰļʼд newFilePath
+    void splitRecord(const QString& newFilePath);
     void stop();
+    bool isRecording() const { return m_isRecording; }
+    quint64 bytesWritten() const { return m_bytesWritten; }
+
+    // ڴͳƣ start() ǰã¼߳ͬʱˢ
+    void setMetrics(StreamMetrics* metrics) { m_metrics = metrics; }
+
+    // Ԥ¼¼ʱ seconds 루ӹؼ֡ʼİʼ¼ʱһд
+    void setPreRollSeconds(double seconds);
 signals:
     void sigRealRecordStart();
     void sigRecordFinished(QString path);
@@ -29,6 +52,15 @@ protected:
 
 private:
     void closeFile();
+    bool acceptTimelapsePacket(AVPacket* packet);
+    void trimPreRoll();
+    void clearPreRoll();
+
+    struct PreRollPacket
+    {
+        AVPacket* packet;
+        qint64 arrivalMs;
+    };
 
     QQueue<AVPacket*>* m_packetQueue;
     QMutex* m_queueMutex;
@@ -40,6 +72,21 @@ private:
     AVStream* m_inVideoStream = nullptr;
     QString m_filePath;
     int64_t m_startTime = AV_NOPTS_VALUE;
+
+    TimelapseOptions m_timelapse;
+    int64_t m_lastKeyPts = AV_NOPTS_VALUE; // һдĹؼ֡ʱ
+    int64_t m_lastOutPts = AV_NOPTS_VALUE; // һдʱʱ
+
+    std::atomic<bool> m_splitRequested{ false };
+    QString m_splitPath;
+    QMutex m_splitMutex;
+    std::atomic<quint64> m_bytesWritten{ 0 };
+    StreamMetrics* m_metrics = nullptr;
+    RecordIndexWriter m_index;             // ¼ԵĹؼ֡طʱת
+
+    std::atomic<int> m_preRollMs{ 0 };
+    QQueue<PreRollPacket> m_preRoll;       // ֻ¼߳ڷ
+    QElapsedTimer m_clock;
     bool m_isRealStart = false;
 };
 
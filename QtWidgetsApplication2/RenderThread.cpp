@@ -0,0 +1,525 @@
+#include "renderthread.h"
+#include "threadpolicy.h"
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QOffscreenSurface>
+#include <QDebug>
+
+// YUV420P ȾĶɫ
+const char* vertexShaderSource =
+"attribute vec4 vertexIn;\n"
+"attribute vec2 textureIn;\n"
+"varying vec2 textureOut;\n"
+"void main(void)\n"
+"{\n"
+"    gl_Position = vertexIn;\n"
+"    textureOut = textureIn;\n"
+"}\n";
+
+// ͨYUVƬɫʱͨ PLANAR / FULL_RANGE ػ
+const char* fragmentShaderSource_YUV =
+"varying vec2 textureOut;\n"
+"uniform sampler2D tex_y;\n"
+"#ifdef PLANAR\n"
+"uniform sampler2D tex_u;\n"
+"uniform sampler2D tex_v;\n"
+"#else\n"
+"uniform sampler2D tex_uv;\n"
+"#endif\n"
+"uniform float sample_scale;\n"
+"uniform vec4 yuv_coeffs;\n"
+"void main(void)\n"
+"{\n"
+"    // 1. ԭʼ YUV ֵ16λλһ\n"
+"    float y_raw = texture2D(tex_y, textureOut).r * sample_scale;\n"
+"#ifdef PLANAR\n"
+"    vec2 uv_raw = vec2(texture2D(tex_u, textureOut).r, texture2D(tex_v, textureOut).r) * sample_scale;\n"
+"#else\n"
+"    vec2 uv_raw = texture2D(tex_uv, textureOut).rg * sample_scale;\n"
+"#endif\n"
+"\n"
+"#ifdef FULL_RANGE\n"
+"    float y = y_raw;\n"
+"    vec2 uv = uv_raw - 0.5;\n"
+"#else\n"
+"    // 2.  Limited Range (16-235 for Y, 16-240 for UV) չ Full Range (0-1.0)\n"
+"    float y = (y_raw - 0.0627) / 0.8588;\n"
+"    vec2 uv = (uv_raw - 0.0627) / 0.8784;\n"
+"    uv -= 0.5; //  UV  [0,1] ƫƵ [-0.5, 0.5]\n"
+"#endif\n"
+"\n"
+"    // 3. ֡ɫʿռѡתϵ (BT.601 / BT.709 / BT.2020)\n"
+"    float r = y + yuv_coeffs.x * uv.y;\n"
+"    float g = y - yuv_coeffs.y * uv.x - yuv_coeffs.z * uv.y;\n"
+"    float b = y + yuv_coeffs.w * uv.x;\n"
+"\n"
+"    gl_FragColor = vec4(r, g, b, 1.0);\n"
+"}\n";
+
+#ifndef GL_R16
+#define GL_R16 0x822A
+#endif
+#ifndef GL_RG16
+#define GL_RG16 0x822C
+#endif
+
+RenderThread::RenderThread(QOpenGLContext* shareContext, QOffscreenSurface* surface, QObject* parent)
+    : QThread(parent), m_surface(surface)
+{
+    // GUI̴߳ƽȾ߳ʹ
+    m_context = new QOpenGLContext();
+    m_context->setFormat(shareContext->format());
+    m_context->setShareContext(shareContext);
+    if (!m_context->create()) {
+        qCritical() << "RenderThread: failed to create shared OpenGL context.";
+    }
+    m_context->moveToThread(this);
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+    wait();
+    delete m_context;
+    m_context = nullptr;
+}
+
+void RenderThread::setMyQueue(QQueue<AVFrame*>* queue)
+{
+    QMutexLocker locker(&m_sourceMutex);
+    m_queue = queue;
+}
+
+void RenderThread::setMyMutex(QMutex* mutex)
+{
+    QMutexLocker locker(&m_sourceMutex);
+    m_mutex = mutex;
+}
+
+void RenderThread::setTargetSize(int width, int height)
+{
+    m_targetW = width;
+    m_targetH = height;
+}
+
+void RenderThread::setFrameInterval(int ms)
+{
+    m_frameIntervalMs = qMax(1, ms);
+}
+
+void RenderThread::setPaused(bool paused)
+{
+    m_paused = paused;
+}
+
+void RenderThread::clear()
+{
+    m_clearRequested = true;
+}
+
+void RenderThread::stop()
+{
+    m_stopped = true;
+}
+
+GLuint RenderThread::lockFrontTexture()
+{
+    m_frontMutex.lock();
+    QOpenGLFramebufferObject* front = m_fbo[m_backIndex ^ 1];
+    return (m_frontValid && front) ? front->texture() : 0;
+}
+
+void RenderThread::unlockFrontTexture()
+{
+    m_frontMutex.unlock();
+}
+
+RenderStats RenderThread::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+bool RenderThread::initResources()
+{
+    glGenTextures(3, m_textures);
+    for (int i = 0; i < 3; ++i) {
+        glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+    // NV12ǰ룬ʽһγʱٱ
+    VideoPlaneLayout nv12;
+    return programFor(nv12) != nullptr;
+}
+
+QOpenGLShaderProgram* RenderThread::programFor(const VideoPlaneLayout& layout)
+{
+    const int index = (layout.planar ? 2 : 0) + (layout.fullRange ? 1 : 0);
+    if (m_programs[index]) {
+        return m_programs[index];
+    }
+
+    QByteArray fragment;
+    if (layout.planar) {
+        fragment += "#define PLANAR\n";
+    }
+    if (layout.fullRange) {
+        fragment += "#define FULL_RANGE\n";
+    }
+    fragment += fragmentShaderSource_YUV;
+
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram();
+    program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+    program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment);
+    if (!program->link()) {
+        qCritical() << "RenderThread: shader link failed" << program->log();
+        delete program;
+        return nullptr;
+    }
+
+    program->bind();
+    program->setUniformValue("tex_y", 0);
+    if (layout.planar) {
+        program->setUniformValue("tex_u", 1);
+        program->setUniformValue("tex_v", 2);
+    }
+    else {
+        program->setUniformValue("tex_uv", 1);
+    }
+    program->release();
+
+    m_programs[index] = program;
+    return program;
+}
+
+void RenderThread::releaseResources()
+{
+    clearTargets();
+
+    for (int i = 0; i < 4; ++i) {
+        delete m_programs[i];
+        m_programs[i] = nullptr;
+    }
+    if (m_textures[0]) {
+        glDeleteTextures(3, m_textures);
+        m_textures[0] = m_textures[1] = m_textures[2] = 0;
+    }
+    m_videoFormat = -1;
+
+    QMutexLocker locker(&m_frontMutex);
+    for (int i = 0; i < 2; ++i) {
+        delete m_fbo[i];
+        m_fbo[i] = nullptr;
+    }
+    if (m_frame) {
+        av_frame_free(&m_frame);
+    }
+}
+
+void RenderThread::run()
+{
+    ThreadPolicyScope policyScope(StageRender);
+    const int MAX_CATCHUP_DEPTH = 2;
+    const int PAUSED_POLL_MS = 50;
+
+    if (!m_context->makeCurrent(m_surface)) {
+        qCritical() << "RenderThread: makeCurrent failed.";
+        return;
+    }
+    initializeOpenGLFunctions();
+
+    if (!initResources()) {
+        releaseResources();
+        m_context->doneCurrent();
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    m_statsTimer.start();
+    qint64 nextPresentMs = 0;
+    int lastW = 0, lastH = 0;
+
+    while (!m_stopped) {
+        if (m_clearRequested.exchange(false)) {
+            if (m_frame) {
+                av_frame_free(&m_frame);
+            }
+            m_videoW = 0;
+            m_videoH = 0;
+            clearTargets();
+            emit frameReady();
+        }
+
+        if (m_paused) {
+            msleep(PAUSED_POLL_MS);
+            continue;
+        }
+
+        const int targetW = m_targetW;
+        const int targetH = m_targetH;
+        const bool sizeChanged = (targetW != lastW || targetH != lastH);
+        const qint64 now = clock.elapsed();
+
+        // ֡ӣȾ಻GUI̵߳¼ѭ
+        AVFrame* next = nullptr;
+        int depth = 0;
+        if (now >= nextPresentMs) {
+            QMutexLocker locker(&m_sourceMutex);
+            if (m_queue && m_mutex) {
+                QMutexLocker queueLocker(m_mutex);
+                if (!m_queue->isEmpty()) {
+                    next = m_queue->dequeue();
+                }
+                depth = m_queue->size();
+            }
+        }
+
+        if (next) {
+            if (m_frame) {
+                av_frame_free(&m_frame);
+            }
+            m_frame = next;
+
+            QElapsedTimer stageTimer;
+            stageTimer.start();
+            bool uploaded = uploadFrame(m_frame);
+            double uploadMs = stageTimer.nsecsElapsed() / 1000000.0;
+
+            stageTimer.restart();
+            if (uploaded) {
+                drawFrame();
+            }
+            double drawMs = stageTimer.nsecsElapsed() / 1000000.0;
+
+            lastW = targetW;
+            lastH = targetH;
+            updateStats(uploadMs, drawMs, depth);
+            emit frameReady();
+
+            int interval = m_frameIntervalMs;
+            if (depth > MAX_CATCHUP_DEPTH) {
+                interval = interval * 3 / 4; // лѹʱ΢ӿ죬׷
+            }
+            if (nextPresentMs + interval < now) {
+                nextPresentMs = now;
+            }
+            nextPresentMs += interval;
+        }
+        else if (sizeChanged && m_frame && m_videoW > 0) {
+            // ڳߴ仯ʱһ֡ػ
+            drawFrame();
+            lastW = targetW;
+            lastH = targetH;
+            emit frameReady();
+        }
+        else {
+            qint64 wait = nextPresentMs - clock.elapsed();
+            msleep((unsigned long)qBound<qint64>(1, wait, 5));
+        }
+    }
+
+    releaseResources();
+    m_context->doneCurrent();
+    qDebug() << "Render thread finished.";
+}
+
+bool RenderThread::uploadFrame(AVFrame* frame)
+{
+    VideoPlaneLayout layout;
+    if (!frame || !frame->data[0] || !frame->data[1]
+        || !videoPlaneLayout((AVPixelFormat)frame->format, &layout)) {
+        return false;
+    }
+    if (layout.planar && !frame->data[2]) {
+        return false;
+    }
+    if (frame->color_range == AVCOL_RANGE_JPEG) {
+        layout.fullRange = true;
+    }
+
+    const GLenum type = layout.sixteenBit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    const GLint lumaFormat = layout.sixteenBit ? GL_R16 : GL_RED;
+    const GLint chromaFormat = layout.planar ? lumaFormat : (layout.sixteenBit ? GL_RG16 : GL_RG);
+    const int bytesPerSample = layout.sixteenBit ? 2 : 1;
+    const int chromaW = (frame->width + 1) / 2;
+    const int chromaH = (frame->height + 1) / 2;
+
+    // ߴʽ仯ʱ·洢
+    if (m_videoW != frame->width || m_videoH != frame->height || m_videoFormat != frame->format) {
+        m_videoW = frame->width;
+        m_videoH = frame->height;
+        m_videoFormat = frame->format;
+        glBindTexture(GL_TEXTURE_2D, m_textures[0]);
+        glTexImage2D(GL_TEXTURE_2D, 0, lumaFormat, m_videoW, m_videoH, 0, GL_RED, type, nullptr);
+        glBindTexture(GL_TEXTURE_2D, m_textures[1]);
+        glTexImage2D(GL_TEXTURE_2D, 0, chromaFormat, chromaW, chromaH, 0, layout.planar ? GL_RED : GL_RG, type, nullptr);
+        if (layout.planar) {
+            glBindTexture(GL_TEXTURE_2D, m_textures[2]);
+            glTexImage2D(GL_TEXTURE_2D, 0, chromaFormat, chromaW, chromaH, 0, GL_RED, type, nullptr);
+        }
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_textures[0]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[0] / bytesPerSample);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_videoW, m_videoH, GL_RED, type, frame->data[0]);
+
+    if (layout.planar) {
+        for (int plane = 1; plane <= 2; ++plane) {
+            glActiveTexture(GL_TEXTURE0 + plane);
+            glBindTexture(GL_TEXTURE_2D, m_textures[plane]);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[plane] / bytesPerSample);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaW, chromaH, GL_RED, type, frame->data[plane]);
+        }
+    }
+    else {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_textures[1]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize[1] / (2 * bytesPerSample));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaW, chromaH, GL_RG, type, frame->data[1]);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    yuvToRgbCoefficients(frame->colorspace, m_coeffs);
+
+    m_layout = layout;
+    return true;
+}
+
+void RenderThread::drawFrame()
+{
+    const int targetW = m_targetW;
+    const int targetH = m_targetH;
+    if (targetW <= 0 || targetH <= 0 || m_videoW <= 0 || m_videoH <= 0) {
+        return;
+    }
+
+    QOpenGLFramebufferObject*& back = m_fbo[m_backIndex];
+    if (!back || back->width() != targetW || back->height() != targetH) {
+        delete back;
+        back = new QOpenGLFramebufferObject(targetW, targetH);
+    }
+
+    back->bind();
+    glViewport(0, 0, targetW, targetH);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QOpenGLShaderProgram* program = programFor(m_layout);
+    if (!program) {
+        back->release();
+        return;
+    }
+
+    for (int plane = 0; plane < (m_layout.planar ? 3 : 2); ++plane) {
+        glActiveTexture(GL_TEXTURE0 + plane);
+        glBindTexture(GL_TEXTURE_2D, m_textures[plane]);
+    }
+
+    program->bind();
+    program->setUniformValue("sample_scale", m_layout.sampleScale);
+    program->setUniformValue("yuv_coeffs", m_coeffs[0], m_coeffs[1], m_coeffs[2], m_coeffs[3]);
+
+    float videoAspect = (float)m_videoW / (float)m_videoH;
+    float widgetAspect = (float)targetW / (float)targetH;
+
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    if (widgetAspect > videoAspect)
+    {
+        scaleX = videoAspect / widgetAspect;
+    }
+    else
+    {
+        scaleY = widgetAspect / videoAspect;
+    }
+
+    const GLfloat vertices[] =
+    {
+        -1.0f * scaleX, -1.0f * scaleY,
+         1.0f * scaleX, -1.0f * scaleY,
+        -1.0f * scaleX,  1.0f * scaleY,
+         1.0f * scaleX,  1.0f * scaleY,
+    };
+
+    const GLfloat texcoords[] =
+    {
+        0.0f, 1.0f,
+        1.0f, 1.0f,
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+    };
+
+    int vertexIn = program->attributeLocation("vertexIn");
+    int textureIn = program->attributeLocation("textureIn");
+
+    program->enableAttributeArray(vertexIn);
+    program->enableAttributeArray(textureIn);
+
+    program->setAttributeArray(vertexIn, GL_FLOAT, vertices, 2);
+    program->setAttributeArray(textureIn, GL_FLOAT, texcoords, 2);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    program->disableAttributeArray(vertexIn);
+    program->disableAttributeArray(textureIn);
+    program->release();
+    back->release();
+
+    // ȷGUI̵߳Ĳʱһ֡Ѿ
+    glFinish();
+    swapBuffers();
+}
+
+void RenderThread::swapBuffers()
+{
+    QMutexLocker locker(&m_frontMutex);
+    m_backIndex ^= 1;
+    m_frontValid = true;
+}
+
+void RenderThread::clearTargets()
+{
+    QMutexLocker locker(&m_frontMutex);
+    m_frontValid = false;
+}
+
+void RenderThread::updateStats(double uploadMs, double drawMs, int queueDepth)
+{
+    const double alpha = 0.1; // ָƽϵ
+    const double frameMs = uploadMs + drawMs;
+    m_framesInWindow++;
+    m_maxInWindow = qMax(m_maxInWindow, frameMs);
+
+    StreamMetrics* metrics = m_metrics.load(std::memory_order_relaxed);
+    metricsAdd(metrics, &StreamMetrics::framesPresented);
+    metricsSet(metrics, &StreamMetrics::renderQueueDepth, queueDepth);
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.presentedFrames++;
+    m_stats.queueDepth = queueDepth;
+    if (m_stats.presentedFrames == 1) {
+        m_stats.avgUploadMs = uploadMs;
+        m_stats.avgDrawMs = drawMs;
+    }
+    else {
+        m_stats.avgUploadMs = m_stats.avgUploadMs * (1.0 - alpha) + uploadMs * alpha;
+        m_stats.avgDrawMs = m_stats.avgDrawMs * (1.0 - alpha) + drawMs * alpha;
+    }
+
+    const qint64 elapsed = m_statsTimer.elapsed();
+    if (elapsed >= 1000) {
+        m_stats.fps = m_framesInWindow * 1000.0 / elapsed;
+        m_stats.maxFrameMs = m_maxInWindow;
+        m_framesInWindow = 0;
+        m_maxInWindow = 0.0;
+        m_statsTimer.restart();
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QThread>
+#include <QQueue>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QOpenGLFunctions>
+#include <atomic>
+
+extern "C" {
+#include "libavutil/frame.h"
+}
+
+#include "videoformat.h"
+#include "pipelinemetrics.h"
+
+class QOpenGLContext;
+class QOpenGLShaderProgram;
+class QOpenGLFramebufferObject;
+class QOffscreenSurface;
+
+// Ⱦ̵߳֡ʱͳ
+struct RenderStats
+{
+    quint64 presentedFrames = 0;  // Ⱦ֡
+    double fps = 0.0;             // һȾ֡
+    double avgUploadMs = 0.0;     // ϴƽʱ
+    double avgDrawMs = 0.0;       // (YUV->RGB)ƽʱ
+    double maxFrameMs = 0.0;      // һ뵥֡ʱ
+    int queueDepth = 0;           // ʾг
+};
+
+// Ⱦ̣߳ӵԼ QOpenGLContext VideoWidget Ĺ
+// ӡϴ Y/UV תΪRGBFBOGUIֻ߳ϳһ
+// ֧ NV12YUV420PYUVJ420PP010/P016YUV420P10 ֱϴCPUת
+class RenderThread : public QThread, protected QOpenGLFunctions
+{
+    Q_OBJECT
+public:
+    // surface GUI̴߳ɵ߹
+    RenderThread(QOpenGLContext* shareContext, QOffscreenSurface* surface, QObject* parent = nullptr);
+    ~RenderThread();
+
+    void setMyQueue(QQueue<AVFrame*>* queue);
+    void setMyMutex(QMutex* mutex);
+
+    void setTargetSize(int width, int height);
+    void setFrameInterval(int ms);
+    // ͣʱӡȾ֪ͨGUI߳ػֻƵǷָ
+    void setPaused(bool paused);
+    void clear();
+    void stop();
+
+    // GUI̺߳ϳʱãһ֡RGB0ʾûл
+    GLuint lockFrontTexture();
+    void unlockFrontTexture();
+
+    RenderStats stats() const;
+
+    // ڴͳƣплʱɲã
+    void setMetrics(StreamMetrics* metrics) { m_metrics = metrics; }
+
+signals:
+    void frameReady();
+
+protected:
+    void run() override;
+
+private:
+    bool initResources();
+    QOpenGLShaderProgram* programFor(const VideoPlaneLayout& layout);
+    void releaseResources();
+    bool uploadFrame(AVFrame* frame);
+    void drawFrame();
+    void clearTargets();
+    void swapBuffers();
+    void updateStats(double uploadMs, double drawMs, int queueDepth);
+
+    QOpenGLContext* m_context = nullptr;
+    QOffscreenSurface* m_surface = nullptr;
+
+    QQueue<AVFrame*>* m_queue = nullptr;
+    QMutex* m_mutex = nullptr;
+    QMutex m_sourceMutex;
+
+    volatile bool m_stopped = false;
+    std::atomic<bool> m_clearRequested{ false };
+    std::atomic<bool> m_paused{ false };
+    std::atomic<int> m_targetW{ 0 };
+    std::atomic<int> m_targetH{ 0 };
+    std::atomic<int> m_frameIntervalMs{ 33 };
+    std::atomic<StreamMetrics*> m_metrics{ nullptr };
+
+    //  ƽ/֯ x TV/ȫΧ ֵɫõʱű
+    QOpenGLShaderProgram* m_programs[4] = { nullptr, nullptr, nullptr, nullptr };
+    AVFrame* m_frame = nullptr;
+    GLuint m_textures[3] = { 0, 0, 0 }; // Y, U(UV), V
+    VideoPlaneLayout m_layout;
+    int m_videoFormat = -1;
+    int m_videoW = 0, m_videoH = 0;
+    GLfloat m_coeffs[4] = { 1.402f, 0.344136f, 0.714136f, 1.772f };
+
+    // ˫壺Ⱦ̻߳ backGUI̶߳ front
+    QOpenGLFramebufferObject* m_fbo[2] = { nullptr, nullptr };
+    int m_backIndex = 0;
+    bool m_frontValid = false;
+    QMutex m_frontMutex;
+
+    mutable QMutex m_statsMutex;
+    RenderStats m_stats;
+    QElapsedTimer m_statsTimer;
+    quint64 m_framesInWindow = 0;
+    double m_maxInWindow = 0.0;
+};
+
+#endif // RENDERTHREAD_H
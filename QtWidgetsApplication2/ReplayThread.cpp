@@ -0,0 +1,149 @@
+#include "replaythread.h"
+#include "threadpolicy.h"
+#include <QDebug>
+
+#define MAX_REPLAY_QUEUE 30     // طʱζеޣ͵ȴ
+
+ReplayThread::ReplayThread(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+    QQueue<AVPacket*>* recordQueue, QMutex* recordMutex, QObject* parent)
+    : DemuxThread(decodeQueue, decodeMutex, recordQueue, recordMutex, parent)
+{
+}
+
+ReplayThread::~ReplayThread()
+{
+    stop();
+    wait();
+    avformat_free_context(m_formatCtx);
+    m_formatCtx = nullptr;
+    m_videoStream = nullptr;
+}
+
+bool ReplayThread::waitForQueues()
+{
+    while (!m_stopped) {
+        int depth;
+        {
+            QMutexLocker locker(&m_outputMutex);
+            depth = qMax(m_decodeEdge.isEnabled() ? m_decodeEdge.size() : 0, m_recordEdge.size());
+        }
+        if (depth < MAX_REPLAY_QUEUE) {
+            return true;
+        }
+        msleep(1);
+    }
+    return false;
+}
+
+void ReplayThread::run()
+{
+    ThreadPolicyScope policyScope(StageDemux);
+    PacketCaptureReader reader;
+    if (!reader.open(m_url)) {
+        emit sigStreamFailed(u8"޷ץļ");
+        return;
+    }
+
+    // ûʽֻһƵ¼̴߳ȡ
+    m_formatCtx = avformat_alloc_context();
+    AVStream* stream = m_formatCtx ? avformat_new_stream(m_formatCtx, nullptr) : nullptr;
+    if (!stream || !reader.fillCodecParameters(stream->codecpar)) {
+        qCritical() << "Replay: could not create stream";
+        avformat_free_context(m_formatCtx);
+        m_formatCtx = nullptr;
+        emit sigStreamFailed(u8"ץļʧܡ");
+        return;
+    }
+    stream->time_base = reader.timeBase();
+    stream->avg_frame_rate = reader.frameRate();
+    stream->r_frame_rate = reader.frameRate();
+    m_videoStreamIndex = stream->index;
+    m_videoStream = stream;
+    m_analyzer.reset(stream->time_base);
+    metricsAdd(m_metrics, &StreamMetrics::streamOpens);
+    emit sigStreamOpened();
+
+    // ѭطʱÿһֵʱ͵ʱ䶼һֺ
+    int64_t tsOffset = 0;
+    int64_t firstDts = AV_NOPTS_VALUE;
+    int64_t lastDts = AV_NOPTS_VALUE;
+    qint64 arrivalOffsetUs = 0;
+    qint64 lastArrivalUs = 0;
+    const AVRational frameRate = reader.frameRate();
+    const int64_t frameStep = frameRate.num > 0 && frameRate.den > 0
+        ? qMax<int64_t>(1, av_rescale_q(1, av_inv_q(frameRate), stream->time_base)) : 1;
+    const qint64 frameStepUs = frameRate.num > 0 && frameRate.den > 0
+        ? av_rescale(1000000, frameRate.den, frameRate.num) : 40000;
+
+    QElapsedTimer clock;
+    clock.start();
+    AVPacket* packet = av_packet_alloc();
+    while (!m_stopped) {
+        qint64 arrivalUs = 0;
+        if (!reader.readPacket(packet, &arrivalUs)) {
+            if (!m_loop || m_replayed == 0 || !reader.rewind()) {
+                break;
+            }
+            if (firstDts != AV_NOPTS_VALUE && lastDts != AV_NOPTS_VALUE) {
+                tsOffset += lastDts - firstDts + frameStep;
+            }
+            arrivalOffsetUs += lastArrivalUs + frameStepUs;
+            lastArrivalUs = 0;
+            firstDts = AV_NOPTS_VALUE;
+            continue;
+        }
+
+        const int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+        if (ts != AV_NOPTS_VALUE) {
+            if (firstDts == AV_NOPTS_VALUE) {
+                firstDts = ts;
+            }
+            lastDts = ts;
+        }
+        lastArrivalUs = arrivalUs;
+        if (packet->pts != AV_NOPTS_VALUE) {
+            packet->pts += tsOffset;
+        }
+        if (packet->dts != AV_NOPTS_VALUE) {
+            packet->dts += tsOffset;
+        }
+        packet->stream_index = m_videoStreamIndex;
+
+        if (m_realtime) {
+            // ֶ˯ߣֹͣʱܼʱ˳
+            const qint64 dueUs = arrivalOffsetUs + arrivalUs;
+            qint64 waitUs;
+            while (!m_stopped && (waitUs = dueUs - clock.nsecsElapsed() / 1000) > 0) {
+                usleep((unsigned long)qMin<qint64>(waitUs, 20000));
+            }
+        }
+        else if (!waitForQueues()) {
+            av_packet_unref(packet);
+            break;
+        }
+        if (m_stopped) {
+            av_packet_unref(packet);
+            break;
+        }
+
+        distributePacket(packet);
+        av_packet_unref(packet);
+        ++m_replayed;
+        m_elapsedMs = clock.elapsed();
+    }
+    av_packet_free(&packet);
+
+    const double seconds = clock.elapsed() / 1000.0;
+    qDebug() << "Replay finished:" << m_replayed << "packets in" << seconds << "s,"
+        << (seconds > 0.0 ? m_replayed / seconds : 0.0) << "packets/s"
+        << (m_realtime ? "(realtime)" : "(as fast as possible)");
+
+    {
+        QMutexLocker locker(&m_outputMutex);
+        m_capture.close();
+    }
+    // һ̶ֱ߳٣طŽԿԿʼ¼
+    if (!m_stopped) {
+        emit sigReplayFinished();
+    }
+}
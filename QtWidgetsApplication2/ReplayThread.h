@@ -0,0 +1,40 @@
+#ifndef REPLAYTHREAD_H
+#define REPLAYTHREAD_H
+
+#include "demuxthread.h"
+
+// ץطţ DemuxThread ץļԭʼʱ䣨򾡿ܿ죩ͽ¼ƶУ
+// 롢ʾ¼ͳƶֱʱһûĻϸֺѹֳ
+class ReplayThread : public DemuxThread
+{
+    Q_OBJECT
+public:
+    ReplayThread(QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+        QQueue<AVPacket*>* recordQueue, QMutex* recordMutex, QObject* parent = nullptr);
+    ~ReplayThread();
+
+    // realtime Ϊ true ʱץʱĵͰͿҲԭ֣
+    // Ϊ false ʱȴֻζлѹʱͣ£ˮߵ
+    void setRealtime(bool realtime) { m_realtime = realtime; }
+    // ļĩβͷʱ
+    void setLoop(bool loop) { m_loop = loop; }
+
+    quint64 packetsReplayed() const { return m_replayed; }
+    double elapsedSeconds() const { return m_elapsedMs / 1000.0; }
+
+signals:
+    void sigReplayFinished();
+
+protected:
+    void run() override;
+
+private:
+    bool waitForQueues();
+
+    std::atomic<bool> m_realtime{ true };
+    std::atomic<bool> m_loop{ false };
+    std::atomic<quint64> m_replayed{ 0 };
+    std::atomic<qint64> m_elapsedMs{ 0 };
+};
+
+#endif // REPLAYTHREAD_H
@@ -0,0 +1,392 @@
+#include "restreamthread.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QtMath>
+
+#define RESTREAM_EDGE_PACKETS 300       // д̸ʱĻѹޣʹһؼ֡¿ʼ
+#define RESTREAM_AVIO_BUFFER (64 * 1024)
+#define RESTREAM_PART_SEGMENTS 2        // ббֶεɷֶдķֶΣ
+
+RestreamThread::RestreamThread(const QString& directory, const RestreamOptions& options, QObject* parent)
+    : PacketSink(StageRecord, RESTREAM_EDGE_PACKETS, EdgeResync, parent), m_directory(directory), m_options(options)
+{
+    m_options.segmentSeconds = qMax(0.5, m_options.segmentSeconds);
+    m_options.partSeconds = qBound(0.05, m_options.partSeconds, m_options.segmentSeconds);
+    m_options.playlistSegments = qMax(3, m_options.playlistSegments);
+    m_input.setWaitKeyframe(true);
+}
+
+RestreamThread::~RestreamThread()
+{
+    stop();
+    wait();
+    closeMuxer();
+    avcodec_parameters_free(&m_codecpar);
+}
+
+bool RestreamThread::setStream(const AVStream* stream)
+{
+    if (!stream) {
+        return false;
+    }
+    avcodec_parameters_free(&m_codecpar);
+    m_codecpar = avcodec_parameters_alloc();
+    if (!m_codecpar || avcodec_parameters_copy(m_codecpar, stream->codecpar) < 0) {
+        return false;
+    }
+    m_timeBase = stream->time_base;
+    return true;
+}
+
+QString RestreamThread::playlistPath() const
+{
+    return m_directory + "/index.m3u8";
+}
+
+RestreamStats RestreamThread::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    RestreamStats stats = m_stats;
+    stats.droppedPackets = m_input.dropped();
+    return stats;
+}
+
+QString RestreamThread::segmentName(int sequence) const
+{
+    return QString("seg%1.m4s").arg(sequence);
+}
+
+QString RestreamThread::partName(int sequence, int part) const
+{
+    return QString("seg%1.part%2.m4s").arg(sequence).arg(part);
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+int RestreamThread::writeCallback(void* opaque, const uint8_t* buf, int size)
+#else
+int RestreamThread::writeCallback(void* opaque, uint8_t* buf, int size)
+#endif
+{
+    // ڴֶп
+    static_cast<RestreamThread*>(opaque)->m_output.append((const char*)buf, size);
+    return size;
+}
+
+bool RestreamThread::writeFile(const QString& name, const QByteArray& data, bool append)
+{
+    QFile file(m_directory + "/" + name);
+    if (!file.open(append ? (QIODevice::WriteOnly | QIODevice::Append) : QIODevice::WriteOnly)) {
+        qWarning() << "Restream: cannot write" << file.fileName();
+        return false;
+    }
+    return file.write(data) == data.size();
+}
+
+void RestreamThread::removeSegmentFiles(const SegmentInfo& segment, bool partsOnly)
+{
+    QDir dir(m_directory);
+    for (int i = 0; i < segment.parts.size(); ++i) {
+        dir.remove(partName(segment.sequence, i));
+    }
+    if (!partsOnly) {
+        dir.remove(segmentName(segment.sequence));
+    }
+}
+
+bool RestreamThread::openMuxer()
+{
+    if (!m_codecpar) {
+        return false;
+    }
+    if (avformat_alloc_output_context2(&m_muxer, nullptr, "mp4", nullptr) < 0) {
+        qWarning() << "Restream: could not create mp4 muxer";
+        return false;
+    }
+
+    AVStream* outStream = avformat_new_stream(m_muxer, nullptr);
+    uint8_t* buffer = (uint8_t*)av_malloc(RESTREAM_AVIO_BUFFER);
+    if (!outStream || !buffer) {
+        av_free(buffer);
+        avformat_free_context(m_muxer);
+        m_muxer = nullptr;
+        return false;
+    }
+    avcodec_parameters_copy(outStream->codecpar, m_codecpar);
+    outStream->codecpar->codec_tag = 0;
+    outStream->time_base = m_timeBase;
+
+    m_muxer->pb = avio_alloc_context(buffer, RESTREAM_AVIO_BUFFER, 1, this, nullptr, &RestreamThread::writeCallback, nullptr);
+    m_muxer->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    // frag_customֻʽˢʱһ moof+mdatֶα߽
+    // empty_moov + default_base_moof + cmafʼβÿƬοԶƴ
+    AVDictionary* options = nullptr;
+    av_dict_set(&options, "movflags", "frag_custom+empty_moov+default_base_moof+cmaf+skip_trailer", 0);
+    const int ret = avformat_write_header(m_muxer, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        qWarning() << "Restream: error writing init segment";
+        releaseMuxer();
+        return false;
+    }
+    avio_flush(m_muxer->pb);
+
+    QDir().mkpath(m_directory);
+    const bool ok = writeFile("init.mp4", m_output, false);
+    m_output.clear();
+    if (!ok) {
+        closeMuxer();
+        return false;
+    }
+    qDebug() << "Restream started to" << playlistPath();
+    return true;
+}
+
+void RestreamThread::closeMuxer()
+{
+    if (!m_muxer) {
+        av_packet_free(&m_pending);
+        return;
+    }
+
+    // ʣµİΪһֶдбǽ
+    if (m_pending) {
+        m_pending->duration = m_lastDuration;
+        writePending();
+    }
+    if (m_partOpen && m_lastEndDts != AV_NOPTS_VALUE) {
+        finishPart(m_lastEndDts);
+    }
+    if (m_segmentOpen) {
+        finishSegment();
+    }
+    if (!m_segments.isEmpty()) {
+        writePlaylist(true);
+    }
+
+    av_write_trailer(m_muxer);
+    releaseMuxer();
+    qDebug() << "Restream stopped:" << m_directory;
+}
+
+void RestreamThread::releaseMuxer()
+{
+    m_output.clear();
+    if (m_muxer->pb) {
+        av_freep(&m_muxer->pb->buffer);
+        avio_context_free(&m_muxer->pb);
+    }
+    avformat_free_context(m_muxer);
+    m_muxer = nullptr;
+}
+
+void RestreamThread::writePending()
+{
+    AVPacket* packet = m_pending;
+    m_pending = nullptr;
+
+    m_lastEndDts = packet->dts + packet->duration;
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= m_firstDts;
+    }
+    packet->dts -= m_firstDts;
+    av_packet_rescale_ts(packet, m_timeBase, m_muxer->streams[0]->time_base);
+    packet->stream_index = 0;
+    packet->pos = -1;
+
+    if (av_write_frame(m_muxer, packet) < 0) {
+        qWarning() << "Restream: error muxing packet";
+    }
+    av_packet_free(&packet);
+}
+
+void RestreamThread::finishPart(int64_t endDts)
+{
+    // ˢ¸дһƬ
+    av_write_frame(m_muxer, nullptr);
+    avio_flush(m_muxer->pb);
+
+    const int index = m_current.parts.size();
+    if (m_options.lowLatency) {
+        writeFile(partName(m_current.sequence, index), m_output, false);
+    }
+    writeFile(segmentName(m_current.sequence), m_output, index > 0);
+
+    const double duration = (endDts - m_partStartDts) * av_q2d(m_timeBase);
+    m_current.parts.append({ duration, m_partIndependent });
+    m_current.duration += duration;
+    m_partOpen = false;
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.parts++;
+    m_stats.bytes += m_output.size();
+    m_output.clear();
+}
+
+void RestreamThread::finishSegment()
+{
+    m_segmentOpen = false;
+    m_maxSegmentDuration = qMax(m_maxSegmentDuration, m_current.duration);
+    m_segments.append(m_current);
+
+    // ֶֶֻУֶֻ
+    if (m_options.lowLatency && m_segments.size() > RESTREAM_PART_SEGMENTS) {
+        removeSegmentFiles(m_segments.at(m_segments.size() - RESTREAM_PART_SEGMENTS - 1), true);
+    }
+    while (m_segments.size() > m_options.playlistSegments) {
+        removeSegmentFiles(m_segments.first(), false);
+        m_segments.removeFirst();
+    }
+
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.segments++;
+}
+
+void RestreamThread::writePlaylist(bool ended)
+{
+    // ؼ֡ȷֶʱʱֶθŹؼ֡ߣĿʱȡʵֵ
+    const int targetDuration = qCeil(qMax(m_options.segmentSeconds, m_maxSegmentDuration));
+    const int firstSequence = m_segments.isEmpty() ? m_current.sequence : m_segments.first().sequence;
+
+    auto writeParts = [this](QByteArray& text, const SegmentInfo& segment) {
+        for (int i = 0; i < segment.parts.size(); ++i) {
+            const PartInfo& part = segment.parts.at(i);
+            text += QString("#EXT-X-PART:DURATION=%1,URI=\"%2\"%3\n")
+                .arg(part.duration, 0, 'f', 5)
+                .arg(partName(segment.sequence, i))
+                .arg(part.independent ? ",INDEPENDENT=YES" : "").toUtf8();
+        }
+    };
+
+    QByteArray text;
+    text += "#EXTM3U\n";
+    text += m_options.lowLatency ? "#EXT-X-VERSION:9\n" : "#EXT-X-VERSION:7\n";
+    text += QString("#EXT-X-TARGETDURATION:%1\n").arg(targetDuration).toUtf8();
+    if (m_options.lowLatency) {
+        text += QString("#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%1\n").arg(m_options.partSeconds * 3.0, 0, 'f', 3).toUtf8();
+        text += QString("#EXT-X-PART-INF:PART-TARGET=%1\n").arg(m_options.partSeconds, 0, 'f', 3).toUtf8();
+    }
+    text += QString("#EXT-X-MEDIA-SEQUENCE:%1\n").arg(firstSequence).toUtf8();
+    text += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+
+    for (int i = 0; i < m_segments.size(); ++i) {
+        const SegmentInfo& segment = m_segments.at(i);
+        text += "#EXT-X-PROGRAM-DATE-TIME:" + segment.startTime.toString("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'").toUtf8() + "\n";
+        if (m_options.lowLatency && i >= m_segments.size() - RESTREAM_PART_SEGMENTS) {
+            writeParts(text, segment);
+        }
+        text += QString("#EXTINF:%1,\n%2\n").arg(segment.duration, 0, 'f', 5).arg(segmentName(segment.sequence)).toUtf8();
+    }
+    // дķֶֻгѾɵĲֶ
+    if (m_options.lowLatency && m_segmentOpen && !m_current.parts.isEmpty()) {
+        text += "#EXT-X-PROGRAM-DATE-TIME:" + m_current.startTime.toString("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'").toUtf8() + "\n";
+        writeParts(text, m_current);
+    }
+    if (ended) {
+        text += "#EXT-X-ENDLIST\n";
+    }
+
+    // 滻дһĲб
+    QSaveFile file(playlistPath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(text) != text.size() || !file.commit()) {
+        qWarning() << "Restream: cannot write playlist" << playlistPath();
+    }
+}
+
+void RestreamThread::recordLatency(qint64 endNs, qint64 firstArrivalNs, bool segment)
+{
+    const qint64 doneNs = m_clock.nsecsElapsed();
+    const double partMs = (doneNs - endNs) / 1e6;
+
+    QMutexLocker locker(&m_statsMutex);
+    m_totalPartMs += partMs;
+    m_stats.lastPartMs = partMs;
+    m_stats.avgPartMs = m_stats.parts > 0 ? m_totalPartMs / m_stats.parts : 0.0;
+    m_stats.maxPartMs = qMax(m_stats.maxPartMs, partMs);
+    m_stats.lastAgeMs = (doneNs - firstArrivalNs) / 1e6;
+    if (segment) {
+        m_stats.lastSegmentMs = partMs;
+    }
+}
+
+bool RestreamThread::process(AVPacket* packet)
+{
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    if (packet->dts == AV_NOPTS_VALUE) {
+        packet->dts = packet->pts;
+    }
+    if (packet->dts == AV_NOPTS_VALUE) {
+        return true;
+    }
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+
+    if (!m_muxer) {
+        if (!key) {
+            return true;
+        }
+        if (!openMuxer()) {
+            emit sigRestreamFailed(u8"޷ת");
+            return false;
+        }
+        m_firstDts = packet->dts;
+    }
+
+    // һʱҪ˲֪Ƭһʱ׼ȷ
+    if (m_pending) {
+        const int64_t duration = packet->dts - m_pending->dts;
+        if (duration > 0) {
+            m_lastDuration = duration;
+        }
+        m_pending->duration = m_lastDuration;
+        writePending();
+    }
+
+    // ʼµĲֶΣᳬĿʱڷֶʱ֮Ĺؼ֡ͬʱзֶ
+    if (m_partOpen) {
+        const double tb = av_q2d(m_timeBase);
+        const bool cutSegment = key && (packet->dts - m_segmentStartDts) * tb >= m_options.segmentSeconds;
+        const bool cutPart = m_options.lowLatency
+            && (packet->dts + m_lastDuration - m_partStartDts) * tb > m_options.partSeconds;
+        if (cutSegment || cutPart) {
+            const qint64 firstArrivalNs = m_partFirstArrivalNs;
+            finishPart(packet->dts);
+            if (cutSegment) {
+                finishSegment();
+            }
+            if (m_options.lowLatency || cutSegment) {
+                writePlaylist(false);
+            }
+            recordLatency(nowNs, firstArrivalNs, cutSegment);
+        }
+    }
+
+    if (!m_segmentOpen) {
+        m_segmentOpen = true;
+        m_segmentStartDts = packet->dts;
+        m_current.sequence = m_nextSequence++;
+        m_current.duration = 0.0;
+        m_current.startTime = QDateTime::currentDateTimeUtc();
+        m_current.parts.clear();
+    }
+    if (!m_partOpen) {
+        m_partOpen = true;
+        m_partStartDts = packet->dts;
+        m_partIndependent = key;
+        m_partFirstArrivalNs = nowNs;
+    }
+
+    m_pending = av_packet_alloc();
+    if (m_pending) {
+        av_packet_move_ref(m_pending, packet);
+    }
+    return true;
+}
+
+void RestreamThread::run()
+{
+    m_clock.start();
+    PacketSink::run();
+    closeMuxer();
+}
@@ -0,0 +1,132 @@
+#ifndef RESTREAMTHREAD_H
+#define RESTREAMTHREAD_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+#include "stagegraph.h"
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+//  HLS / LL-HLS תƣ DemuxThread İϣֻ±
+// Ŀ¼еļ
+//   init.mp4              CMAF ʼΣftyp + moov
+//   seg<N>.m4s            ֶΣӹؼ֡ʼɲֶβ
+//   seg<N>.part<M>.m4s    ֶΣmoof + mdatӳģʽдֶֻε
+//   index.m3u8            бÿдһֶΣֶΣ滻һ
+// ⾲̬ļĿ¼в
+struct RestreamOptions
+{
+    double segmentSeconds = 2.0;    // ֶĿʱڴ֮ĵһؼ֡з
+    double partSeconds = 0.333;     // ֶĿʱ
+    int playlistSegments = 6;       // беķֶļᱻɾ
+    bool lowLatency = true;         // رʱֻдֶΣͨ HLS
+};
+
+// ӳ٣
+//   part   ӲֶνһֶεĵһļͲбд
+//   age    ӲֶεһﵽڲбУԼڲֶʱ + part
+struct RestreamStats
+{
+    quint64 segments = 0;
+    quint64 parts = 0;
+    quint64 bytes = 0;
+    quint64 droppedPackets = 0;
+    double lastPartMs = 0.0;
+    double avgPartMs = 0.0;
+    double maxPartMs = 0.0;
+    double lastAgeMs = 0.0;
+    double lastSegmentMs = 0.0;
+};
+
+class RestreamThread : public PacketSink
+{
+    Q_OBJECT
+public:
+    RestreamThread(const QString& directory, const RestreamOptions& options, QObject* parent = nullptr);
+    ~RestreamThread();
+
+    //  start() ǰ
+    bool setStream(const AVStream* stream);
+
+    QString directory() const { return m_directory; }
+    QString playlistPath() const;
+    RestreamStats stats() const;
+
+signals:
+    void sigRestreamFailed(QString error);
+
+protected:
+    void run() override;
+    bool process(AVPacket* packet) override;
+
+private:
+    struct PartInfo
+    {
+        double duration;
+        bool independent;
+    };
+
+    struct SegmentInfo
+    {
+        int sequence;
+        double duration;
+        QDateTime startTime;
+        QList<PartInfo> parts;
+    };
+
+    bool openMuxer();
+    void closeMuxer();
+    void releaseMuxer();
+    void writePending();
+    void finishPart(int64_t endDts);
+    void recordLatency(qint64 endNs, qint64 firstArrivalNs, bool segment);
+    void finishSegment();
+    void writePlaylist(bool ended);
+    bool writeFile(const QString& name, const QByteArray& data, bool append);
+    void removeSegmentFiles(const SegmentInfo& segment, bool partsOnly);
+    QString segmentName(int sequence) const;
+    QString partName(int sequence, int part) const;
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+    static int writeCallback(void* opaque, const uint8_t* buf, int size);
+#else
+    static int writeCallback(void* opaque, uint8_t* buf, int size);
+#endif
+
+    QString m_directory;
+    RestreamOptions m_options;
+    AVCodecParameters* m_codecpar = nullptr;
+    AVRational m_timeBase{ 1, 90000 };
+
+    AVFormatContext* m_muxer = nullptr;
+    QByteArray m_output;        // дֽڣдһֶκȡ
+    AVPacket* m_pending = nullptr;  // һȷʱд
+    int64_t m_firstDts = AV_NOPTS_VALUE;
+    int64_t m_lastDuration = 0;
+    int64_t m_lastEndDts = AV_NOPTS_VALUE;  // дİλãʱ
+
+    bool m_partOpen = false;
+    int64_t m_partStartDts = 0;
+    bool m_partIndependent = false;
+    qint64 m_partFirstArrivalNs = 0;
+    bool m_segmentOpen = false;
+    int64_t m_segmentStartDts = 0;
+    SegmentInfo m_current;
+    QList<SegmentInfo> m_segments;  // ɡڲбеķֶ
+    int m_nextSequence = 0;
+    double m_maxSegmentDuration = 0.0;
+
+    QElapsedTimer m_clock;
+    mutable QMutex m_statsMutex;
+    RestreamStats m_stats;
+    double m_totalPartMs = 0.0;
+};
+
+#endif // RESTREAMTHREAD_H
@@ -1,4 +1,5 @@
 #include "screenshotthread.h"
+#include "threadpolicy.h"
 #include <QDebug>
 #include <QImage>
 
@@ -8,28 +9,34 @@ extern "C" {
 #include "libavutil/imgutils.h" // for av_image_get_buffer_size
 }
 
-ScreenshotThread::ScreenshotThread(AVFrame* frameToSave, const QString& filePath, QObject* parent)
-    : QThread(parent), m_frame(frameToSave), m_filePath(filePath)
+ScreenshotThread::ScreenshotThread(const QString& filePath, QObject* parent)
+    : FrameSink(StageScreenshot, 1, EdgeDropNewest, parent), m_filePath(filePath)
 {
 }
 
 ScreenshotThread::~ScreenshotThread()
 {
-    // ȷ߳ӵеAVFrameͷ
-    if (m_frame) {
-        av_frame_free(&m_frame);
-    }
+    stop();
+    wait();
     qDebug() << "ScreenshotThread destroyed.";
 }
 
 void ScreenshotThread::run()
 {
     qDebug() << "ScreenshotThread started for file:" << m_filePath;
+    FrameSink::run();
+    // ûȵ֡ͱֹͣͷšֹͣҲҪ֪ͨ
+    if (!m_saved) {
+        emit screenshotSaved(m_filePath, false);
+    }
+}
+
+bool ScreenshotThread::process(AVFrame* frame)
+{
     bool success = false;
 
-    if (m_frame && !m_filePath.isEmpty()) 
+    if (!m_filePath.isEmpty()) 
     {
-        AVFrame* frame = m_frame;
         int width = frame->width;
         int height = frame->height;
 
@@ -77,5 +84,7 @@ void ScreenshotThread::run()
         if (rgbFrame) av_frame_free(&rgbFrame);
     }
 
+    m_saved = true;
     emit screenshotSaved(m_filePath, success);
+    return false;   // ֻһ
 }
\ No newline at end of file
@@ -1,29 +1,33 @@
 #ifndef SCREENSHOTTHREAD_H
 #define SCREENSHOTTHREAD_H
 
-#include <QThread>
 #include <QString>
+#include <atomic>
 
-// forward declaration
-struct AVFrame;
+#include "stagegraph.h"
 
-class ScreenshotThread : public QThread
+// ͼǽڽ֡ϵһߣյһ֡ͱ沢
+// ֻһ֡ڼֱ֡Ӷ
+class ScreenshotThread : public FrameSink
 {
     Q_OBJECT
 public:
-    explicit ScreenshotThread(AVFrame* frameToSave, const QString& filePath, QObject* parent = nullptr);
+    explicit ScreenshotThread(const QString& filePath, QObject* parent = nullptr);
     ~ScreenshotThread();
 
+    QString filePath() const { return m_filePath; }
+
 protected:
     void run() override;
+    bool process(AVFrame* frame) override;
 
 signals:
     // ǿԶһźţݳɹļ·
     void screenshotSaved(const QString& filePath, bool success);
 
 private:
-    AVFrame* m_frame;
     QString m_filePath;
+    std::atomic<bool> m_saved{ false };
 };
 
 #endif // SCREENSHOTTHREAD_H
\ No newline at end of file
@@ -0,0 +1,326 @@
+#ifndef STAGEGRAPH_H
+#define STAGEGRAPH_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+#include "threadpolicy.h"
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/frame.h"
+}
+
+// ˮߵĽ׶ͼ׶֮͵Ķ˿ڣˣͱߣ޵ĶУ
+//   OutputPort<T>  һ࣬һ˿ڿԽ
+//   Edge<T>        һ߾һУޡԡءӹؼ֡ʼ
+//   SinkNode<T>    Դߺ̵߳ߣֻʵ process()
+// ֡üģȳ N ʱǰ N-1 ãav_*_clone ֻӻã
+// һֱԭݱӲ
+
+template <typename T> struct MediaTraits;
+
+template <> struct MediaTraits<AVPacket>
+{
+    static AVPacket* ref(const AVPacket* packet) { return av_packet_clone(packet); }
+    static void release(AVPacket* packet) { av_packet_free(&packet); }
+    static bool isKeyframe(const AVPacket* packet) { return (packet->flags & AV_PKT_FLAG_KEY) != 0; }
+};
+
+template <> struct MediaTraits<AVFrame>
+{
+    static AVFrame* ref(const AVFrame* frame) { return av_frame_clone(frame); }
+    static void release(AVFrame* frame) { av_frame_free(&frame); }
+    static bool isKeyframe(const AVFrame* frame) { return frame->key_frame != 0; }
+};
+
+enum EdgeOverflow
+{
+    EdgeDropOldest,     // ͷʺϽ֡Ǳµ
+    EdgeDropNewest,     // ģʺֻҪһ֡ߣͼ
+    EdgeResync,         // նвһؼ֡ʺѹмİỨ
+};
+
+template <typename T>
+class Edge
+{
+public:
+    explicit Edge(int capacity = 0, EdgeOverflow overflow = EdgeDropOldest)
+        : m_queue(&m_ownQueue), m_mutex(&m_ownMutex), m_capacity(capacity), m_overflow(overflow)
+    {
+    }
+    // ֻԼĶУⲿĶйⲿ
+    ~Edge()
+    {
+        while (!m_ownQueue.isEmpty()) {
+            MediaTraits<T>::release(m_ownQueue.dequeue());
+        }
+    }
+
+    // ӵеĶϣ߳԰ԭķʽУnullptr ʾϿ֮Ķ
+    // ʱܵãԼ
+    void bind(QQueue<T*>* queue, QMutex* mutex)
+    {
+        m_queue = queue;
+        m_mutex = mutex;
+    }
+    bool isBound() const { return m_queue != nullptr; }
+    QQueue<T*>* queue() const { return m_queue; }
+    QMutex* mutex() const { return m_mutex; }
+
+    // 0 ʾ
+    void setCapacity(int capacity, EdgeOverflow overflow) { m_capacity = capacity; m_overflow = overflow; }
+    int capacity() const { return m_capacity; }
+
+    // رʱĶ droppedstartAtKeyframe ʱ´Ҫȵؼ֡
+    void setEnabled(bool enabled)
+    {
+        if (enabled && !m_enabled && m_startAtKeyframe) {
+            m_waitKey = true;
+        }
+        m_enabled = enabled;
+    }
+    bool isEnabled() const { return m_enabled; }
+    void setStartAtKeyframe(bool on) { m_startAtKeyframe = on; }
+    void setWaitKeyframe(bool wait) { m_waitKey = wait; }
+
+    // ̵߳ãҪҪ˳ȹؼ֡
+    bool accepts(const T* item)
+    {
+        if (!m_enabled || !m_queue) {
+            return false;
+        }
+        if (m_waitKey) {
+            if (!MediaTraits<T>::isKeyframe(item)) {
+                return false;
+            }
+            m_waitKey = false;
+        }
+        return true;
+    }
+
+    // ȡ item ȨӺȣʱ -1
+    int enqueue(T* item)
+    {
+        QMutexLocker locker(m_mutex);
+        if (m_capacity > 0 && m_queue->size() >= m_capacity) {
+            if (m_overflow == EdgeDropNewest) {
+                MediaTraits<T>::release(item);
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+            }
+            if (m_overflow == EdgeResync) {
+                m_dropped.fetch_add(m_queue->size(), std::memory_order_relaxed);
+                clearLocked();
+                m_waitKey = true;
+                if (!MediaTraits<T>::isKeyframe(item)) {
+                    MediaTraits<T>::release(item);
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return -1;
+                }
+                m_waitKey = false;
+            }
+            else {
+                MediaTraits<T>::release(m_queue->dequeue());
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        m_queue->enqueue(item);
+        m_pushed.fetch_add(1, std::memory_order_relaxed);
+        m_notEmpty.wakeOne();
+        return m_queue->size();
+    }
+
+    // accepts + enqueueҪʱͷ item
+    int push(T* item)
+    {
+        if (!accepts(item)) {
+            MediaTraits<T>::release(item);
+            return -1;
+        }
+        return enqueue(item);
+    }
+
+    // ߣ timeoutMsûݷ nullptr
+    T* pop(unsigned long timeoutMs = 0)
+    {
+        if (!m_queue) {
+            return nullptr;
+        }
+        QMutexLocker locker(m_mutex);
+        if (m_queue->isEmpty() && timeoutMs > 0) {
+            m_notEmpty.wait(m_mutex, timeoutMs);
+        }
+        return m_queue->isEmpty() ? nullptr : m_queue->dequeue();
+    }
+
+    int size() const
+    {
+        if (!m_queue) {
+            return 0;
+        }
+        QMutexLocker locker(m_mutex);
+        return m_queue->size();
+    }
+
+    void clear()
+    {
+        if (!m_queue) {
+            return;
+        }
+        QMutexLocker locker(m_mutex);
+        clearLocked();
+    }
+
+    // ѵ pop ϵߣֹͣʱã
+    void wake() { m_notEmpty.wakeAll(); }
+
+    quint64 pushed() const { return m_pushed.load(std::memory_order_relaxed); }
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void clearLocked()
+    {
+        while (!m_queue->isEmpty()) {
+            MediaTraits<T>::release(m_queue->dequeue());
+        }
+    }
+
+    QQueue<T*> m_ownQueue;
+    QMutex m_ownMutex;
+    QQueue<T*>* m_queue;
+    QMutex* m_mutex;
+    QWaitCondition m_notEmpty;
+    int m_capacity;
+    EdgeOverflow m_overflow;
+    std::atomic<bool> m_enabled{ true };
+    std::atomic<bool> m_startAtKeyframe{ true };
+    std::atomic<bool> m_waitKey{ false };
+    std::atomic<quint64> m_pushed{ 0 };
+    std::atomic<quint64> m_dropped{ 0 };
+
+    Q_DISABLE_COPY(Edge)
+};
+
+template <typename T>
+class OutputPort
+{
+public:
+    // ɵ߳УϿ֮ǰ
+    void connect(Edge<T>* edge)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_edges.contains(edge)) {
+            m_edges.append(edge);
+        }
+        m_connected = m_edges.size();
+    }
+
+    void disconnect(Edge<T>* edge)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_edges.removeAll(edge);
+        m_connected = m_edges.size();
+    }
+
+    // ûбʱ߿׼ݣð֡ڴ棩
+    bool isConnected() const { return m_connected > 0; }
+
+    // ȡ item ȨָҪıߣյı
+    int push(T* item)
+    {
+        QMutexLocker locker(&m_mutex);
+        Edge<T>* targets[MAX_EDGES];
+        int count = 0;
+        for (Edge<T>* edge : m_edges) {
+            if (count < MAX_EDGES && edge->accepts(item)) {
+                targets[count++] = edge;
+            }
+        }
+        if (count == 0) {
+            MediaTraits<T>::release(item);
+            return 0;
+        }
+        for (int i = 0; i < count - 1; ++i) {
+            T* ref = MediaTraits<T>::ref(item);
+            if (ref) {
+                targets[i]->enqueue(ref);
+            }
+        }
+        targets[count - 1]->enqueue(item);
+        return count;
+    }
+
+private:
+    enum { MAX_EDGES = 16 };
+    QMutex m_mutex;
+    QVector<Edge<T>*> m_edges;
+    std::atomic<int> m_connected{ 0 };
+};
+
+// Դߺ̵߳ߣprocess() ж󣬷غɻͷţ false ʱ߳̽
+template <typename T>
+class SinkNode : public QThread
+{
+public:
+    explicit SinkNode(PipelineStage stage, int capacity, EdgeOverflow overflow, QObject* parent = nullptr)
+        : QThread(parent), m_input(capacity, overflow), m_stage(stage)
+    {
+    }
+    ~SinkNode()
+    {
+        stop();
+        wait();
+    }
+
+    Edge<T>* input() { return &m_input; }
+
+    void stop()
+    {
+        m_stopped = true;
+        m_input.wake();
+    }
+
+protected:
+    virtual bool process(T* item) = 0;
+    // 100ms ûʱãѶϿҪβ
+    virtual void idle() {}
+
+    void run() override
+    {
+        ThreadPolicyScope policyScope(m_stage);
+        while (!m_stopped) {
+            T* item = m_input.pop(100);
+            if (!item) {
+                idle();
+                continue;
+            }
+            const bool more = process(item);
+            MediaTraits<T>::release(item);
+            if (!more) {
+                break;
+            }
+        }
+        m_input.clear();
+    }
+
+    Edge<T> m_input;
+    std::atomic<bool> m_stopped{ false };
+
+private:
+    PipelineStage m_stage;
+};
+
+typedef Edge<AVPacket> PacketEdge;
+typedef Edge<AVFrame> FrameEdge;
+typedef OutputPort<AVPacket> PacketPort;
+typedef OutputPort<AVFrame> FramePort;
+typedef SinkNode<AVPacket> PacketSink;
+typedef SinkNode<AVFrame> FrameSink;
+
+#endif // STAGEGRAPH_H
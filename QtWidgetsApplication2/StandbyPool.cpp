@@ -0,0 +1,173 @@
+#include "standbypool.h"
+#include "demuxthread.h"
+#include <QDateTime>
+#include <QTimer>
+#include <QDebug>
+
+#define STANDBY_RETRY_MS 5000
+
+StandbyPool::StandbyPool(int capacity, QObject* parent)
+    : QObject(parent), m_capacity(qMax(0, capacity))
+{
+}
+
+StandbyPool::~StandbyPool()
+{
+    clear();
+}
+
+void StandbyPool::setCapacity(int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    evict();
+}
+
+int StandbyPool::indexOf(const QString& url) const
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).url == url) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool StandbyPool::contains(const QString& url) const
+{
+    return indexOf(url) >= 0;
+}
+
+bool StandbyPool::isReady(const QString& url) const
+{
+    const int i = indexOf(url);
+    return i >= 0 && m_entries.at(i).demux->isOpened() && m_entries.at(i).demux->cachedGopPackets() > 0;
+}
+
+QStringList StandbyPool::urls() const
+{
+    QStringList list;
+    for (const Entry& entry : m_entries) {
+        list << entry.url;
+    }
+    return list;
+}
+
+void StandbyPool::warm(const QString& url)
+{
+    const int i = indexOf(url);
+    if (i >= 0) {
+        m_entries[i].lastUsedMs = QDateTime::currentMSecsSinceEpoch();
+        return;
+    }
+    if (m_capacity <= 0) {
+        return;
+    }
+
+    DemuxThread* demux = new DemuxThread(nullptr, nullptr, nullptr, nullptr);
+    demux->detachOutputs();
+    connect(demux, &DemuxThread::sigStreamFailed, this, &StandbyPool::onStandbyFailed, Qt::QueuedConnection);
+    demux->start(url);
+    add(url, demux);
+    qDebug() << "Standby: warming" << url;
+}
+
+void StandbyPool::add(const QString& url, DemuxThread* demux)
+{
+    Entry entry;
+    entry.url = url;
+    entry.demux = demux;
+    entry.lastUsedMs = QDateTime::currentMSecsSinceEpoch();
+    m_entries.append(entry);
+    evict();
+}
+
+void StandbyPool::evict()
+{
+    while (m_entries.size() > m_capacity) {
+        int oldest = 0;
+        for (int i = 1; i < m_entries.size(); ++i) {
+            if (m_entries.at(i).lastUsedMs < m_entries.at(oldest).lastUsedMs) {
+                oldest = i;
+            }
+        }
+        qDebug() << "Standby: evicting" << m_entries.at(oldest).url;
+        destroy(m_entries.takeAt(oldest).demux);
+    }
+}
+
+void StandbyPool::remove(const QString& url)
+{
+    const int i = indexOf(url);
+    if (i >= 0) {
+        destroy(m_entries.takeAt(i).demux);
+    }
+}
+
+void StandbyPool::clear()
+{
+    // ȫֹ֪ͨͣȴرն·ʱôеȳʱ
+    for (const Entry& entry : m_entries) {
+        entry.demux->stop();
+    }
+    while (!m_entries.isEmpty()) {
+        destroy(m_entries.takeLast().demux);
+    }
+}
+
+void StandbyPool::destroy(DemuxThread* demux)
+{
+    demux->stop();
+    demux->wait();
+    delete demux;
+}
+
+DemuxThread* StandbyPool::take(const QString& url)
+{
+    const int i = indexOf(url);
+    if (i < 0) {
+        return nullptr;
+    }
+    Entry entry = m_entries.takeAt(i);
+    if (!entry.demux->isOpened()) {
+        // ûϣѶϿòԼ
+        destroy(entry.demux);
+        return nullptr;
+    }
+    disconnect(entry.demux, nullptr, this, nullptr);
+    return entry.demux;
+}
+
+void StandbyPool::giveBack(const QString& url, DemuxThread* demux)
+{
+    if (!demux) {
+        return;
+    }
+    if (m_capacity <= 0 || contains(url) || !demux->isOpened()) {
+        destroy(demux);
+        return;
+    }
+
+    disconnect(demux, nullptr, nullptr, nullptr);
+    demux->setParent(nullptr);
+    demux->detachOutputs();
+    connect(demux, &DemuxThread::sigStreamFailed, this, &StandbyPool::onStandbyFailed, Qt::QueuedConnection);
+    add(url, demux);
+}
+
+void StandbyPool::onStandbyFailed(QString error)
+{
+    // Ŷӵźŵʱ߿ѱ evict/take/remove ٣ַֻȽϣܽ
+    const QObject* source = sender();
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (static_cast<const QObject*>(m_entries.at(i).demux) != source) {
+            continue;
+        }
+        const QString url = m_entries.at(i).url;
+        qWarning() << "Standby connection lost:" << url << error;
+        destroy(m_entries.takeAt(i).demux);
+
+        // һԤ
+        QTimer::singleShot(STANDBY_RETRY_MS, this, [this, url]() { warm(url); });
+        break;
+    }
+}
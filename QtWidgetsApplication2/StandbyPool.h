@@ -0,0 +1,58 @@
+#ifndef STANDBYPOOL_H
+#define STANDBYPOOL_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+class DemuxThread;
+
+// Ԥӳأýеļ·Ӳ⸴ãֻһGOP
+// RTSPPlayer::startPlay ʱֱӽӹѴ򿪵ӣʡ RTSP ֡Ϣ̽͵ȹؼ֡ʱ䣻
+// ֹͣʱӽӣлͬܿ
+class StandbyPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StandbyPool(int capacity = 4, QObject* parent = nullptr);
+    ~StandbyPool();
+
+    // ʱ̭ûù
+    void setCapacity(int capacity);
+    int capacity() const { return m_capacity; }
+
+    void warm(const QString& url);
+    void remove(const QString& url);
+    void clear();
+    bool contains(const QString& url) const;
+    // ϲ˹ؼ֡ӹܺ̽
+    bool isReady(const QString& url) const;
+    QStringList urls() const;
+
+    // ȡԤӺõĽ⸴̣߳߸֮ڣûпӷ nullptr
+    DemuxThread* take(const QString& url);
+    // ֹͣʱӣ̱߳Уʱֱӹر
+    void giveBack(const QString& url, DemuxThread* demux);
+
+private slots:
+    void onStandbyFailed(QString error);
+
+private:
+    struct Entry
+    {
+        QString url;
+        DemuxThread* demux = nullptr;
+        qint64 lastUsedMs = 0;
+    };
+
+    int indexOf(const QString& url) const;
+    void add(const QString& url, DemuxThread* demux);
+    void evict();
+    static void destroy(DemuxThread* demux);
+
+    QList<Entry> m_entries;
+    int m_capacity;
+};
+
+#endif // STANDBYPOOL_H
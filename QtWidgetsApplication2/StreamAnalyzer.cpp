@@ -0,0 +1,312 @@
+#include "streamanalyzer.h"
+#include <QtGlobal>
+#include <cmath>
+
+extern "C" {
+#include "libavutil/mathematics.h"
+}
+
+#define ANALYZER_CHECK_INTERVAL_US 1000000
+#define ANALYZER_MIN_JUMP_US 1000000     // ֡Ʋ׼ʱDTS 䳬 1 㲻
+
+StreamAnalyzer::StreamAnalyzer()
+{
+    m_clock.start();
+}
+
+void StreamAnalyzer::reset(AVRational timeBase)
+{
+    m_timeBase = timeBase;
+    // λŲ㣬ȡ˰ʱ˵һ·
+    m_startUs = nowUs();
+    m_totalBytes = 0;
+    m_discontinuities = 0;
+    m_ptsDtsErrors = 0;
+    m_lastKeyframeBytes = 0;
+
+    m_prevArrivalUs = -1;
+    m_prevDtsUs = AV_NOPTS_VALUE;
+    m_frameDurationUs = 0;
+    m_jitterUs = 0.0;
+    m_framesInGop = 0;
+    m_gopStartDtsUs = AV_NOPTS_VALUE;
+    m_gopKeyBytes = 0;
+    m_seenKeyframe = false;
+    m_lastCheckUs = m_startUs;
+    m_checkedDiscontinuities = 0;
+    m_activeAlerts = 0;
+}
+
+void StreamAnalyzer::addPacket(const AVPacket* packet)
+{
+    const qint64 arrivalUs = nowUs();
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    const int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    const qint64 dtsUs = ts != AV_NOPTS_VALUE ? av_rescale_q(ts, m_timeBase, AVRational{ 1, 1000000 }) : AV_NOPTS_VALUE;
+
+    if (packet->pts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE && packet->pts < packet->dts) {
+        m_ptsDtsErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // ʱ֮ƽֵRFC 3550 㷨
+    bool discontinuity = false;
+    if (dtsUs != AV_NOPTS_VALUE && m_prevDtsUs != AV_NOPTS_VALUE) {
+        const qint64 dtsDelta = dtsUs - m_prevDtsUs;
+        const qint64 jumpLimit = qMax<qint64>(ANALYZER_MIN_JUMP_US, m_frameDurationUs * 10);
+        if (dtsDelta <= 0 || dtsDelta > jumpLimit) {
+            discontinuity = true;
+            m_discontinuities.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            m_frameDurationUs = m_frameDurationUs > 0 ? (m_frameDurationUs * 7 + dtsDelta) / 8 : dtsDelta;
+            const double d = double((arrivalUs - m_prevArrivalUs) - dtsDelta);
+            m_jitterUs += (std::fabs(d) - m_jitterUs) / 16.0;
+        }
+    }
+    if (dtsUs != AV_NOPTS_VALUE) {
+        m_prevDtsUs = dtsUs;
+        m_prevArrivalUs = arrivalUs;
+    }
+
+    // GOPһؼ֡ʱ¼һGOP
+    if (key) {
+        if (m_seenKeyframe) {
+            const quint64 index = m_gopCount.load(std::memory_order_relaxed);
+            GopSlot& slot = m_gops[index % ANALYZER_GOP_SLOTS];
+            slot.seq.store(index * 2 + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.arrivalUs.store(arrivalUs, std::memory_order_relaxed);
+            slot.frames.store(m_framesInGop, std::memory_order_relaxed);
+            slot.durationUs.store(discontinuity || dtsUs == AV_NOPTS_VALUE || m_gopStartDtsUs == AV_NOPTS_VALUE
+                ? 0 : dtsUs - m_gopStartDtsUs, std::memory_order_relaxed);
+            slot.keyframeBytes.store(m_gopKeyBytes, std::memory_order_relaxed);
+            slot.seq.store(index * 2 + 2, std::memory_order_release);
+            m_gopCount.store(index + 1, std::memory_order_release);
+        }
+        m_seenKeyframe = true;
+        m_framesInGop = 0;
+        m_gopStartDtsUs = dtsUs;
+        m_gopKeyBytes = packet->size;
+        m_lastKeyframeBytes = packet->size;
+    }
+    ++m_framesInGop;
+
+    const quint64 index = m_packetCount.load(std::memory_order_relaxed);
+    PacketSlot& slot = m_packets[index % ANALYZER_PACKET_SLOTS];
+    slot.seq.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.arrivalUs.store(arrivalUs, std::memory_order_relaxed);
+    slot.bytes.store(packet->size, std::memory_order_relaxed);
+    slot.jitterUs.store(qint64(m_jitterUs), std::memory_order_relaxed);
+    slot.seq.store(index * 2 + 2, std::memory_order_release);
+    m_packetCount.store(index + 1, std::memory_order_release);
+
+    m_totalBytes.fetch_add(packet->size, std::memory_order_relaxed);
+}
+
+StreamAnalysis StreamAnalyzer::analysis(double windowSec) const
+{
+    StreamAnalysis result;
+    const qint64 now = nowUs();
+    const qint64 startUs = m_startUs;
+    const qint64 windowUs = qint64(qMax(0.1, windowSec) * 1000000);
+    const qint64 fromUs = qMax(startUs, now - windowUs);
+    const qint64 instantFromUs = qMax(startUs, now - 1000000);
+
+    result.windowSec = (now - fromUs) / 1000000.0;
+    result.discontinuities = m_discontinuities;
+    result.ptsDtsErrors = m_ptsDtsErrors;
+    result.lastKeyframeBytes = m_lastKeyframeBytes;
+    if (now > startUs) {
+        result.totalBitrateKbps = m_totalBytes * 8.0 / ((now - startUs) / 1000.0);
+    }
+
+    // µİضڡǵĲۻһ·ݾֹͣ
+    qint64 bytes = 0;
+    qint64 instantBytes = 0;
+    qint64 newestUs = -1;
+    qint64 laterUs = -1;
+    qint64 gapSumUs = 0;
+    int gaps = 0;
+    const quint64 count = m_packetCount.load(std::memory_order_acquire);
+    const quint64 oldest = count > ANALYZER_PACKET_SLOTS ? count - ANALYZER_PACKET_SLOTS : 0;
+    for (quint64 i = count; i > oldest; --i) {
+        const quint64 index = i - 1;
+        const PacketSlot& slot = m_packets[index % ANALYZER_PACKET_SLOTS];
+        const quint64 seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != index * 2 + 2) {
+            break;
+        }
+        const qint64 arrivalUs = slot.arrivalUs.load(std::memory_order_relaxed);
+        const qint64 size = slot.bytes.load(std::memory_order_relaxed);
+        const qint64 jitterUs = slot.jitterUs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq || arrivalUs < fromUs) {
+            break;
+        }
+
+        if (newestUs < 0) {
+            newestUs = arrivalUs;
+            result.jitterMs = jitterUs / 1000.0;
+        }
+        if (laterUs >= 0) {
+            const qint64 gapUs = laterUs - arrivalUs;
+            gapSumUs += gapUs;
+            ++gaps;
+            result.maxInterArrivalMs = qMax(result.maxInterArrivalMs, gapUs / 1000.0);
+        }
+        laterUs = arrivalUs;
+        result.maxJitterMs = qMax(result.maxJitterMs, jitterUs / 1000.0);
+        bytes += size;
+        if (arrivalUs >= instantFromUs) {
+            instantBytes += size;
+        }
+        ++result.packets;
+    }
+
+    if (newestUs >= 0) {
+        result.sinceLastPacketMs = (now - newestUs) / 1000.0;
+    }
+    else if (now > startUs) {
+        result.sinceLastPacketMs = (now - startUs) / 1000.0;
+    }
+    // סʱڵȴμҲȥ
+    result.maxInterArrivalMs = qMax(result.maxInterArrivalMs, result.sinceLastPacketMs);
+    if (gaps > 0) {
+        result.meanInterArrivalMs = gapSumUs / 1000.0 / gaps;
+    }
+    if (now > fromUs) {
+        result.bitrateKbps = bytes * 8.0 / ((now - fromUs) / 1000.0);
+    }
+    if (now > instantFromUs) {
+        result.instantBitrateKbps = instantBytes * 8.0 / ((now - instantFromUs) / 1000.0);
+    }
+
+    // GOPڽGOPȡƽ̫ʱȡһ
+    qint64 gopFrames = 0;
+    qint64 gopDurationUs = 0;
+    qint64 keyBytes = 0;
+    int gops = 0;
+    int timedGops = 0;
+    const quint64 gopCount = m_gopCount.load(std::memory_order_acquire);
+    const quint64 gopOldest = gopCount > ANALYZER_GOP_SLOTS ? gopCount - ANALYZER_GOP_SLOTS : 0;
+    for (quint64 i = gopCount; i > gopOldest; --i) {
+        const quint64 index = i - 1;
+        const GopSlot& slot = m_gops[index % ANALYZER_GOP_SLOTS];
+        const quint64 seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != index * 2 + 2) {
+            break;
+        }
+        const qint64 arrivalUs = slot.arrivalUs.load(std::memory_order_relaxed);
+        const qint64 frames = slot.frames.load(std::memory_order_relaxed);
+        const qint64 durationUs = slot.durationUs.load(std::memory_order_relaxed);
+        const qint64 bytesKey = slot.keyframeBytes.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq || arrivalUs < startUs
+            || (gops > 0 && arrivalUs < fromUs)) {
+            break;
+        }
+
+        if (gops == 0) {
+            result.lastGopFrames = int(frames);
+        }
+        gopFrames += frames;
+        keyBytes += bytesKey;
+        if (durationUs > 0) {
+            gopDurationUs += durationUs;
+            ++timedGops;
+        }
+        ++gops;
+    }
+    if (gops > 0) {
+        result.gopFrames = double(gopFrames) / gops;
+        result.keyframeBytes = double(keyBytes) / gops;
+    }
+    if (timedGops > 0) {
+        result.gopSeconds = gopDurationUs / 1000000.0 / timedGops;
+    }
+    return result;
+}
+
+void StreamAnalyzer::setThresholds(const StreamThresholds& thresholds)
+{
+    QMutexLocker locker(&m_thresholdMutex);
+    m_thresholds = thresholds;
+}
+
+StreamThresholds StreamAnalyzer::thresholds() const
+{
+    QMutexLocker locker(&m_thresholdMutex);
+    return m_thresholds;
+}
+
+quint32 StreamAnalyzer::checkThresholds(StreamAnalysis* analysis)
+{
+    const qint64 now = nowUs();
+    if (now - m_lastCheckUs < ANALYZER_CHECK_INTERVAL_US) {
+        return 0;
+    }
+    m_lastCheckUs = now;
+
+    const StreamThresholds limits = thresholds();
+    *analysis = this->analysis(limits.windowSec);
+
+    quint32 active = 0;
+    if (limits.maxJitterMs > 0 && analysis->jitterMs > limits.maxJitterMs) {
+        active |= StreamAlertJitter;
+    }
+    // մʱڻûƫ
+    if (limits.minBitrateKbps > 0 && analysis->windowSec >= limits.windowSec * 0.9
+        && analysis->bitrateKbps < limits.minBitrateKbps) {
+        active |= StreamAlertBitrate;
+    }
+    if (limits.maxInterArrivalMs > 0 && analysis->maxInterArrivalMs > limits.maxInterArrivalMs) {
+        active |= StreamAlertArrivalGap;
+    }
+    if (limits.maxGopFrames > 0 && analysis->lastGopFrames > limits.maxGopFrames) {
+        active |= StreamAlertGopLength;
+    }
+    // ˲ʱ¼һڳֹλһμʱûµľ
+    if (limits.discontinuity && analysis->discontinuities > m_checkedDiscontinuities) {
+        active |= StreamAlertDiscontinuity;
+    }
+    m_checkedDiscontinuities = analysis->discontinuities;
+
+    const quint32 changed = active ^ m_activeAlerts;
+    m_activeAlerts = active;
+    return changed;
+}
+
+double StreamAnalyzer::alertValue(const StreamAnalysis& analysis, StreamAlert alert)
+{
+    switch (alert) {
+    case StreamAlertJitter:
+        return analysis.jitterMs;
+    case StreamAlertBitrate:
+        return analysis.bitrateKbps;
+    case StreamAlertArrivalGap:
+        return analysis.maxInterArrivalMs;
+    case StreamAlertGopLength:
+        return analysis.lastGopFrames;
+    case StreamAlertDiscontinuity:
+        return double(analysis.discontinuities);
+    }
+    return 0.0;
+}
+
+const char* StreamAnalyzer::alertName(StreamAlert alert)
+{
+    switch (alert) {
+    case StreamAlertJitter:
+        return "jitter";
+    case StreamAlertBitrate:
+        return "bitrate";
+    case StreamAlertArrivalGap:
+        return "arrival gap";
+    case StreamAlertGopLength:
+        return "gop length";
+    case StreamAlertDiscontinuity:
+        return "discontinuity";
+    }
+    return "unknown";
+}
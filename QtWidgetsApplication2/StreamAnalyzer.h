@@ -0,0 +1,137 @@
+#ifndef STREAMANALYZER_H
+#define STREAMANALYZER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <atomic>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/rational.h"
+}
+
+#define ANALYZER_PACKET_SLOTS 1024   // 30fps Լ 34 
+#define ANALYZER_GOP_SLOTS 64
+
+// Ⱪ¶ͳƣanalysis ʱʱ䴰ڼ㣩
+struct StreamAnalysis
+{
+    double windowSec = 0.0;
+    int packets = 0;
+
+    double bitrateKbps = 0.0;          // ƽ
+    double instantBitrateKbps = 0.0;   //  1 
+    double totalBitrateKbps = 0.0;     // Ӵʼƽ
+
+    double jitterMs = 0.0;             // ﶶRFC 3550 ƽֵһ
+    double maxJitterMs = 0.0;          // ڶֵ
+    double meanInterArrivalMs = 0.0;
+    double maxInterArrivalMs = 0.0;
+    double sinceLastPacketMs = 0.0;    // һʱ䣬סʱ
+
+    double gopFrames = 0.0;            // ƽGOPȣ֡
+    double gopSeconds = 0.0;
+    int lastGopFrames = 0;
+    double keyframeBytes = 0.0;        // ƽؼ֡С
+    int lastKeyframeBytes = 0;
+
+    quint64 discontinuities = 0;       // DTS ˻䣨ۼƣ
+    quint64 ptsDtsErrors = 0;          // PTS  DTSۼƣ
+};
+
+// 澯ͣɰλ
+enum StreamAlert
+{
+    StreamAlertJitter = 0x01,
+    StreamAlertBitrate = 0x02,
+    StreamAlertArrivalGap = 0x04,
+    StreamAlertGopLength = 0x08,
+    StreamAlertDiscontinuity = 0x10,
+};
+
+// 澯ֵ0 ʾ
+struct StreamThresholds
+{
+    double maxJitterMs = 0.0;
+    double minBitrateKbps = 0.0;
+    double maxInterArrivalMs = 0.0;
+    int maxGopFrames = 0;
+    bool discontinuity = false;
+    double windowSec = 5.0;     // ʱʹõͳƴ
+};
+
+// ⸴߳ÿƵ¼ʱ䡢DTSСͶÿGOP¼Ⱥ͹ؼ֡С
+// λ壬ֻж߳д룻ÿ۴ţseqlock߳ȡ
+// ڱǵĲ۾ֹͣд˲ȴȡ
+class StreamAnalyzer
+{
+public:
+    StreamAnalyzer();
+
+    // ʱạ̃߳
+    void reset(AVRational timeBase);
+    // ÿƵһΣ̣߳
+    void addPacket(const AVPacket* packet);
+
+    // ̣߳ windowSec ͳƣܻλƣ
+    StreamAnalysis analysis(double windowSec = 5.0) const;
+
+    void setThresholds(const StreamThresholds& thresholds);
+    StreamThresholds thresholds() const;
+    // ̣߳ÿһֵ״̬仯ĸ澯λ*analysis Ϊʱͳ
+    quint32 checkThresholds(StreamAnalysis* analysis);
+    quint32 activeAlerts() const { return m_activeAlerts; }
+    static double alertValue(const StreamAnalysis& analysis, StreamAlert alert);
+    static const char* alertName(StreamAlert alert);
+
+private:
+    struct PacketSlot
+    {
+        std::atomic<quint64> seq{ 0 };
+        std::atomic<qint64> arrivalUs{ 0 };
+        std::atomic<qint64> bytes{ 0 };
+        std::atomic<qint64> jitterUs{ 0 };
+    };
+    struct GopSlot
+    {
+        std::atomic<quint64> seq{ 0 };
+        std::atomic<qint64> arrivalUs{ 0 };     // GOP һؼ֡ʱ
+        std::atomic<qint64> frames{ 0 };
+        std::atomic<qint64> durationUs{ 0 };
+        std::atomic<qint64> keyframeBytes{ 0 };
+    };
+
+    qint64 nowUs() const { return m_clock.nsecsElapsed() / 1000; }
+
+    QElapsedTimer m_clock;   // ֻڹʱֻ֮߳
+    AVRational m_timeBase{ 1, 90000 };
+
+    PacketSlot m_packets[ANALYZER_PACKET_SLOTS];
+    std::atomic<quint64> m_packetCount{ 0 };
+    GopSlot m_gops[ANALYZER_GOP_SLOTS];
+    std::atomic<quint64> m_gopCount{ 0 };
+
+    std::atomic<qint64> m_startUs{ 0 };
+    std::atomic<quint64> m_totalBytes{ 0 };
+    std::atomic<quint64> m_discontinuities{ 0 };
+    std::atomic<quint64> m_ptsDtsErrors{ 0 };
+    std::atomic<int> m_lastKeyframeBytes{ 0 };
+
+    // ֻж̷߳
+    qint64 m_prevArrivalUs = -1;
+    qint64 m_prevDtsUs = AV_NOPTS_VALUE;
+    qint64 m_frameDurationUs = 0;   // ƽ֡жʱ
+    double m_jitterUs = 0.0;
+    qint64 m_framesInGop = 0;
+    qint64 m_gopStartDtsUs = AV_NOPTS_VALUE;
+    int m_gopKeyBytes = 0;
+    bool m_seenKeyframe = false;
+
+    mutable QMutex m_thresholdMutex;
+    StreamThresholds m_thresholds;
+    qint64 m_lastCheckUs = 0;
+    quint64 m_checkedDiscontinuities = 0;
+    std::atomic<quint32> m_activeAlerts{ 0 };
+};
+
+#endif // STREAMANALYZER_H
@@ -0,0 +1,291 @@
+#include "threadpolicy.h"
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+static QMutex s_policyMutex;
+static StagePolicy s_policies[StageCount];
+static QMap<int, ThreadPlacement> s_placements;
+static int s_nextId = 1;
+
+static const char* s_stageNames[StageCount] = { "demux", "decode", "record", "screenshot", "render", "proxy" };
+
+void ThreadPolicy::setPolicy(PipelineStage stage, const StagePolicy& policy)
+{
+    QMutexLocker locker(&s_policyMutex);
+    s_policies[stage] = policy;
+}
+
+StagePolicy ThreadPolicy::policy(PipelineStage stage)
+{
+    QMutexLocker locker(&s_policyMutex);
+    return s_policies[stage];
+}
+
+void ThreadPolicy::clear()
+{
+    QMutexLocker locker(&s_policyMutex);
+    for (int i = 0; i < StageCount; ++i) {
+        s_policies[i] = StagePolicy();
+    }
+}
+
+const char* ThreadPolicy::stageName(PipelineStage stage)
+{
+    return stage >= 0 && stage < StageCount ? s_stageNames[stage] : "unknown";
+}
+
+bool ThreadPolicy::stageFromName(const QString& name, PipelineStage* stage)
+{
+    for (int i = 0; i < StageCount; ++i) {
+        if (name == QLatin1String(s_stageNames[i])) {
+            *stage = PipelineStage(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<int> ThreadPolicy::parseCpuList(const QString& text)
+{
+    QVector<int> cpus;
+    for (const QString& part : text.split(',', QString::SkipEmptyParts)) {
+        const QStringList range = part.trimmed().split('-');
+        bool ok1 = false;
+        bool ok2 = false;
+        const int first = range.value(0).toInt(&ok1);
+        const int last = range.size() > 1 ? range.value(1).toInt(&ok2) : first;
+        if (!ok1 || (range.size() > 1 && !ok2) || first < 0 || last < first) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            if (!cpus.contains(cpu)) {
+                cpus.append(cpu);
+            }
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+QString ThreadPolicy::formatCpuList(const QVector<int>& cpus)
+{
+    if (cpus.isEmpty()) {
+        return "-";
+    }
+    QStringList parts;
+    int start = cpus[0];
+    int prev = cpus[0];
+    for (int i = 1; i <= cpus.size(); ++i) {
+        if (i < cpus.size() && cpus[i] == prev + 1) {
+            prev = cpus[i];
+            continue;
+        }
+        parts << (start == prev ? QString::number(start) : QString("%1-%2").arg(start).arg(prev));
+        if (i < cpus.size()) {
+            start = prev = cpus[i];
+        }
+    }
+    return parts.join(',');
+}
+
+// ׶ʵʹõCPUָ˾ָģܿ׶ζռĺ
+static QVector<int> effectiveCpus(PipelineStage stage)
+{
+    const StagePolicy& own = s_policies[stage];
+    if (!own.cpus.isEmpty()) {
+        return own.cpus;
+    }
+
+    QVector<int> reserved;
+    for (int i = 0; i < StageCount; ++i) {
+        if (s_policies[i].exclusive) {
+            reserved += s_policies[i].cpus;
+        }
+    }
+    if (reserved.isEmpty()) {
+        return QVector<int>();
+    }
+    QVector<int> cpus;
+    const int count = QThread::idealThreadCount();
+    for (int cpu = 0; cpu < count; ++cpu) {
+        if (!reserved.contains(cpu)) {
+            cpus.append(cpu);
+        }
+    }
+    return cpus;    // ȫռʱΪգ
+}
+
+int ThreadPolicy::applyToCurrentThread(PipelineStage stage)
+{
+    QMutexLocker locker(&s_policyMutex);
+    const StagePolicy policy = s_policies[stage];
+    const QVector<int> cpus = effectiveCpus(stage);
+
+    ThreadPlacement placement;
+    placement.stage = stage;
+    QStringList errors;
+    bool affinityOk = true;
+
+#if defined(Q_OS_LINUX)
+    placement.tid = (qint64)syscall(SYS_gettid);
+    if (!cpus.isEmpty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        const int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (ret != 0) {
+            errors << QString("affinity: %1").arg(strerror(ret));
+            affinityOk = false;
+        }
+    }
+    if (policy.realtimePriority > 0) {
+        sched_param param = {};
+        param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), policy.realtimePriority,
+            sched_get_priority_max(SCHED_FIFO));
+        const int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (ret != 0) {
+            errors << QString("SCHED_FIFO: %1").arg(strerror(ret));
+        }
+        else {
+            placement.realtime = true;
+        }
+    }
+    else if (policy.nice != 0) {
+        // Linux  nice ֵǰ̵߳ģ߳IDֻӰ쵱ǰ߳
+        if (setpriority(PRIO_PROCESS, (id_t)placement.tid, policy.nice) != 0) {
+            errors << QString("nice %1: %2").arg(policy.nice).arg(strerror(errno));
+        }
+    }
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, (id_t)placement.tid);
+    placement.nice = errno == 0 ? nice : 0;
+#else
+#ifdef Q_OS_WIN
+    placement.tid = (qint64)GetCurrentThreadId();
+    if (!cpus.isEmpty()) {
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < (int)sizeof(DWORD_PTR) * 8) {
+                mask |= (DWORD_PTR)1 << cpu;
+            }
+        }
+        if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+            errors << QString("affinity: error %1").arg(GetLastError());
+            affinityOk = false;
+        }
+    }
+#else
+    if (!cpus.isEmpty()) {
+        errors << "affinity: not supported on this platform";
+        affinityOk = false;
+    }
+#endif
+    // ûа̵߳ niceֵӳ䵽 Qt ߳ȼ
+    QThread::Priority priority = QThread::InheritPriority;
+    if (policy.realtimePriority > 0) {
+        priority = QThread::TimeCriticalPriority;
+        placement.realtime = true;
+    }
+    else if (policy.nice <= -10) {
+        priority = QThread::HighestPriority;
+    }
+    else if (policy.nice < 0) {
+        priority = QThread::HighPriority;
+    }
+    else if (policy.nice >= 10) {
+        priority = QThread::LowestPriority;
+    }
+    else if (policy.nice > 0) {
+        priority = QThread::LowPriority;
+    }
+    if (priority != QThread::InheritPriority) {
+        QThread::currentThread()->setPriority(priority);
+    }
+    placement.nice = policy.nice;
+#endif
+
+    placement.cpus = formatCpuList(affinityOk ? cpus : QVector<int>());
+    placement.ok = errors.isEmpty();
+    placement.error = errors.join("; ");
+    if (!placement.ok) {
+        qWarning() << "Thread policy for" << stageName(stage) << "not fully applied:" << placement.error;
+    }
+
+    const int id = s_nextId++;
+    s_placements.insert(id, placement);
+    return id;
+}
+
+void ThreadPolicy::release(int id)
+{
+    QMutexLocker locker(&s_policyMutex);
+    s_placements.remove(id);
+}
+
+QVector<ThreadPlacement> ThreadPolicy::placements()
+{
+    QMutexLocker locker(&s_policyMutex);
+    return s_placements.values().toVector();
+}
+
+QStringList ThreadPolicy::report()
+{
+    const QVector<ThreadPlacement> all = placements();
+    QStringList lines;
+    for (int stage = 0; stage < StageCount; ++stage) {
+        int threads = 0;
+        int failed = 0;
+        int realtime = 0;
+        QStringList cpuSets;
+        QList<int> nices;
+        for (const ThreadPlacement& p : all) {
+            if (p.stage != stage) {
+                continue;
+            }
+            ++threads;
+            failed += p.ok ? 0 : 1;
+            realtime += p.realtime ? 1 : 0;
+            if (!cpuSets.contains(p.cpus)) {
+                cpuSets << p.cpus;
+            }
+            if (!nices.contains(p.nice)) {
+                nices << p.nice;
+            }
+        }
+        if (threads == 0) {
+            continue;
+        }
+        QStringList niceText;
+        for (int n : nices) {
+            niceText << QString::number(n);
+        }
+        lines << QString("%1: %2 threads, cpus %3, nice %4%5%6")
+            .arg(stageName(PipelineStage(stage)))
+            .arg(threads)
+            .arg(cpuSets.join(" | "))
+            .arg(niceText.join("/"))
+            .arg(realtime > 0 ? QString(", %1 SCHED_FIFO").arg(realtime) : QString())
+            .arg(failed > 0 ? QString(", %1 failed").arg(failed) : QString());
+    }
+    return lines;
+}
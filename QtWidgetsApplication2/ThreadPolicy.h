@@ -0,0 +1,79 @@
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// ˮ߸׶ε߳
+enum PipelineStage
+{
+    StageDemux = 0,     // DemuxThread / PlaybackThread / ReplayThread / TimeshiftThread
+    StageDecode,
+    StageRecord,
+    StageScreenshot,
+    StageRender,        // RenderThread / MosaicRenderThread
+    StageProxy,         // ProxyRecordThread¼źͱ룩
+    StageCount
+};
+
+// һ׶εĵȲԣ·ͬһ׶ι
+struct StagePolicy
+{
+    QVector<int> cpus;          // 󶨵CPUձʾ󶨣жռʱʹʣµĺģ
+    bool exclusive = false;     // ռûָ cpus Ľ׶βʹЩ
+    int nice = 0;               // Linux ߳ nice ֵֵҪ CAP_SYS_NICEƽ̨ӳΪ߳ȼ
+    int realtimePriority = 0;   // >0 ʱ Linux ʹ SCHED_FIFOҪȨޣ nice
+};
+
+// ĳ߳ʵЧĽͳ
+struct ThreadPlacement
+{
+    PipelineStage stage = StageDemux;
+    qint64 tid = 0;
+    QString cpus;       // ЧCPUб"-" Ϊδ
+    int nice = 0;
+    bool realtime = false;
+    bool ok = true;
+    QString error;      // ʧܵԭ򣨱ûȨޣ
+};
+
+// ̷߳òԣ׶CPU׺ԡȼͺĶռ߳ run() ͷ ThreadPolicyScope Ӧ
+// ߳ʱȡһΣ޸ĺ߳Ч
+class ThreadPolicy
+{
+public:
+    static void setPolicy(PipelineStage stage, const StagePolicy& policy);
+    static StagePolicy policy(PipelineStage stage);
+    static void clear();
+
+    static const char* stageName(PipelineStage stage);
+    static bool stageFromName(const QString& name, PipelineStage* stage);
+    // "0-3,6" ʽCPUб
+    static QVector<int> parseCpuList(const QString& text);
+    static QString formatCpuList(const QVector<int>& cpus);
+
+    // ǰеˮ߳
+    static QVector<ThreadPlacement> placements();
+    // ÿ׶һУ߳CPUȼʧ
+    static QStringList report();
+
+private:
+    friend class ThreadPolicyScope;
+    static int applyToCurrentThread(PipelineStage stage);
+    static void release(int id);
+};
+
+// ߳ run() ĿͷӦñ׶εĲԲǼǣ߳̽ʱע
+class ThreadPolicyScope
+{
+public:
+    explicit ThreadPolicyScope(PipelineStage stage) : m_id(ThreadPolicy::applyToCurrentThread(stage)) {}
+    ~ThreadPolicyScope() { ThreadPolicy::release(m_id); }
+
+private:
+    Q_DISABLE_COPY(ThreadPolicyScope)
+    int m_id;
+};
+
+#endif // THREADPOLICY_H
@@ -0,0 +1,221 @@
+#include "timeshiftbuffer.h"
+#include <QDebug>
+#include <cstring>
+
+#define TIMESHIFT_RECORD_MAGIC 0x50534D54u  // "TMSP"
+#define TIMESHIFT_PAD_MAGIC 0x44415054u     // "TPAD" ļĩβ
+#define TIMESHIFT_MAX_KEYFRAMES 8192
+
+TimeshiftBuffer::TimeshiftBuffer()
+{
+}
+
+TimeshiftBuffer::~TimeshiftBuffer()
+{
+    close();
+}
+
+bool TimeshiftBuffer::open(const QString& filePath, qint64 capacityBytes, AVRational timeBase)
+{
+    close();
+
+    QMutexLocker locker(&m_mutex);
+    m_capacity = alignUp(qMax<qint64>(capacityBytes, 16 * 1024 * 1024));
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !m_file.resize(m_capacity)) {
+        qWarning() << "Timeshift: cannot create" << filePath << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    m_map = m_file.map(0, m_capacity);
+    if (!m_map) {
+        qWarning() << "Timeshift: cannot map" << filePath << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    m_timeBase = timeBase;
+    m_head = 0;
+    m_livePts = AV_NOPTS_VALUE;
+    m_started = false;
+    m_index.resize(TIMESHIFT_MAX_KEYFRAMES);
+    m_indexStart = 0;
+    m_indexCount = 0;
+    qDebug() << "Timeshift buffer" << filePath << m_capacity / (1024 * 1024) << "MB";
+    return true;
+}
+
+void TimeshiftBuffer::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+        m_file.remove();
+    }
+    m_indexCount = 0;
+}
+
+void TimeshiftBuffer::evictIndex()
+{
+    // ѱǵĹؼ֡ȥ
+    const qint64 oldest = m_head - m_capacity;
+    while (m_indexCount > 0 && indexAt(0).position < oldest) {
+        m_indexStart = (m_indexStart + 1) % m_index.size();
+        m_indexCount--;
+    }
+}
+
+void TimeshiftBuffer::append(const AVPacket* packet)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_map || !packet) {
+        return;
+    }
+
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (!m_started && !key) {
+        return;
+    }
+    m_started = true;
+
+    const qint64 recordSize = alignUp(sizeof(RecordHeader) + packet->size);
+    if (recordSize > m_capacity / 4) {
+        qWarning() << "Timeshift: packet too large, skipped" << packet->size;
+        return;
+    }
+
+    // ʣռŲʱдһǣļͷ
+    qint64 offset = m_head % m_capacity;
+    if (offset + recordSize > m_capacity) {
+        if (m_capacity - offset >= (qint64)sizeof(RecordHeader)) {
+            RecordHeader pad = {};
+            pad.magic = TIMESHIFT_PAD_MAGIC;
+            memcpy(m_map + offset, &pad, sizeof(pad));
+        }
+        m_head += m_capacity - offset;
+        offset = 0;
+    }
+
+    RecordHeader header = {};
+    header.magic = TIMESHIFT_RECORD_MAGIC;
+    header.size = packet->size;
+    header.pts = packet->pts;
+    header.dts = packet->dts;
+    header.duration = packet->duration;
+    header.flags = packet->flags;
+    memcpy(m_map + offset, &header, sizeof(header));
+    memcpy(m_map + offset + sizeof(header), packet->data, packet->size);
+
+    const qint64 position = m_head;
+    m_head += recordSize;
+    evictIndex();
+
+    const qint64 pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (pts != AV_NOPTS_VALUE) {
+        m_livePts = pts;
+    }
+    if (key && pts != AV_NOPTS_VALUE) {
+        if (m_indexCount == m_index.size()) {
+            m_indexStart = (m_indexStart + 1) % m_index.size();
+            m_indexCount--;
+        }
+        m_index[(m_indexStart + m_indexCount) % m_index.size()] = { pts, position };
+        m_indexCount++;
+    }
+}
+
+qint64 TimeshiftBuffer::seekPosition(qint64 pts) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_indexCount == 0) {
+        return -1;
+    }
+
+    // ֲһ pts <= ĿĹؼ֡
+    int lo = 0, hi = m_indexCount - 1, found = 0;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (indexAt(mid).pts <= pts) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    return indexAt(found).position;
+}
+
+qint64 TimeshiftBuffer::oldestPosition() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_indexCount > 0 ? indexAt(0).position : -1;
+}
+
+TimeshiftBuffer::ReadResult TimeshiftBuffer::read(qint64* position, AVPacket* out) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_map || !position || *position < 0) {
+        return ReadNoData;
+    }
+
+    for (;;) {
+        if (*position >= m_head) {
+            return ReadNoData;
+        }
+        if (*position < m_head - m_capacity) {
+            return ReadOverrun;
+        }
+
+        const qint64 offset = *position % m_capacity;
+        RecordHeader header;
+        if (offset + (qint64)sizeof(RecordHeader) > m_capacity) {
+            *position += m_capacity - offset;
+            continue;
+        }
+        memcpy(&header, m_map + offset, sizeof(header));
+        if (header.magic == TIMESHIFT_PAD_MAGIC) {
+            *position += m_capacity - offset;
+            continue;
+        }
+        if (header.magic != TIMESHIFT_RECORD_MAGIC) {
+            return ReadOverrun;
+        }
+
+        if (av_new_packet(out, header.size) < 0) {
+            return ReadNoData;
+        }
+        memcpy(out->data, m_map + offset + sizeof(header), header.size);
+        out->pts = header.pts;
+        out->dts = header.dts;
+        out->duration = header.duration;
+        out->flags = header.flags;
+        *position += alignUp(sizeof(RecordHeader) + header.size);
+        return ReadOk;
+    }
+}
+
+qint64 TimeshiftBuffer::livePts() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_livePts;
+}
+
+qint64 TimeshiftBuffer::oldestPts() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_indexCount > 0 ? indexAt(0).pts : AV_NOPTS_VALUE;
+}
+
+double TimeshiftBuffer::bufferedSeconds() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_indexCount == 0 || m_livePts == AV_NOPTS_VALUE) {
+        return 0.0;
+    }
+    return (m_livePts - indexAt(0).pts) * av_q2d(m_timeBase);
+}
@@ -0,0 +1,84 @@
+#ifndef TIMESHIFTBUFFER_H
+#define TIMESHIFTBUFFER_H
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+extern "C" {
+#include "libavcodec/packet.h"
+#include "libavutil/avutil.h"
+#include "libavutil/rational.h"
+}
+
+// ʱƻ壺ѽ⸴óƵ˳׷ӵ̶Сڴӳ价ļУάؼ֡
+// дͷɵݣڴ/ռú㶨дʼ˳
+// λõ߼ƫƱʾƫ = ߼ƫ % һ¼Խļĩβ
+class TimeshiftBuffer
+{
+public:
+    enum ReadResult { ReadOk, ReadNoData, ReadOverrun };
+
+    TimeshiftBuffer();
+    ~TimeshiftBuffer();
+
+    bool open(const QString& filePath, qint64 capacityBytes, AVRational timeBase);
+    void close();
+    bool isOpen() const { return m_map != nullptr; }
+    AVRational timeBase() const { return m_timeBase; }
+
+    //  DemuxThread ãӵһؼ֡ʼ
+    void append(const AVPacket* packet);
+
+    // ҵ PTS  pts ؼ֡λãȻʱɵĹؼ֡ûݷ -1
+    qint64 seekPosition(qint64 pts) const;
+    // ɹؼ֡λ
+    qint64 oldestPosition() const;
+    //  position һɹ position ǰһ
+    // ׷дλ÷ ReadNoDataλѱǷ ReadOverrun
+    ReadResult read(qint64* position, AVPacket* out) const;
+
+    // һɹؼ֡ PTS
+    qint64 livePts() const;
+    qint64 oldestPts() const;
+    double bufferedSeconds() const;
+
+private:
+    struct RecordHeader
+    {
+        quint32 magic;
+        quint32 size;       // ֽ
+        qint64 pts;
+        qint64 dts;
+        qint64 duration;
+        quint32 flags;
+        quint32 reserved;
+    };
+
+    struct KeyEntry
+    {
+        qint64 pts;
+        qint64 position;
+    };
+
+    static qint64 alignUp(qint64 value) { return (value + 7) & ~(qint64)7; }
+    void evictIndex();
+    const KeyEntry& indexAt(int i) const { return m_index[(m_indexStart + i) % m_index.size()]; }
+
+    mutable QMutex m_mutex;
+    QFile m_file;
+    uchar* m_map = nullptr;
+    qint64 m_capacity = 0;
+    qint64 m_head = 0;          // һ¼߼ƫ
+    AVRational m_timeBase{ 1, 90000 };
+    qint64 m_livePts = AV_NOPTS_VALUE;
+    bool m_started = false;
+
+    // ؼ̶֡Ļ PTS 
+    QVector<KeyEntry> m_index;
+    int m_indexStart = 0;
+    int m_indexCount = 0;
+};
+
+#endif // TIMESHIFTBUFFER_H
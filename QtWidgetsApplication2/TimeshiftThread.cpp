@@ -0,0 +1,119 @@
+#include "timeshiftthread.h"
+#include "threadpolicy.h"
+#include "timeshiftbuffer.h"
+#include <QDebug>
+#include <QElapsedTimer>
+
+#define MAX_TIMESHIFT_DECODE_QUEUE 30
+
+TimeshiftThread::TimeshiftThread(TimeshiftBuffer* buffer, QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+    QObject* parent)
+    : QThread(parent), m_buffer(buffer), m_decodeQueue(decodeQueue), m_decodeMutex(decodeMutex)
+{
+}
+
+TimeshiftThread::~TimeshiftThread()
+{
+    stop();
+    wait();
+}
+
+void TimeshiftThread::stop()
+{
+    m_stopped = true;
+}
+
+double TimeshiftThread::delaySeconds() const
+{
+    const qint64 current = m_currentPts;
+    const qint64 live = m_buffer->livePts();
+    if (current == AV_NOPTS_VALUE || live == AV_NOPTS_VALUE) {
+        return 0.0;
+    }
+    return qMax(0.0, (live - current) * av_q2d(m_buffer->timeBase()));
+}
+
+void TimeshiftThread::run()
+{
+    ThreadPolicyScope policyScope(StageDemux);
+    const double timeBase = av_q2d(m_buffer->timeBase());
+    QElapsedTimer clock;
+    clock.start();
+
+    // ԵһDTSǽӣͣڼѻ׼
+    qint64 baseDts = AV_NOPTS_VALUE;
+    qint64 baseMs = 0;
+    qint64 pausedAt = -1;
+    AVPacket* pending = nullptr;
+
+    while (!m_stopped) {
+        if (m_paused) {
+            if (pausedAt < 0) {
+                pausedAt = clock.elapsed();
+            }
+            msleep(10);
+            continue;
+        }
+        if (pausedAt >= 0) {
+            baseMs += clock.elapsed() - pausedAt;
+            pausedAt = -1;
+        }
+
+        if (!pending) {
+            pending = av_packet_alloc();
+            TimeshiftBuffer::ReadResult result = m_buffer->read(&m_position, pending);
+            if (result == TimeshiftBuffer::ReadNoData) {
+                // ׷ֱԵ
+                av_packet_free(&pending);
+                msleep(5);
+                continue;
+            }
+            if (result == TimeshiftBuffer::ReadOverrun) {
+                av_packet_free(&pending);
+                qWarning() << "Timeshift position overwritten, jumping to the oldest keyframe";
+                m_position = m_buffer->oldestPosition();
+                baseDts = AV_NOPTS_VALUE;
+                emit sigOverrun();
+                continue;
+            }
+        }
+
+        // ˳B֡ʱPTSDTSͰŲһһͣ
+        // ¼תһֻûDTSʱ˻PTS
+        const qint64 dts = pending->dts != AV_NOPTS_VALUE ? pending->dts : pending->pts;
+        if (dts != AV_NOPTS_VALUE) {
+            if (baseDts == AV_NOPTS_VALUE || dts < baseDts) {
+                baseDts = dts;
+                baseMs = clock.elapsed();
+            }
+            // ԭʼͰʾҪ֪ǲǻط
+            const qint64 dueMs = baseMs + (qint64)((dts - baseDts) * timeBase * 1000.0);
+            const qint64 waitMs = dueMs - clock.elapsed();
+            if (waitMs > 0) {
+                msleep((unsigned long)qMin<qint64>(waitMs, 10));
+                continue;
+            }
+        }
+        // طλúֱԵTimeshiftBuffer::livePtsһPTS
+        const qint64 pts = pending->pts != AV_NOPTS_VALUE ? pending->pts : pending->dts;
+        if (pts != AV_NOPTS_VALUE) {
+            m_currentPts = pts;
+        }
+
+        m_decodeMutex->lock();
+        const bool full = m_decodeQueue->size() >= MAX_TIMESHIFT_DECODE_QUEUE;
+        if (!full) {
+            m_decodeQueue->enqueue(pending);
+            pending = nullptr;
+        }
+        m_decodeMutex->unlock();
+        if (full) {
+            msleep(5);
+        }
+    }
+
+    if (pending) {
+        av_packet_free(&pending);
+    }
+    qDebug() << "Timeshift thread finished.";
+}
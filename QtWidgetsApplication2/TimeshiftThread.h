@@ -0,0 +1,52 @@
+#ifndef TIMESHIFTTHREAD_H
+#define TIMESHIFTTHREAD_H
+
+#include <QThread>
+#include <QQueue>
+#include <QMutex>
+#include <atomic>
+
+extern "C" {
+#include "libavcodec/packet.h"
+#include "libavutil/avutil.h"
+}
+
+class TimeshiftBuffer;
+
+// ʱƻطţʱƻĳؼ֡ʼPTSѰͽУֱ DemuxThread
+class TimeshiftThread : public QThread
+{
+    Q_OBJECT
+public:
+    TimeshiftThread(TimeshiftBuffer* buffer, QQueue<AVPacket*>* decodeQueue, QMutex* decodeMutex,
+        QObject* parent = nullptr);
+    ~TimeshiftThread();
+
+    //  start() ǰʼλãTimeshiftBuffer::seekPosition ķֵ
+    void setStartPosition(qint64 position) { m_position = position; }
+    void setPaused(bool paused) { m_paused = paused; }
+    bool isPaused() const { return m_paused; }
+    void stop();
+
+    // ǰطλֱ
+    double delaySeconds() const;
+
+signals:
+    // ̫ͣãطλѱݸǣ˻ɵĹؼ֡
+    void sigOverrun();
+
+protected:
+    void run() override;
+
+private:
+    TimeshiftBuffer* m_buffer;
+    QQueue<AVPacket*>* m_decodeQueue;
+    QMutex* m_decodeMutex;
+
+    qint64 m_position = -1;
+    std::atomic<qint64> m_currentPts{ AV_NOPTS_VALUE };
+    std::atomic<bool> m_paused{ false };
+    volatile bool m_stopped = false;
+};
+
+#endif // TIMESHIFTTHREAD_H
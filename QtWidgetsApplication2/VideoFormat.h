@@ -0,0 +1,72 @@
+#ifndef VIDEOFORMAT_H
+#define VIDEOFORMAT_H
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libavutil/pixfmt.h"
+}
+
+// һֱ֡ϴCPUת
+struct VideoPlaneLayout
+{
+    bool planar = false;      // true: Y/U/V ƽ棻false: Y + ֯UV(NV12/P010)
+    bool sixteenBit = false;  // ÿ16λ洢
+    bool fullRange = false;   // JPEG/ȫΧ(0-255)ΪTVΧ(16-235)
+    float sampleScale = 1.0f; // ֵһϵλ10λҪŴ
+};
+
+// Ⱦֱʾظʽ
+inline bool videoPlaneLayout(AVPixelFormat format, VideoPlaneLayout* layout)
+{
+    VideoPlaneLayout l;
+    switch (format) {
+    case AV_PIX_FMT_NV12:
+        break;
+    case AV_PIX_FMT_P010LE:   // 10λڸλ16λһ
+    case AV_PIX_FMT_P016LE:
+        l.sixteenBit = true;
+        break;
+    case AV_PIX_FMT_YUVJ420P:
+        l.fullRange = true;
+        l.planar = true;
+        break;
+    case AV_PIX_FMT_YUV420P:
+        l.planar = true;
+        break;
+    case AV_PIX_FMT_YUV420P10LE: // 10λڵλ
+        l.planar = true;
+        l.sixteenBit = true;
+        l.sampleScale = 65535.0f / 1023.0f;
+        break;
+    default:
+        return false;
+    }
+    if (layout) {
+        *layout = l;
+    }
+    return true;
+}
+
+inline bool isRenderableFormat(AVPixelFormat format)
+{
+    return videoPlaneLayout(format, nullptr);
+}
+
+// YUV->RGB תϵ (Kr', Kg_u, Kg_v, Kb')֡ɫʿռѡδעBT.601
+inline void yuvToRgbCoefficients(AVColorSpace colorspace, float coeffs[4])
+{
+    switch (colorspace) {
+    case AVCOL_SPC_BT709:
+        coeffs[0] = 1.5748f; coeffs[1] = 0.187324f; coeffs[2] = 0.468124f; coeffs[3] = 1.8556f;
+        break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        coeffs[0] = 1.4746f; coeffs[1] = 0.164553f; coeffs[2] = 0.571353f; coeffs[3] = 1.8814f;
+        break;
+    default:
+        coeffs[0] = 1.402f; coeffs[1] = 0.344136f; coeffs[2] = 0.714136f; coeffs[3] = 1.772f;
+        break;
+    }
+}
+
+#endif // VIDEOFORMAT_H
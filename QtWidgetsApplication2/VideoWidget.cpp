@@ -1,12 +1,13 @@
 #include "videowidget.h"
 #include <QOpenGLShader>
+#include <QOffscreenSurface>
 #include <QDebug>
 #include <QImage>
 #include <QQueue>
+#include <QEvent>
 
-#define  MAX_QUEUE_SIZE 30
-// YUV420P ȾĶɫ
-const char* vertexShaderSource =
+// ϳõɫֱӲȾ߳RGB
+const char* blitVertexShaderSource =
 "attribute vec4 vertexIn;\n"
 "attribute vec2 textureIn;\n"
 "varying vec2 textureOut;\n"
@@ -16,38 +17,16 @@ const char* vertexShaderSource =
 "    textureOut = textureIn;\n"
 "}\n";
 
-const char* fragmentShaderSource_NV12_fixed =
+const char* blitFragmentShaderSource =
 "varying vec2 textureOut;\n"
-"uniform sampler2D tex_y;\n"
-"uniform sampler2D tex_uv;\n"
+"uniform sampler2D tex_rgb;\n"
 "void main(void)\n"
 "{\n"
-"    // 1. ԭʼ YUV ֵ\n"
-"    float y_raw = texture2D(tex_y, textureOut).r;\n"
-"    vec2 uv_raw = texture2D(tex_uv, textureOut).rg;\n"
-"\n"
-"    // 2.  Limited Range (16-235 for Y, 16-240 for UV) չ Full Range (0-1.0)\n"
-"    // Y: (y_raw * 255 - 16) / (235 - 16) / 255 = (y_raw - 16.0/255.0) / (219.0/255.0)\n"
-"    float y = (y_raw - 0.0627) / 0.8588;\n"
-"    // UV: (uv_raw * 255 - 16) / (240 - 16) / 255 = (uv_raw - 16.0/255.0) / (224.0/255.0)\n"
-"    vec2 uv = (uv_raw - 0.0627) / 0.8784;\n"
-"    uv -= 0.5; //  UV  [0,1] ƫƵ [-0.5, 0.5]\n"
-"\n"
-"    // 3. ʹñ׼ BT.709 ת (HDTV ׼)\n"
-"    float r = y + 1.402 * uv.y;\n"
-"    float g = y - 0.344136 * uv.x - 0.714136 * uv.y;\n"
-"    float b = y + 1.772 * uv.x;\n"
-"\n"
-"    gl_FragColor = vec4(r, g, b, 1.0);\n"
+"    gl_FragColor = texture2D(tex_rgb, textureOut);\n"
 "}\n";
 
 VideoWidget::VideoWidget(QWidget* parent) : QOpenGLWidget(parent)/*, m_screenshotRequested(false)*/
 {
-    m_timer.setInterval(33);
-    m_timer.setTimerType(Qt::PreciseTimer);
-    QObject::connect(&m_timer, &QTimer::timeout, this, &VideoWidget::UpdateImg);
-    m_timer.start();
-
 }
 
 VideoWidget::~VideoWidget()
@@ -60,144 +39,196 @@ void VideoWidget::UpdateImg()
     update();
 }
 
+RenderStats VideoWidget::renderStats() const
+{
+    if (m_renderThread)
+    {
+        return m_renderThread->stats();
+    }
+    return RenderStats();
+}
+
 void VideoWidget::initializeGL()
 {
     initializeOpenGLFunctions();
 
+    // ؼ¹ҵĶ㴰ʱĻؽɵȾ߳Ҫͣ
+    stopRenderThread();
+    delete m_program;
+
     m_program = new QOpenGLShaderProgram(this);
-    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
-    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource_NV12_fixed);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, blitVertexShaderSource);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, blitFragmentShaderSource);
     m_program->link();
 
-	m_program->bind();
-    m_program->setUniformValue("tex_y", 0);
-    m_program->setUniformValue("tex_uv", 1);
+    m_program->bind();
+    m_program->setUniformValue("tex_rgb", 0);
     m_program->release();
 
-    glGenTextures(1, &m_textureY);
-    glGenTextures(1, &m_textureUV);
-
-    glBindTexture(GL_TEXTURE_2D, m_textureY);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, GL_NONE);
-
-    glBindTexture(GL_TEXTURE_2D, m_textureUV);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, GL_NONE);
+    // surfaceGUI̴߳
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(context()->format());
+    m_surface->create();
+
+    m_renderThread = new RenderThread(context(), m_surface);
+    m_renderThread->setMyQueue(m_queue);
+    m_renderThread->setMyMutex(m_mutex);
+    m_renderThread->setMetrics(m_metrics);
+    m_renderThread->setPaused(!m_displayVisible);
+    QObject::connect(m_renderThread, &RenderThread::frameReady, this, &VideoWidget::UpdateImg, Qt::QueuedConnection);
+    m_renderThread->start();
 }
 
 void VideoWidget::paintGL()
 {
-    if (m_queue == nullptr || m_mutex == nullptr)
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!m_renderThread)
     {
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
         return;
     }
 
-    m_mutex->lock();
-    if (!m_queue->isEmpty()) 
+    // ڼȾ̲߳ύ
+    GLuint texture = m_renderThread->lockFrontTexture();
+    if (texture)
     {
-        if (m_frame) 
+        const GLfloat vertices[] =
         {
-            av_frame_free(&m_frame);
-        }
-        m_frame = m_queue->dequeue();
-    }
-    m_mutex->unlock(); 
+            -1.0f, -1.0f,
+             1.0f, -1.0f,
+            -1.0f,  1.0f,
+             1.0f,  1.0f,
+        };
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+        const GLfloat texcoords[] =
+        {
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            0.0f, 1.0f,
+            1.0f, 1.0f,
+        };
 
-    if (!m_frame || !m_frame->data[0] || !m_frame->data[1]) 
-    {
-        return;
-    }
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
 
-    if (m_videoW != m_frame->width || m_videoH != m_frame->height) {
-        m_videoW = m_frame->width;
-        m_videoH = m_frame->height;
-        glBindTexture(GL_TEXTURE_2D, m_textureY);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_videoW, m_videoH, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
-        glBindTexture(GL_TEXTURE_2D, m_textureUV);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG, m_videoW / 2, m_videoH / 2, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
-    }
+        m_program->bind();
+        int vertexIn = m_program->attributeLocation("vertexIn");
+        int textureIn = m_program->attributeLocation("textureIn");
 
-	glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_textureY);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_frame->linesize[0]);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_videoW, m_videoH, GL_RED, GL_UNSIGNED_BYTE, m_frame->data[0]);
+        m_program->enableAttributeArray(vertexIn);
+        m_program->enableAttributeArray(textureIn);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_textureUV);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_frame->linesize[1] / 2);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_videoW / 2, m_videoH / 2, GL_RG, GL_UNSIGNED_BYTE, m_frame->data[1]);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        m_program->setAttributeArray(vertexIn, GL_FLOAT, vertices, 2);
+        m_program->setAttributeArray(textureIn, GL_FLOAT, texcoords, 2);
 
-	m_program->bind();
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	float videoAspect = (float)m_videoW / (float)m_videoH;
-    float widgetAspect = (float)this->width() / (float)this->height();
+        m_program->disableAttributeArray(vertexIn);
+        m_program->disableAttributeArray(textureIn);
+        m_program->release();
+        glBindTexture(GL_TEXTURE_2D, GL_NONE);
+    }
+    m_renderThread->unlockFrontTexture();
+}
 
 
-    float scaleX = 1.0f;
-    float scaleY = 1.0f;
-    if (widgetAspect > videoAspect) 
+
+void VideoWidget::resizeGL(int w, int h)
+{
+    glViewport(0, 0, w, h);
+
+    const qreal ratio = devicePixelRatioF();
+    if (m_renderThread)
     {
-    	scaleX = videoAspect / widgetAspect;
+        m_renderThread->setTargetSize(qRound(w * ratio), qRound(h * ratio));
     }
-    else 
+
+    // ȫʱָԭʼֱʣ򰴴ڵسߴ
+    if (window()->isFullScreen())
     {
-        scaleY = widgetAspect / videoAspect;
+        emit sigDisplaySizeChanged(0, 0);
     }
-
-    const GLfloat vertices_raw[] = 
+    else
     {
-        -1.0f, -1.0f,
-         1.0f, -1.0f,
-        -1.0f,  1.0f,
-         1.0f,  1.0f,
-    };
+        emit sigDisplaySizeChanged(qRound(w * ratio), qRound(h * ratio));
+    }
+}
 
-	const GLfloat texcoords[] = 
-    {
-        0.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-    };
+void VideoWidget::showEvent(QShowEvent* event)
+{
+    QOpenGLWidget::showEvent(event);
 
-	const GLfloat vertices[] = 
+    // ؼܱҵĶ㴰ϣȫŻ
+    QWidget* top = window();
+    if (top != m_topWindow)
     {
-        vertices_raw[0] * scaleX, vertices_raw[1] * scaleY,
-        vertices_raw[2] * scaleX, vertices_raw[3] * scaleY,
-        vertices_raw[4] * scaleX, vertices_raw[5] * scaleY,
-        vertices_raw[6] * scaleX, vertices_raw[7] * scaleY,
-    };
-
-    int vertexIn = m_program->attributeLocation("vertexIn");
-    int textureIn = m_program->attributeLocation("textureIn");
-
-    m_program->enableAttributeArray(vertexIn);
-    m_program->enableAttributeArray(textureIn);
-
-    m_program->setAttributeArray(vertexIn, GL_FLOAT, vertices, 2);
-    m_program->setAttributeArray(textureIn, GL_FLOAT, texcoords, 2);
+        if (m_topWindow)
+        {
+            m_topWindow->removeEventFilter(this);
+        }
+        m_topWindow = top;
+        if (top != this)
+        {
+            top->installEventFilter(this);
+        }
+    }
+    updateVisibility();
+}
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+void VideoWidget::hideEvent(QHideEvent* event)
+{
+    QOpenGLWidget::hideEvent(event);
+    updateVisibility();
+}
 
-    m_program->disableAttributeArray(vertexIn);
-    m_program->disableAttributeArray(textureIn);
-    m_program->release();
+void VideoWidget::changeEvent(QEvent* event)
+{
+    QOpenGLWidget::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange)
+    {
+        updateVisibility();
+    }
 }
 
+bool VideoWidget::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_topWindow && event->type() == QEvent::WindowStateChange)
+    {
+        updateVisibility();
+    }
+    return QOpenGLWidget::eventFilter(watched, event);
+}
 
+void VideoWidget::updateVisibility()
+{
+    const bool visible = isVisible() && !window()->isMinimized();
+    if (visible == m_displayVisible)
+    {
+        return;
+    }
+    m_displayVisible = visible;
+    if (m_renderThread)
+    {
+        m_renderThread->setPaused(!visible);
+    }
+    emit sigVisibilityChanged(visible);
+}
 
-void VideoWidget::resizeGL(int w, int h)
+void VideoWidget::stopRenderThread()
 {
-    glViewport(0, 0, w, h);
+    if (m_renderThread)
+    {
+        m_renderThread->stop();
+        m_renderThread->wait();
+        delete m_renderThread;
+        m_renderThread = nullptr;
+    }
+    if (m_surface)
+    {
+        delete m_surface;
+        m_surface = nullptr;
+    }
 }
 
 void VideoWidget::cleanup()
@@ -205,6 +236,7 @@ void VideoWidget::cleanup()
     makeCurrent(); 
 
     clearScreen();
+    stopRenderThread();
 
     if (m_program) 
     {
@@ -212,9 +244,6 @@ void VideoWidget::cleanup()
         m_program = nullptr;
     }
 
-    glDeleteTextures(1, &m_textureY);
-    glDeleteTextures(1, &m_textureUV);
-
     doneCurrent();
 }
 
@@ -233,22 +262,11 @@ void VideoWidget::clearScreen()
                 av_frame_free(&frame);
             }
         }
-        if (m_frame) 
-        {
-            av_frame_free(&m_frame);
-            m_frame = nullptr;
-        }
     }
-    else 
+    if (m_renderThread)
     {
-        if (m_frame) 
-        {
-            av_frame_free(&m_frame);
-            m_frame = nullptr;
-        }
+        m_renderThread->clear();
     }
-    m_videoW = 0;
-    m_videoH = 0;
 
     update();
 }
\ No newline at end of file
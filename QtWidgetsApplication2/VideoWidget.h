@@ -6,12 +6,16 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QMutex>
-#include <QTimer>
 #include <QQueue>
+#include <QPointer>
 extern "C" {
 #include "libavutil/frame.h"
 }
 
+#include "renderthread.h"
+
+class QOffscreenSurface;
+
 class VideoWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -22,32 +26,63 @@ public:
     void setMyQueue(QQueue< AVFrame*>* queue)
     {
         m_queue = queue;
+        if (m_renderThread)
+            m_renderThread->setMyQueue(queue);
     }
 
     void setMyMutex(QMutex* mutex)
     {
         m_mutex = mutex;
+        if (m_renderThread)
+            m_renderThread->setMyMutex(mutex);
+    }
+
+    // Ⱦ̵߳֡ʱͳ
+    RenderStats renderStats() const;
+
+    // ؼʾڴûС
+    bool isDisplayVisible() const { return m_displayVisible; }
+
+    void setMetrics(StreamMetrics* metrics)
+    {
+        m_metrics = metrics;
+        if (m_renderThread)
+            m_renderThread->setMetrics(metrics);
     }
 
+signals:
+    // ʾߴ磨أ仯ȫʱΪ 0x0 ʾҪԭʼֱ
+    void sigDisplaySizeChanged(int width, int height);
+    // Ϊɼ/ɼؼػ򴰿СɼڼȾ߳ͣ
+    void sigVisibilityChanged(bool visible);
+
 protected:
     void initializeGL() override;
     void paintGL() override;
     void resizeGL(int w, int h) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    bool eventFilter(QObject* watched, QEvent* event) override;
 private slots:
     void UpdateImg();
 private:
     void cleanup();
+    void stopRenderThread();
+    void updateVisibility();
 
+    // GUIֻ߳Ⱦ̻߳õRGB
     QOpenGLShaderProgram* m_program = nullptr;
-    AVFrame* m_frame = nullptr;
 
     QQueue< AVFrame*>* m_queue = nullptr;
-    QMutex* m_mutex;
+    QMutex* m_mutex = nullptr;
+    StreamMetrics* m_metrics = nullptr;
 
-    GLuint m_textureY, m_textureUV;
-    int m_videoW = 0, m_videoH = 0;
+    RenderThread* m_renderThread = nullptr;
+    QOffscreenSurface* m_surface = nullptr;
 
-    QTimer m_timer;
+    bool m_displayVisible = false;
+    QPointer<QWidget> m_topWindow;  // С/ԭ
 };
 
 #endif // VIDEOWIDGET_H
\ No newline at end of file
@@ -3,7 +3,7 @@
 #include <QtWidgets/QApplication>
 
 #include "mainwindow.h"
-QString pLogFile;
+#include "asynclogger.h"
 
 QString TimeToString(QDateTime time, QString formate);
 void outputMessage(QtMsgType type, const QMessageLogContext& context, const QString& msg);
@@ -11,13 +11,24 @@ int main(int argc, char *argv[])
 {
     Q_INIT_RESOURCE(QtWidgetsApplication2); // һ
     QApplication app(argc, argv);
-    QString time = TimeToString(QDateTime::currentDateTime(), "yyyy-MM-dd");  //ȡ
-    pLogFile = QCoreApplication::applicationDirPath() + "/Test" + time + ".log"; 
+    // ־ɺ̨߳д룬ڻļļ 10MB 
+    AsyncLogger* logger = AsyncLogger::instance();
+    logger->setFilePattern(QCoreApplication::applicationDirPath() + "/Test%1.log");
+    logger->setRotation(10 * 1024 * 1024, 5);
+    logger->setRateLimit(20);
+    logger->start(QThread::LowPriority);
     qInstallMessageHandler(outputMessage);  //עMessageHandler
 
-    MainWindow window;
-    window.show();
-    return app.exec();
+    int ret;
+    {
+        MainWindow window;
+        window.show();
+        ret = app.exec();
+    }
+
+    qInstallMessageHandler(nullptr);
+    logger->stop();
+    return ret;
 }
 QString TimeToString(QDateTime time, QString formate)
 {
@@ -39,46 +50,10 @@ void outputMessage(QtMsgType type, const QMessageLogContext& context, const QStr
         return;
     }
 
-    static QMutex mutex;
-    mutex.lock();
-
-    QString text;
-    switch (type)
+    // ֻУڵ߳ļIO
+    AsyncLogger::instance()->log(type, context.category, msg);
+    if (type == QtFatalMsg)
     {
-    case QtDebugMsg:
-        text = QString("Debug:");
-        break;
-    case QtWarningMsg:
-        text = QString("Warning:");
-        mutex.unlock();
-        return;
-    case QtCriticalMsg:
-        text = QString("Critical:");
-        break;
-    case QtFatalMsg:
-        text = QString("Fatal:");
-        break;
-    case QtInfoMsg:
-        text = QString("Info:");
-        break;
-    default:
-        mutex.unlock();
-        return;
+        AsyncLogger::instance()->flush();
     }
-
-    //QString context_info = QString("File:(%1) Line:(%2)").arg(QString(context.file)).arg(context.line);
-    QString current_date_time = TimeToString(QDateTime::currentDateTime(), "yyyy-MM-dd HH:mm:ss,zzz");
-    QString message = QString("%1 %2 - %3").arg(current_date_time).arg(text).arg(msg);
-
-    QFile file(pLogFile);
-    bool b = file.open(QIODevice::WriteOnly | QIODevice::Append);
-    if (b)
-    {
-        QTextStream text_stream(&file);
-        text_stream << message << "\r\n";
-        file.flush();
-        file.close();
-    }
-
-    mutex.unlock();
 }